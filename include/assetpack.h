@@ -0,0 +1,111 @@
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <cstdint>
+#include <cstddef>
+#include "meshbuilder.h"
+
+// Single-file asset archive, memory mapped so assets go to GL straight from the mapped pages: one open and no read() or
+// heap copy per asset. Layout: a 64-byte header, a table of contents of 64-byte entries, the name table, then the blobs,
+// each aligned to ASSET_ALIGNMENT. Blobs are stored in their upload format, so nothing needs decoding at load time:
+//   ASSET_TEXTURE - every mip level back to back from level 0, RGBA8 rows bottom-up, or BCn blocks (see ktx2.h formats)
+//   ASSET_MESH    - interleaved float vertices, then uint32 indices
+//   ASSET_SHADER  - GLSL source text (not NUL terminated, pass the length to GL)
+const uint32_t ASSET_PACK_VERSION = 1;
+const uint32_t ASSET_ALIGNMENT = 256;   // Covers cache lines, SIMD loads and GL's buffer offset alignment
+
+enum AssetType
+{
+    ASSET_RAW,
+    ASSET_TEXTURE,
+    ASSET_MESH,
+    ASSET_SHADER
+};
+
+struct AssetPackHeader
+{
+    char Magic[4];          // "GLAP"
+    uint32_t Version;
+    uint32_t AssetCount;
+    uint32_t Alignment;
+    uint64_t TocOffset, NamesOffset, NamesSize, FileSize;
+    uint64_t Reserved[2];
+};
+
+struct AssetEntry
+{
+    uint64_t Offset, Size;  // Blob byte range in the file
+    uint64_t Hash;          // hashBytes() of the blob, identical blobs are stored once
+    uint32_t Type;          // AssetType
+    uint32_t NameOffset, NameLength;
+    // ASSET_TEXTURE: width, height, level count, VkFormat (0 = RGBA8). ASSET_MESH: floats per vertex, vertex count, index count
+    uint32_t Params[5];
+    uint64_t Reserved;
+};
+
+// Fast 64-bit hash, 8 bytes per step (content identity, not security)
+unsigned long long hashBytes(const void* data, size_t bytes);
+
+// Read side: maps the whole file read-only. Pointers handed out stay valid for the pack's lifetime
+class AssetPack
+{
+public:
+    bool Valid = false;
+    std::string Path;
+
+    AssetPack(const std::string& path);
+    ~AssetPack();
+    AssetPack(const AssetPack&) = delete;
+    AssetPack& operator=(const AssetPack&) = delete;
+
+    // NULL if there is no asset with that name
+    const AssetEntry* find(const std::string& name) const;
+    const unsigned char* data(const AssetEntry& entry) const { return base + entry.Offset; }
+    std::string name(const AssetEntry& entry) const;
+    size_t count() const { return entries ? header->AssetCount : 0; }
+    const AssetEntry& entry(size_t i) const { return entries[i]; }
+    // Asks the OS to start paging the blob in, so the upload that follows doesn't fault page by page
+    void prefetch(const AssetEntry& entry) const;
+    // Re-hashes the blob against its table of contents hash (touches every page of it)
+    bool verify(const AssetEntry& entry) const;
+
+private:
+    const unsigned char* base = NULL;
+    size_t size = 0;
+    const AssetPackHeader* header = NULL;
+    const AssetEntry* entries = NULL;
+    std::unordered_map<std::string, size_t> index;
+#ifdef _WIN32
+    void* fileHandle = NULL;
+    void* mappingHandle = NULL;
+#endif
+};
+
+// Write side, for tools: collects assets, then lays the file out in one go
+class AssetPackWriter
+{
+public:
+    void addRaw(const std::string& name, const void* data, size_t bytes, AssetType type = ASSET_RAW, const uint32_t* params = NULL);
+    // 'levels' from level 0 down, each level's size following GL's halving
+    void addTexture(const std::string& name, int width, int height, unsigned vkFormat, const std::vector<std::vector<unsigned char>>& levels);
+    void addMesh(const std::string& name, const MeshData& mesh);
+    void addShader(const std::string& name, const std::string& source);
+    // Prints ERROR::ASSETPACK::... and returns false on failure
+    bool write(const std::string& path) const;
+
+private:
+    struct Pending
+    {
+        std::string name;
+        AssetType type;
+        uint32_t params[5];
+        std::vector<unsigned char> blob;
+        unsigned long long hash;
+    };
+    std::vector<Pending> assets;
+};
+
+#endif
@@ -0,0 +1,69 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <string>
+#include <vector>
+#include <map>
+#include "mipmap.h"
+
+// One source image for buildAtlas(), RGBA8 with rows bottom-up like every texture the loader uploads
+struct AtlasImage
+{
+    std::string Name;
+    int Width, Height;
+    const unsigned char* Pixels;
+    bool Wrap = true;   // Gutters repeat the opposite edge (for GL_REPEAT sampling at the 0/1 seams), else they extend the edge
+};
+
+// Where an image ended up, in texels and in atlas UVs. This is the remap table: u' = UMin + u * (UMax - UMin)
+struct AtlasRegion
+{
+    int X, Y, Width, Height;
+    float UMin, VMin, UMax, VMax;
+};
+
+struct AtlasOptions
+{
+    int Padding = 16;   // Gutter texels around every image, a power of two. Mip levels up to log2(Padding) never bleed
+    int MaxSize = 4096; // Largest width/height the atlas may grow to
+    MipOptions Mipmaps;
+};
+
+struct TextureAtlas
+{
+    int Width = 0, Height = 0;
+    std::vector<std::vector<unsigned char>> Levels;  // RGBA8, level 0 then the mips that stay inside the gutters
+    std::map<std::string, AtlasRegion> Regions;
+    float Occupancy = 0.0f;     // Image texels / atlas texels
+};
+
+// Bottom-left skyline packer: the free space is the outline of what was placed so far, so each insert only looks at the
+// outline's segments. Good for rectangles of mixed sizes inserted tallest first
+class SkylinePacker
+{
+public:
+    SkylinePacker(int width, int height);
+    // Returns false (x/y untouched) if the rectangle doesn't fit anywhere
+    bool insert(int width, int height, int& x, int& y);
+
+private:
+    struct Segment
+    {
+        int x, y, width;
+    };
+    std::vector<Segment> skyline;   // Ordered by x, covering [0, width)
+    int width, height;
+
+    // Lowest y a rectangle of 'width' resting on segment 'index' can sit at, -1 if it overhangs the atlas
+    int fitAt(size_t index, int width, int height) const;
+};
+
+// Packs the images into the smallest atlas that fits (power-of-two width, height trimmed to a multiple of the padding, both
+// up to MaxSize), fills the gutters and builds the mip chain.
+// Prints ERROR::ATLAS::... and returns false if they don't fit
+bool buildAtlas(const std::vector<AtlasImage>& images, const AtlasOptions& options, TextureAtlas& atlas);
+// Rewrites the UVs (2 floats at 'uvOffset' into each vertex) from the image's own [0, 1] range into its atlas region.
+// Returns how many UVs were outside [0, 1]: the atlas can't repeat an image, those need a texture of their own
+size_t remapUVs(std::vector<float>& vertices, int floatsPerVertex, int uvOffset, const AtlasRegion& region);
+
+#endif
@@ -0,0 +1,62 @@
+#ifndef CULLING_H
+#define CULLING_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "meshbuilder.h"
+
+// The 6 planes of a view frustum, (a, b, c, d) with a*x + b*y + c*z + d >= 0 on the inside and (a, b, c) unit length
+struct Frustum
+{
+    glm::vec4 Planes[6];    // Left, right, bottom, top, near, far
+};
+
+// Planes of the volume 'viewProjection' (e.g. projection * view) maps into GL's clip cube, in the space it maps from
+Frustum extractFrustum(const glm::mat4& viewProjection);
+
+// Object space bounds of a mesh: its AABB, and a sphere around the box center reaching its farthest vertex
+struct LocalBounds
+{
+    glm::vec3 Min = glm::vec3(0.0f), Max = glm::vec3(0.0f);
+    float Radius = 0.0f;
+};
+
+// Positions are the first 3 floats of each vertex
+LocalBounds computeBounds(const MeshData& mesh);
+
+// Instruction set for the culling kernel. BEST picks the widest one the CPU supports at runtime
+enum CullSimd
+{
+    CULL_SIMD_SCALAR,
+    CULL_SIMD_SSE2,     // 4 objects per iteration
+    CULL_SIMD_AVX2,     // 8 objects per iteration
+    CULL_SIMD_BEST
+};
+
+// World space bounds of many objects, every component in its own array (structure of arrays) so a kernel loads the same
+// component of 4/8 objects with one load. Each object has an AABB (center & half extents) and a bounding sphere, it is
+// culled if either is fully outside a plane: the box is tighter for axis aligned shapes, the sphere for rotated ones
+class CullingBounds
+{
+public:
+    std::vector<float> CenterX, CenterY, CenterZ, ExtentX, ExtentY, ExtentZ;    // AABB
+    std::vector<float> SphereX, SphereY, SphereZ, Radius;                     // Sphere
+
+    size_t size() const { return CenterX.size(); }
+    void clear();
+    void reserve(size_t count);
+    // World bounds of a mesh placed by 'model'. Returns the object's index
+    size_t add(const LocalBounds& local, const glm::mat4& model);
+    // Bounds already in world space
+    size_t add(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& sphereCenter, float radius);
+};
+
+// Writes the indices of the objects (partly) inside the frustum to 'visible', in increasing order. Returns how many there are
+size_t cullFrustum(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visible, CullSimd simd = CULL_SIMD_BEST);
+// What CULL_SIMD_BEST resolves to on this CPU
+CullSimd detectCullSimd();
+const char* cullSimdName(CullSimd simd);
+
+#endif
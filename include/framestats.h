@@ -0,0 +1,61 @@
+#ifndef FRAMESTATS_H
+#define FRAMESTATS_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <ctime>
+#include <iostream>
+#include <iomanip>
+
+// Collects per-frame times (in ms) and the process CPU time over a run, then prints min/mean/percentiles at the end
+class FrameStats
+{
+public:
+    std::vector<double> FrameTimes;
+
+    FrameStats(size_t expectedFrames = 0)
+    {
+        FrameTimes.reserve(expectedFrames);
+        cpuStart = std::clock();
+    }
+
+    void AddFrame(double ms)
+    {
+        FrameTimes.push_back(ms);
+    }
+
+    // Nearest-rank percentile over the already sorted frame times
+    static double Percentile(const std::vector<double>& sorted, double p)
+    {
+        if (sorted.empty()) return 0.0;
+        size_t rank = (size_t)std::ceil(p / 100.0 * sorted.size());
+        return sorted[std::min(sorted.size() - 1, rank > 0 ? rank - 1 : 0)];
+    }
+
+    void Report(std::ostream& out = std::cout) const
+    {
+        double cpuSeconds = (double)(std::clock() - cpuStart) / CLOCKS_PER_SEC;
+        std::vector<double> sorted = FrameTimes;
+        std::sort(sorted.begin(), sorted.end());
+
+        double total = 0.0;
+        for (double t : sorted) total += t;
+        double mean = sorted.empty() ? 0.0 : total / sorted.size();
+
+        out << std::fixed << std::setprecision(3)
+            << "frames: " << sorted.size() << "\n"
+            << "frame time (ms): min " << (sorted.empty() ? 0.0 : sorted.front())
+            << "  mean " << mean
+            << "  p50 " << Percentile(sorted, 50.0)
+            << "  p95 " << Percentile(sorted, 95.0)
+            << "  p99 " << Percentile(sorted, 99.0) << "\n"
+            << "total frame time (ms): " << total << "\n"
+            << "total CPU time (s): " << cpuSeconds << std::endl;
+    }
+
+private:
+    std::clock_t cpuStart;
+};
+
+#endif
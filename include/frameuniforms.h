@@ -0,0 +1,49 @@
+#ifndef FRAMEUNIFORMS_H
+#define FRAMEUNIFORMS_H
+
+#include <glad/glad.h>
+#include <glm/glm.hpp>
+#include "shader.h"
+#include "glstate.h"
+
+// Fixed binding point of the FrameUniforms block, every program declaring the block gets bound to it at link time
+const unsigned FRAME_UNIFORMS_BINDING = 0;
+
+// CPU side mirror of the std140 'FrameUniforms' block in the shaders (mat4s need no padding under std140)
+struct FrameUniformData
+{
+    glm::mat4 view;
+    glm::mat4 projection;
+};
+
+// Uniform buffer holding per-frame data shared by all programs, so it is uploaded once per frame rather than once per program
+class FrameUniformBuffer
+{
+public:
+    unsigned UBO;
+
+    FrameUniformBuffer()
+    {
+        Shader::setBlockBinding("FrameUniforms", FRAME_UNIFORMS_BINDING);
+
+        glGenBuffers(1, &UBO);
+        GLState.bindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniformData), NULL, GL_DYNAMIC_DRAW);
+        GLState.bindBuffer(GL_UNIFORM_BUFFER, 0);
+        GLState.bindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORMS_BINDING, UBO);  // Stays bound to the binding point for the app's lifetime
+    }
+    ~FrameUniformBuffer()
+    {
+        GLState.deleteBuffers(1, &UBO);
+    }
+
+    // Writes the whole block, call once per frame before any draws
+    void Update(const FrameUniformData& data)
+    {
+        GLState.bindBuffer(GL_UNIFORM_BUFFER, UBO);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniformData), &data);
+        GLState.bindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+};
+
+#endif
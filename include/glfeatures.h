@@ -0,0 +1,93 @@
+#ifndef GLFEATURES_H
+#define GLFEATURES_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+#include <cstddef>
+
+// GLAD is generated for 3.3 core, so enums/entry points from later versions or extensions are declared here and loaded at runtime
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+#ifndef GL_COMPRESSED_RGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_RGB_S3TC_DXT1_EXT 0x83F0
+#define GL_COMPRESSED_RGBA_S3TC_DXT5_EXT 0x83F3
+#endif
+#ifndef GL_COMPRESSED_SRGB_S3TC_DXT1_EXT
+#define GL_COMPRESSED_SRGB_S3TC_DXT1_EXT 0x8C4C
+#define GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT 0x8C4F
+#endif
+#ifndef GL_COMPRESSED_RGBA_BPTC_UNORM
+#define GL_COMPRESSED_RGBA_BPTC_UNORM 0x8E8C
+#define GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM 0x8E8D
+#endif
+#ifndef GL_DRAW_INDIRECT_BUFFER
+#define GL_DRAW_INDIRECT_BUFFER 0x8F3F
+#endif
+#ifndef GL_MAP_PERSISTENT_BIT
+#define GL_MAP_PERSISTENT_BIT 0x0040
+#define GL_MAP_COHERENT_BIT 0x0080
+#endif
+
+
+// Optional OpenGL features, filled by loadGLFeatures() once a context is current. Entry points are NULL when unsupported
+struct GLFeatures
+{
+    int Major = 3, Minor = 3;   // Context version
+
+    // GL 4.1 / ARB_get_program_binary
+    bool ProgramBinarySupported = false;
+    void (APIENTRY *GetProgramBinary)(GLuint program, GLsizei bufSize, GLsizei* length, GLenum* binaryFormat, void* binary) = NULL;
+    void (APIENTRY *ProgramBinary)(GLuint program, GLenum binaryFormat, const void* binary, GLsizei length) = NULL;
+    void (APIENTRY *ProgramParameteri)(GLuint program, GLenum pname, GLint value) = NULL;
+
+    // GL_KHR_parallel_shader_compile (or the ARB version): compile/link run on driver threads, polled via GL_COMPLETION_STATUS_KHR
+    bool ParallelShaderCompile = false;
+    void (APIENTRY *MaxShaderCompilerThreads)(GLuint count) = NULL;
+
+    // Block compressed texture formats: EXT_texture_compression_s3tc (BC1/BC3, sRGB variants need EXT_texture_sRGB too)
+    // and GL 4.2 / ARB_texture_compression_bptc (BC7)
+    bool TextureCompressionS3TC = false, TextureCompressionS3TCsRGB = false;
+    bool TextureCompressionBPTC = false;
+
+    // GL_ARB_bindless_texture: shaders reach textures through 64-bit handles (from uniforms or buffers) instead of texture units
+    bool BindlessTexture = false;
+    GLuint64 (APIENTRY *GetTextureHandle)(GLuint texture) = NULL;
+    void (APIENTRY *MakeTextureHandleResident)(GLuint64 handle) = NULL;
+    void (APIENTRY *MakeTextureHandleNonResident)(GLuint64 handle) = NULL;
+    // GL_NV_gpu_shader5: among others, samplers built from handles that differ between invocations of one draw (e.g. per
+    // instance) are defined. ARB_bindless_texture alone only guarantees dynamically uniform ones
+    bool GpuShader5NV = false;
+
+    // GL 4.2 / ARB_base_instance: instanced draws whose per-instance attributes start at 'baseinstance' instead of 0
+    bool BaseInstance = false;
+    void (APIENTRY *DrawElementsInstancedBaseVertexBaseInstance)(GLenum mode, GLsizei count, GLenum type, const void* indices,
+                                                                 GLsizei instancecount, GLint basevertex, GLuint baseinstance) = NULL;
+
+    // GL 4.3 / ARB_multi_draw_indirect: any number of indexed draws read from the GL_DRAW_INDIRECT_BUFFER by one call.
+    // Only set along with BaseInstance, the commands' baseInstance is ignored without it
+    bool MultiDrawIndirect = false;
+    void (APIENTRY *MultiDrawElementsIndirect)(GLenum mode, GLenum type, const void* indirect, GLsizei drawcount, GLsizei stride) = NULL;
+
+    // GL 4.4 / ARB_buffer_storage: immutable buffer storage, which can stay mapped (persistent) while the GPU uses it
+    bool BufferStorageSupported = false;
+    void (APIENTRY *BufferStorage)(GLenum target, GLsizeiptr size, const void* data, GLbitfield flags) = NULL;
+};
+extern GLFeatures GLExt;
+
+// Loads the optional entry points with the same loader GLAD was given. Call once after gladLoadGLLoader
+void loadGLFeatures(GLADloadproc load);
+// True if the current context advertises the extension (e.g. "GL_ARB_get_program_binary")
+bool hasGLExtension(const char* name);
+// True if the context version is at least major.minor
+bool hasGLVersion(int major, int minor);
+
+#endif
@@ -0,0 +1,81 @@
+#ifndef GLSTATE_H
+#define GLSTATE_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+#include <cstddef>
+#include "glfeatures.h"
+
+// What the counters are kept per
+enum GLStateKind
+{
+    STATE_PROGRAM,
+    STATE_VERTEX_ARRAY,
+    STATE_BUFFER,           // Generic & indexed buffer bindings
+    STATE_TEXTURE,
+    STATE_ACTIVE_TEXTURE,
+    STATE_CAPABILITY,       // glEnable/glDisable
+    STATE_FIXED_FUNCTION,   // Depth func & mask, blend func, cull face
+    STATE_VIEWPORT,
+    STATE_KIND_COUNT
+};
+
+const int GL_STATE_TEXTURE_UNITS = 16;
+const int GL_STATE_UNIFORM_BINDINGS = 16;
+
+// Shadow of the bindings & fixed function state the app touches, so a call that wouldn't change anything is never made.
+// Every bind in the app goes through here (GL thread only): a bind made around it leaves the shadow stale, call invalidate()
+// after such code. Deleting an object resets bindings to it in GL, so deletes go through here as well.
+// Each call returns true if it reached the driver
+class GLStateCache
+{
+public:
+    bool Enabled = true;    // False: shadow is still tracked, but every call is issued (to measure what the cache saves)
+    size_t Issued[STATE_KIND_COUNT] = {}, Elided[STATE_KIND_COUNT] = {};
+
+    GLStateCache() { invalidate(); }    // Touches no GL, so the global can be constructed before there is a context
+    bool useProgram(unsigned program);
+    bool bindVertexArray(unsigned vao);
+    bool bindBuffer(GLenum target, unsigned buffer);
+    bool bindBufferBase(GLenum target, unsigned index, unsigned buffer);   // Also binds the generic target, like GL does
+    // Selects the unit only if a bind is actually needed
+    bool bindTexture(unsigned unit, GLenum target, unsigned texture);
+    bool enable(GLenum capability, bool enabled);   // GL_DEPTH_TEST, GL_BLEND, GL_CULL_FACE
+    bool depthFunc(GLenum func);
+    bool depthMask(bool write);
+    bool blendFunc(GLenum source, GLenum destination);
+    bool cullFace(GLenum face);
+    bool viewport(int x, int y, int width, int height);
+
+    void deleteTextures(GLsizei count, const unsigned* textures);
+    void deleteBuffers(GLsizei count, const unsigned* buffers);
+    void deleteVertexArrays(GLsizei count, const unsigned* arrays);
+    void deleteProgram(unsigned program);
+
+    // Forgets everything, the next call of each kind is issued
+    void invalidate();
+    void resetCounters();
+    // Issued vs elided calls per kind, averaged over 'frames'
+    void report(int frames) const;
+
+private:
+    static const unsigned UNKNOWN = 0xFFFFFFFF;
+    enum BufferSlot { SLOT_ARRAY, SLOT_ELEMENT_ARRAY, SLOT_UNIFORM, SLOT_PIXEL_UNPACK, SLOT_COPY_READ, SLOT_COPY_WRITE, SLOT_DRAW_INDIRECT, SLOT_COUNT };
+    enum CapabilitySlot { CAP_DEPTH_TEST, CAP_BLEND, CAP_CULL_FACE, CAP_COUNT };
+
+    unsigned program = UNKNOWN, vertexArray = UNKNOWN, activeUnit = UNKNOWN;
+    unsigned buffers[SLOT_COUNT];
+    unsigned uniformBindings[GL_STATE_UNIFORM_BINDINGS];
+    unsigned textures[GL_STATE_TEXTURE_UNITS][2];   // GL_TEXTURE_2D, GL_TEXTURE_2D_ARRAY
+    unsigned capabilities[CAP_COUNT];               // 0/1, or UNKNOWN
+    unsigned depthFuncState = UNKNOWN, depthMaskState = UNKNOWN, blendSource = UNKNOWN, blendDestination = UNKNOWN, cullFaceState = UNKNOWN;
+    int viewportState[4];
+
+    // True if the shadowed value already equals 'value' (counted as elided), else records it and counts an issued call
+    bool same(unsigned& shadow, unsigned value, GLStateKind kind);
+    static int bufferSlot(GLenum target);
+    static int textureSlot(GLenum target);
+    static int capabilitySlot(GLenum capability);
+};
+extern GLStateCache GLState;
+
+#endif
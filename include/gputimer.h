@@ -0,0 +1,79 @@
+#ifndef GPUTIMER_H
+#define GPUTIMER_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+#include <vector>
+#include <cstddef>
+
+// GPU time a pass took in one frame (summed over every time it was begun in that frame)
+struct GpuPassTime
+{
+    const char* Name;
+    double Ms;
+};
+
+// GPU pass timing with GL_TIMESTAMP queries (core since 3.3, also on llvmpipe): each pass writes a timestamp where it begins
+// and one where it ends, so passes can nest and a "frame" pass always spans the whole frame. Every frame in flight has its
+// own pool of query objects: a frame's results are read FRAMES_IN_FLIGHT frames later, when its slot comes round again, and
+// only if the GPU already has them. Otherwise they are dropped (counted) rather than waited for, so nothing ever stalls.
+// GL thread only, pass names are string literals
+class GpuTimer
+{
+public:
+    static const int FRAMES_IN_FLIGHT = 3;
+
+    GpuTimer();     // Needs the GL context
+    ~GpuTimer();
+    GpuTimer(const GpuTimer&) = delete;
+    GpuTimer& operator=(const GpuTimer&) = delete;
+
+    // Collects the results of the frame that last used this frame's slot, then begins the "frame" pass
+    void beginFrame();
+    void beginPass(const char* name);
+    // Ends the innermost pass still open
+    void endPass();
+    // Ends the "frame" pass (and any left open)
+    void endFrame();
+    // Waits for the frames still in flight and collects them too (at exit, so the summary covers every frame)
+    void finish();
+
+    // Passes of the newest frame whose results have arrived (in the order they first began), and which frame that was
+    // (-1 until one has). Frames are numbered from 0 in beginFrame() order
+    const std::vector<GpuPassTime>& lastFrame() const { return resolved; }
+    int lastFrameIndex() const { return resolvedFrame; }
+    // Mean/min/max per pass over every resolved frame
+    void report() const;
+
+private:
+    struct PassRecord
+    {
+        const char* Name;
+        size_t Begin, End;      // Indices into the slot's queries
+    };
+    struct FrameSlot
+    {
+        std::vector<unsigned> Queries;  // Pool, grows to the most a frame needed and is then reused
+        size_t Used = 0;
+        std::vector<PassRecord> Passes;
+        int Frame = -1;                 // -1: holds nothing to read back
+    };
+    struct PassSummary
+    {
+        const char* Name;
+        size_t Frames = 0;
+        double TotalMs = 0.0, MinMs = 0.0, MaxMs = 0.0;
+    };
+
+    FrameSlot slots[FRAMES_IN_FLIGHT];
+    int frame = -1;
+    std::vector<size_t> open;       // Passes begun & not ended yet, innermost last
+    std::vector<GpuPassTime> resolved;
+    int resolvedFrame = -1;
+    std::vector<PassSummary> summaries;
+    size_t droppedFrames = 0;
+
+    size_t timestamp(FrameSlot& slot);
+    void collect(FrameSlot& slot, bool wait);
+};
+
+#endif
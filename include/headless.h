@@ -0,0 +1,35 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+#include <iostream>
+#include <vector>
+
+
+// A window-less OpenGL 3.3 core context plus an offscreen framebuffer to render into.
+// Used for benchmarking on GPU-less machines (e.g. Mesa llvmpipe through EGL surfaceless), so no GLFW window or vsync is involved
+class HeadlessContext
+{
+public:
+    bool Valid = false;     // False if no context could be created, check before loading GLAD
+    unsigned FBO = 0;
+    int Width, Height;
+
+    // Constructor creates the context and makes it current on the calling thread
+    HeadlessContext(int width, int height);
+    // Destructor
+    ~HeadlessContext();
+    // Creates & binds the offscreen FBO (colour + depth renderbuffers). Has to be called after GLAD has been loaded
+    bool createFramebuffer();
+    // Reads back the finished frame as tightly packed RGBA8 rows, bottom row first
+    void readPixels(std::vector<unsigned char>& pixels) const;
+    // Function pointer loader handed to gladLoadGLLoader
+    static void* getProcAddress(const char* name);
+
+private:
+    void* display = NULL;   // Opaque EGL handles so this header doesn't depend on EGL
+    void* context = NULL;
+    unsigned colourRBO = 0, depthRBO = 0;
+};
+
+#endif
@@ -0,0 +1,71 @@
+#ifndef INDIRECTDRAW_H
+#define INDIRECTDRAW_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstddef>
+#include "meshpool.h"
+#include "ringbuffer.h"
+
+// One draw as glMultiDrawElementsIndirect reads it from the GL_DRAW_INDIRECT_BUFFER (the layout is fixed by GL)
+struct DrawElementsIndirectCommand
+{
+    GLuint count;           // Indices
+    GLuint instanceCount;
+    GLuint firstIndex;
+    GLint baseVertex;
+    GLuint baseInstance;    // First record of the draw in the per-draw buffer
+};
+
+// Per-draw data, fed as per-instance attributes at the locations instancedShader.vs reads (model 3-6, material 7)
+struct IndirectDrawRecord
+{
+    glm::mat4 Model;
+    GLint Material;     // See material.h, -1 if none
+};
+
+// Draws any number of meshes of one pool, each with its own model matrix & material, in one glMultiDrawElementsIndirect.
+// Each command's baseInstance points at its record, so the vertex shader gets its per-draw data like any per-instance
+// attribute (no gl_DrawID, so instancedShader.vs works as is). Without GL 4.3 the commands are issued by a loop: with
+// base instance draws on 4.2, on 3.3 by re-pointing the per-draw attributes before each draw.
+// The batch has its own VAO over the pool's buffers, the pool's VAO is left alone
+class IndirectBatch
+{
+public:
+    enum SubmitPath { MULTI_DRAW_INDIRECT, BASE_INSTANCE_LOOP, ATTRIBUTE_LOOP };
+    SubmitPath Path;    // Decided at construction from what the context supports
+
+    IndirectBatch(const MeshPool* pool, bool allowMultiDraw = true);
+    ~IndirectBatch();
+    IndirectBatch(const IndirectBatch&) = delete;
+    IndirectBatch& operator=(const IndirectBatch&) = delete;
+
+    // Starts recording the batch again
+    void clear();
+    // Records one draw of a mesh of the batch's pool
+    void add(const MeshHandle& mesh, const glm::mat4& model, int material = -1);
+    // GL thread: writes the recorded commands & records, once after the last add() of a frame. Into this frame's region of
+    // 'ring' if given (and there's room), else by re-specifying (orphaning) the batch's own buffers
+    void upload(RingBuffer* ring = NULL);
+    // Expects upload() after the last add(). Binds the batch's VAO and issues every command, returns the number of GL draw calls
+    size_t draw() const;
+
+    unsigned vertexArray() const { return VAO; }
+    size_t size() const { return commands.size(); }
+    const char* pathName() const;
+
+private:
+    const MeshPool* pool;
+    unsigned VAO = 0, commandBuffer = 0, recordBuffer = 0;
+    unsigned poolVBO = 0, poolEBO = 0;     // The pool's buffers the VAO was set up for
+    unsigned recordSource = 0, commandSource = 0;   // Where this frame's upload went: the batch's buffers or the ring's
+    size_t recordOffset = 0, commandOffset = 0;
+    std::vector<DrawElementsIndirectCommand> commands;
+    std::vector<IndirectDrawRecord> records;
+
+    // Points the per-draw attributes at this frame's records, starting 'first' records in (expects VAO bound)
+    void configRecordAttributes(size_t first) const;
+};
+
+#endif
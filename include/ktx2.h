@@ -0,0 +1,33 @@
+#ifndef KTX2_H
+#define KTX2_H
+
+#include <string>
+#include <vector>
+#include "texcompress.h"
+
+// Vulkan format numbers KTX2 identifies its payload with (the only ones texbake writes)
+const unsigned VK_FORMAT_BC1_RGB_UNORM_BLOCK = 131;
+const unsigned VK_FORMAT_BC1_RGB_SRGB_BLOCK = 132;
+const unsigned VK_FORMAT_BC3_UNORM_BLOCK = 137;
+const unsigned VK_FORMAT_BC3_SRGB_BLOCK = 138;
+const unsigned VK_FORMAT_BC7_UNORM_BLOCK = 145;
+const unsigned VK_FORMAT_BC7_SRGB_BLOCK = 146;
+
+// A 2D, single layer, single face KTX2 texture without supercompression. Level 0 is the full size image
+struct Ktx2Image
+{
+    unsigned VkFormat = 0;
+    int Width = 0, Height = 0;
+    std::vector<std::vector<unsigned char>> Levels;
+    bool BottomUp = true;   // Row 0 is the bottom row (KTXorientation "ru"), which is what glTexImage2D expects
+};
+
+unsigned ktx2VkFormat(BlockFormat format, bool srgb);
+// Returns false for formats this loader doesn't know
+bool ktx2BlockFormat(unsigned vkFormat, BlockFormat& format, bool& srgb);
+
+// Both print ERROR::KTX2::... and return false on failure
+bool writeKtx2(const std::string& path, const Ktx2Image& image);
+bool readKtx2(const std::string& path, Ktx2Image& image);
+
+#endif
@@ -0,0 +1,68 @@
+#ifndef MATERIAL_H
+#define MATERIAL_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+#include <string>
+#include <vector>
+#include <map>
+#include "shader.h"
+
+const int MAX_MATERIAL_ARRAYS = 4;              // Size groups sampled through texture units 0-3 (materialShader.fs)
+const int MAX_BINDLESS_MATERIAL_ARRAYS = 16;    // Size groups in the bindless handle table (bindlessMaterialShader.fs)
+const unsigned MATERIAL_HANDLES_BINDING = 1;    // Uniform block binding of the bindless handle table
+
+// Which texture array a material lives in and which layer of it. Shaders take it packed into one int, see id()
+struct Material
+{
+    int Array = -1, Layer = 0;
+
+    bool valid() const { return Array >= 0; }
+    // Value of the 'material' uniform / per-instance attribute: array in the high 16 bits, layer in the low 16 (-1 if invalid)
+    int id() const { return valid() ? Array << 16 | Layer : -1; }
+};
+
+// Groups same-size RGBA8 textures into GL_TEXTURE_2D_ARRAY objects, so switching material is a different layer index
+// instead of a texture bind. Every array stays bound for the whole frame: on texture units 0..n-1, or through resident
+// bindless handles in a uniform block when GL 4.0, GL_ARB_bindless_texture & GL_NV_gpu_shader5 are available (then there's
+// nothing to bind at all)
+class MaterialLibrary
+{
+public:
+    bool Bindless;  // Decided at construction: extensions present and allowed
+
+    MaterialLibrary(bool allowBindless = true);
+    ~MaterialLibrary();
+    MaterialLibrary(const MaterialLibrary&) = delete;
+    MaterialLibrary& operator=(const MaterialLibrary&) = delete;
+
+    // Queues a texture (RGBA8 levels, level 0 first, bottom-up) for the array of its size. A texture with an incomplete mip
+    // chain gets it generated from level 0 (generateMipChain's defaults) by build(). Only valid before build()
+    Material add(const std::string& name, int width, int height, std::vector<std::vector<unsigned char>> levels);
+    // Invalid material if there's none with that name
+    Material find(const std::string& name) const;
+    // GL thread: creates the arrays and uploads every layer, frees the CPU copies. Prints ERROR::MATERIAL::... and returns
+    // false if there are more size groups or layers than the shaders/driver can address, or a texture has no level 0
+    bool build();
+    // Binds every array to its texture unit (nothing to do with bindless). Once per frame, before the material draws
+    void bind() const;
+    // Points a program's 'materialArrays' samplers at the units bind() uses. Call after (re)linking it
+    void setupShader(const Shader& shader) const;
+    // Fragment shader matching the binding model
+    const char* fragmentShaderPath() const { return Bindless ? "src/bindlessMaterialShader.fs" : "src/materialShader.fs"; }
+    size_t count() const { return materials.size(); }
+    size_t arrayCount() const { return arrays.size(); }
+
+private:
+    struct TextureArray
+    {
+        int width, height;
+        std::vector<std::vector<std::vector<unsigned char>>> layers;    // Levels of every layer, until build()
+        unsigned texture = 0;
+        GLuint64 handle = 0;
+    };
+    std::vector<TextureArray> arrays;
+    std::map<std::string, Material> materials;
+    unsigned handleUBO = 0;
+};
+
+#endif
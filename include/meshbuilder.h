@@ -0,0 +1,39 @@
+#ifndef MESHBUILDER_H
+#define MESHBUILDER_H
+
+#include <vector>
+#include <string>
+#include <cstddef>
+
+// Indexed triangle list with interleaved float vertices (e.g. 5 floats: position xyz + uv, as configBuffers() expects)
+struct MeshData
+{
+    std::vector<float> Vertices;
+    std::vector<unsigned> Indices;
+    int FloatsPerVertex = 0;
+
+    size_t VertexCount() const { return FloatsPerVertex ? Vertices.size() / FloatsPerVertex : 0; }
+};
+
+// Post-transform vertex cache efficiency of an index buffer, measured with a FIFO cache simulation
+struct VertexCacheStats
+{
+    float ACMR;     // Average cache miss ratio: vertex shader invocations per triangle (0.5 is the ideal for big grids, 3 is no reuse)
+    float ATVR;     // Average transform to vertex ratio: invocations per unique vertex (1 is optimal)
+};
+
+const int VERTEX_CACHE_SIZE = 16;   // Cache size assumed by the optimizer and the stats, conservative for current GPUs
+
+// Welds bit-identical vertices of a non-indexed triangle list into a unique vertex buffer plus an index buffer
+MeshData weldVertices(const std::vector<float>& vertices, int floatsPerVertex);
+// Reorders triangles for the post-transform vertex cache using Tipsify (Sander, Nehab & Barczak 2007)
+void optimizeVertexCache(std::vector<unsigned>& indices, size_t vertexCount, int cacheSize = VERTEX_CACHE_SIZE);
+// Reorders (and compacts) vertices into first-use order so vertex fetch walks memory mostly linearly
+void optimizeVertexFetch(MeshData& mesh);
+// Simulates a FIFO post-transform cache over the index buffer
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned>& indices, size_t vertexCount, int cacheSize = VERTEX_CACHE_SIZE);
+
+// Full pipeline: weld, optimize for the vertex cache, then for fetch. Prints ACMR/ATVR before & after if 'name' is given
+MeshData buildMesh(const std::vector<float>& vertices, int floatsPerVertex, const char* name = NULL);
+
+#endif
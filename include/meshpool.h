@@ -0,0 +1,76 @@
+#ifndef MESHPOOL_H
+#define MESHPOOL_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+#include <vector>
+#include <map>
+#include <cstddef>
+#include "meshbuilder.h"
+
+
+// Hands out [offset, offset + size) ranges of a fixed capacity, first-fit over an address ordered free list that coalesces on free
+class RangeAllocator
+{
+public:
+    size_t Capacity = 0;
+    size_t Used = 0;
+
+    RangeAllocator(size_t capacity = 0);
+    // Returns false (offset untouched) if no free range is big enough
+    bool allocate(size_t size, size_t& offset);
+    void free(size_t offset, size_t size);
+    // Adds capacity at the end, merging it into a trailing free range if there is one
+    void grow(size_t newCapacity);
+
+private:
+    std::map<size_t, size_t> freeRanges;    // offset -> size
+};
+
+// One vertex attribute of a pool's format, laid out interleaved in declaration order
+struct VertexAttribute
+{
+    unsigned location;
+    int components;     // Floats
+};
+
+// Where a mesh lives inside a MeshPool. Draws use baseVertex, so its indices stay relative to its own vertices
+struct MeshHandle
+{
+    GLint baseVertex = 0;
+    unsigned firstIndex = 0;
+    GLsizei indexCount = 0;
+    unsigned vertexCount = 0;
+
+    bool valid() const { return indexCount > 0; }
+};
+
+// All meshes of one vertex format share one VBO, one EBO and one VAO, so switching meshes is just a different draw range
+class MeshPool
+{
+public:
+    unsigned VAO, VBO, EBO;
+    std::vector<VertexAttribute> Format;
+    int FloatsPerVertex;
+
+    // Capacities are in vertices/indices, the buffers double in size when they run out
+    MeshPool(const std::vector<VertexAttribute>& format, size_t vertexCapacity = 1 << 16, size_t indexCapacity = 1 << 18);
+    ~MeshPool();
+    // Uploads the mesh into free ranges of the shared buffers, mesh.FloatsPerVertex has to match the pool's format
+    MeshHandle add(const MeshData& mesh);
+    void remove(MeshHandle& handle);
+    // Bind once, then draw any number of meshes of this pool without rebinding
+    void bind() const;
+    void draw(const MeshHandle& handle) const;
+    void drawInstanced(const MeshHandle& handle, GLsizei instanceCount) const;
+    // Expects a VAO bound: points the format's attributes at VBO. Also sets up other VAOs over the pool's buffers (which
+    // have to redo it whenever VBO changes, the buffers are replaced when they grow)
+    void configAttributes() const;
+
+private:
+    RangeAllocator vertexRanges, indexRanges;
+
+    // Reallocates 'buffer' with a bigger size and copies the old contents over on the GPU
+    static void growBuffer(unsigned& buffer, size_t oldBytes, size_t newBytes);
+};
+
+#endif
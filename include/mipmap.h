@@ -0,0 +1,43 @@
+#ifndef MIPMAP_H
+#define MIPMAP_H
+
+#include <vector>
+
+// CPU mip chain generation, so filter quality & cost don't depend on the driver's glGenerateMipmap.
+// Levels follow GL's sizing (each is max(1, floor(previous / 2))), NPOT levels are filtered with fractional footprints so no
+// source texel is dropped or over-weighted. Filtering runs in float, each level from the previous one without requantizing
+enum MipFilter
+{
+    MIP_FILTER_BOX,     // Exact area average of the source footprint
+    MIP_FILTER_KAISER   // Kaiser windowed sinc (3 texel radius, alpha 4), sharper with slight ringing
+};
+
+// Instruction set for the filter loops. BEST picks the widest one the CPU supports at runtime
+enum MipSimd
+{
+    MIP_SIMD_SCALAR,
+    MIP_SIMD_SSE2,
+    MIP_SIMD_AVX2,
+    MIP_SIMD_BEST
+};
+
+struct MipOptions
+{
+    MipFilter Filter = MIP_FILTER_BOX;
+    bool Srgb = true;   // Colour channels are sRGB encoded: filter in linear light (alpha is always linear)
+    MipSimd Simd = MIP_SIMD_BEST;
+};
+
+struct MipLevel
+{
+    int Width, Height;
+    std::vector<unsigned char> Pixels;  // Tightly packed, same channel count as the source
+};
+
+// Levels 1..n down to 1x1 (level 0 is the source itself, not copied). 'channels' is 1 (R8), 3 (RGB8) or 4 (RGBA8)
+std::vector<MipLevel> generateMipChain(const unsigned char* pixels, int width, int height, int channels, const MipOptions& options = MipOptions());
+// What MIP_SIMD_BEST resolves to on this CPU
+MipSimd detectMipSimd();
+const char* mipSimdName(MipSimd simd);
+
+#endif
@@ -0,0 +1,63 @@
+#ifndef OCCLUSION_H
+#define OCCLUSION_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "meshbuilder.h"
+#include "culling.h"
+#include "workerpool.h"
+#include "tiledraster.h"
+
+// What the last frame's occlusion pass did and cost
+struct OcclusionStats
+{
+    size_t OccluderTriangles = 0;   // Rasterized (after near plane & off-screen rejection)
+    size_t Tested = 0, Occluded = 0;
+    double RasterMs = 0.0, TestMs = 0.0;
+};
+
+// Low resolution CPU depth buffer for occlusion culling. Each frame a few designated occluders (big, simple meshes: walls,
+// floors) are rasterized into it, then objects' world AABBs are tested against a max-depth pyramid of it before anything
+// is submitted to GL.
+// Triangles are binned into 32x32 tiles and the tiles rasterized in parallel by the tiled edge-function rasterizer the
+// software backend uses too, keeping the nearest depth per pixel. Coverage is sampled at pixel centers, so an object
+// peeking out less than a pixel of this buffer from behind an occluder's edge can be culled. Occluder triangles crossing
+// the near plane are skipped, which only loses occlusion
+class OcclusionBuffer
+{
+public:
+    OcclusionStats Stats;
+
+    OcclusionBuffer(int width = 256, int height = 128, WorkerPool* pool = NULL);   // Single threaded without a pool
+
+    // Starts a frame: clears the depth and the occluders
+    void begin(const glm::mat4& viewProjection);
+    // Queues a mesh's triangles (positions are the first 3 floats of each vertex) placed by 'model'
+    void addOccluder(const MeshData& mesh, const glm::mat4& model);
+    // Bins & rasterizes the queued occluders, then builds the max-depth pyramid. Once per frame, before any test
+    void rasterize();
+    // False if the whole world space box is behind what was rasterized
+    bool visible(const glm::vec3& center, const glm::vec3& extent) const;
+    // Keeps only the indices in 'indices' whose bounds are visible, returns how many are left
+    size_t cull(const CullingBounds& bounds, std::vector<uint32_t>& indices);
+
+    int width() const { return Width; }
+    int height() const { return Height; }
+    // Nearest depth per pixel, [0, 1] with 1 the far plane (row 0 at the bottom, like GL)
+    const std::vector<float>& depth() const { return levels[0]; }
+
+private:
+    int Width, Height;
+    RasterTiles tiles;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    std::vector<RasterTriangle> triangles;
+    std::vector<std::vector<float>> levels;     // levels[0] the depth buffer, then each half the size, keeping the max
+    std::vector<int> levelWidths, levelHeights;
+
+    void rasterizeTile(int tile);
+    void buildPyramid();
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Build with -DPROFILER_ENABLED=0 and every PROFILE_* macro compiles to nothing
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// One finished zone. The name is a string literal, only its pointer is kept
+struct ProfileEvent
+{
+    const char* Name;
+    uint64_t Start, End;    // Nanoseconds of the steady clock
+};
+
+// Zones recorded by one thread. Only that thread writes (no locks, no allocation: a full ring overwrites its oldest events),
+// Head is published after each event so another thread can copy the ring out while it keeps going
+struct ProfileThreadBuffer
+{
+    static const size_t CAPACITY = 1 << 16;     // Power of 2, ~1.5 MB per thread
+
+    std::unique_ptr<ProfileEvent[]> Events{new ProfileEvent[CAPACITY]};
+    std::atomic<uint64_t> Head{0};              // Events ever recorded
+    unsigned ThreadIndex = 0;
+    const char* ThreadName = NULL;
+};
+
+// CPU zone profiler: PROFILE_SCOPE("name") times the rest of the enclosing block into the calling thread's ring, which it
+// gets (allocated & registered, once) the first time it records. Nothing is recorded until Recording is set, after that a
+// zone costs two clock reads and one ring write. writeChromeTrace() can run at any time, from any thread, and writes what
+// the rings still hold as Chrome trace_event JSON (chrome://tracing, ui.perfetto.dev)
+class CpuProfiler
+{
+public:
+    std::atomic<bool> Recording{false};
+
+    static uint64_t now()
+    {
+        return (uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+    void record(const char* name, uint64_t start, uint64_t end);
+    // Shown instead of "thread N" in the trace. Call from the thread itself, with a string literal, after Recording is set
+    void setThreadName(const char* name);
+    // Returns how many events were written, or -1 if the file couldn't be
+    long writeChromeTrace(const char* path);
+
+private:
+    std::mutex mutex;       // Guards 'threads' (registration & dumps only, never recording)
+    std::vector<std::unique_ptr<ProfileThreadBuffer>> threads;     // Kept after their thread exits, so its events can still be dumped
+
+    ProfileThreadBuffer* threadBuffer();
+};
+
+extern CpuProfiler Profiler;
+
+// Times its own lifetime
+class ProfileZone
+{
+public:
+    ProfileZone(const char* name) : name(name), start(Profiler.Recording.load(std::memory_order_relaxed) ? CpuProfiler::now() : 0) {}
+    ~ProfileZone()
+    {
+        if (start)
+            Profiler.record(name, start, CpuProfiler::now());
+    }
+    ProfileZone(const ProfileZone&) = delete;
+    ProfileZone& operator=(const ProfileZone&) = delete;
+
+private:
+    const char* name;
+    uint64_t start;
+};
+
+#if PROFILER_ENABLED
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name) ProfileZone PROFILE_CONCAT(profileZone, __LINE__)(name)
+#define PROFILE_THREAD(name) Profiler.setThreadName(name)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_THREAD(name) ((void)0)
+#endif
+
+#endif
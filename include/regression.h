@@ -0,0 +1,69 @@
+#ifndef REGRESSION_H
+#define REGRESSION_H
+
+#include <glm/glm.hpp>
+#include <string>
+#include <vector>
+#include "camera.h"
+
+// A fixed camera pose the scene is rendered & compared from
+struct RegressionPose
+{
+    const char* Name;
+    glm::vec3 Position;
+    float Yaw, Pitch;
+};
+
+// A pixel differs when its CIE76 colour difference is past this (~ a just noticeable difference), and an image fails when
+// more than MAX_DIFF_FRACTION of its pixels differ. Tolerates filtering & edge rounding differences, not a missing object
+const float REGRESSION_MAX_DELTA_E = 2.3f;
+const double REGRESSION_MAX_DIFF_FRACTION = 0.001;
+
+// Golden image & performance regression run: renders every pose for a fixed number of frames, compares the last frame of each
+// against a reference PNG (<backend>_<pose>.png in the directory), and its median frame time & draw calls against a
+// baseline (<backend>_baseline.json). Results always go to <backend>_results.json, failing frames to <backend>_<pose>_actual.png.
+// With 'update' the references & baseline are (re)written instead of compared. References only mean something for the
+// renderer that made them (llvmpipe & a GPU rasterize edges differently), and frame times for the machine that recorded
+// them: a baseline pose without "p50_ms" only has its draw calls compared. tests/regression holds the software
+// backend's references (deterministic, no driver involved) and says how CI runs against them
+class RegressionRun
+{
+public:
+    static const std::vector<RegressionPose> Poses;
+
+    // thresholdPercent: how much slower than the baseline a pose's median frame time may get before it fails
+    RegressionRun(const std::string& directory, const std::string& backend, int framesPerPose, bool update, double thresholdPercent);
+
+    // Frames the whole run takes (every pose's)
+    int totalFrames() const { return framesPerPose * (int)Poses.size(); }
+    // Before rendering 'frame': moves the camera to the pose starting there, if one does
+    void beginFrame(int frame, Camera& camera) const;
+    // True for the last frame of a pose, whose pixels endFrame() wants
+    bool captureFrame(int frame) const { return frame % framesPerPose == framesPerPose - 1; }
+    // After 'frame' finished: its time & draw calls, and on capture frames its RGBA8 pixels (bottom row first)
+    void endFrame(int frame, double ms, int drawCalls, const std::vector<unsigned char>* pixels, int width, int height);
+    // Compares (or writes) everything, prints a line per pose. False if any pose regressed or a reference is missing
+    bool finish();
+
+private:
+    struct PoseResult
+    {
+        std::vector<double> FrameTimes;
+        int DrawCalls = 0;
+        std::vector<unsigned char> Pixels;
+        int Width = 0, Height = 0;
+    };
+
+    std::string directory, backend;
+    int framesPerPose;
+    bool update;
+    double thresholdPercent;
+    std::vector<PoseResult> results;
+
+    std::string path(const std::string& name) const { return directory + "/" + backend + "_" + name; }
+};
+
+// Writes RGBA8 pixels (bottom row first, like GL) as an uncompressed PNG
+bool writePng(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef RENDERQUEUE_H
+#define RENDERQUEUE_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+#include <glm/glm.hpp>
+#include <vector>
+#include <map>
+#include <cstdint>
+#include "shader.h"
+#include "meshpool.h"
+#include "indirectdraw.h"
+#include "gputimer.h"
+
+// Everything needed to issue one draw. Submitters fill these in any order, the queue decides the order they're drawn in
+struct DrawPacket
+{
+    unsigned Pass = 0;          // Passes draw in increasing order (0-15)
+    bool Transparent = false;   // Drawn after the pass's opaque draws, back to front
+    Shader* Program = NULL;
+    unsigned Texture = 0;       // GL_TEXTURE_2D for unit 0, 0 leaves the units alone (e.g. material arrays bound for the frame)
+    int Material = -1;          // Value for the program's 'material' uniform (see material.h), -1 if it has none
+    const MeshPool* Pool = NULL;
+    MeshHandle Mesh;
+    glm::mat4 Model = glm::mat4(1.0f);  // For the program's 'model' uniform, and the draw's depth
+    GLsizei Instances = 0;      // > 0: one instanced draw, the program reads per-instance data from the pool's VAO
+    const IndirectBatch* Batch = NULL;  // Set: draws the whole (uploaded) batch instead, Mesh/Model/Instances are unused
+    const char* Timing = NULL;  // GPU timer pass the draw is timed under (string literal), NULL: none
+};
+
+// Per-frame counts of what execute() issued. A switch is a bind that actually changed the state
+struct RenderQueueStats
+{
+    size_t Draws = 0;
+    size_t ProgramSwitches = 0, TextureSwitches = 0, VaoSwitches = 0;
+    size_t UniformUploads = 0;
+};
+
+// Sort key, most significant field first. Opaque draws are grouped by state and go front to back within a group (early-z),
+// transparent ones go strictly back to front with state only breaking ties:
+//   opaque       pass:4 | 0 | program:8 | material:16 | mesh:11 | depth:24
+//   transparent  pass:4 | 1 | inverted depth:24 | program:8 | material:16 | mesh:11
+// Program/material/mesh are small ids the queue hands out on first sight. Ids past a field's range wrap, which only costs
+// some grouping: execute() compares real state, never ids
+class RenderQueue
+{
+public:
+    RenderQueueStats Stats;     // Of the last execute()
+    GpuTimer* Timer = NULL;     // Set: execute() times runs of draws with the same DrawPacket::Timing as that pass
+
+    // Starts a frame: drops last frame's packets. Depth is the view space distance, quantized over [0, farPlane]
+    void begin(const glm::mat4& view, float farPlane);
+    void submit(const DrawPacket& packet);
+    // Radix sorts the packets by key and issues them, skipping binds that wouldn't change anything
+    void execute();
+    size_t size() const { return packets.size(); }
+
+    static uint64_t makeKey(unsigned pass, bool transparent, unsigned program, unsigned material, unsigned mesh, float depth01);
+
+private:
+    struct SortEntry
+    {
+        uint64_t key;
+        uint32_t index;
+    };
+    // 'model' & 'material' locations of a program, re-resolved when its ID changes (hot reload)
+    struct ProgramUniforms
+    {
+        unsigned id = 0;
+        GLint model = -1, material = -1;
+    };
+
+    std::vector<DrawPacket> packets;
+    std::vector<SortEntry> entries, scratch;
+    glm::mat4 view = glm::mat4(1.0f);
+    float farPlane = 100.0f;
+
+    std::map<const Shader*, unsigned> programIds;
+    std::map<std::pair<unsigned, int>, unsigned> materialIds;     // (texture, material)
+    std::map<std::pair<const MeshPool*, GLint>, unsigned> meshIds; // (pool, base vertex)
+    std::map<const Shader*, ProgramUniforms> uniforms;
+
+    template <typename Key> static unsigned idFor(std::map<Key, unsigned>& ids, const Key& key);
+    const ProgramUniforms& uniformsFor(const Shader* program);
+    // LSD radix sort of 'entries' by key, 8 bits per pass, passes where every key has the same digit are skipped
+    void radixSort();
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+#include <vector>
+#include <cstddef>
+
+// What the fences cost, to size the ring: a wait means the GPU was still reading the region a new frame wanted to write
+struct RingBufferStats
+{
+    size_t Frames = 0;
+    size_t Waits = 0;           // Frames whose region wasn't free yet
+    double WaitMs = 0.0, MaxWaitMs = 0.0;
+    size_t Allocations = 0, Bytes = 0;
+    size_t Overflows = 0;       // Allocations that didn't fit in their frame's region
+};
+
+// Streams per-frame data (instance records, indirect commands...) through one buffer split into 'regions' equal parts,
+// one per frame in flight: frame N writes region N % regions while the GPU may still read the ones before. A fence per
+// region, set after the frame's draws, says when it can be written again.
+// GL 4.4 / ARB_buffer_storage: the buffer is persistently & coherently mapped once, writes land straight in it.
+// GL 3.3: each frame's region is mapped unsynchronized (the fence already did the syncing) and unmapped before the draws.
+// Per frame: beginFrame(), allocate()s & writes, flush(), the draws reading it, endFrame()
+class RingBuffer
+{
+public:
+    unsigned Buffer = 0;
+    bool Persistent;            // Decided at construction: extension present and allowed
+    RingBufferStats Stats;
+
+    RingBuffer(size_t regionBytes, int regions = 3, bool allowPersistent = true);
+    ~RingBuffer();
+    RingBuffer(const RingBuffer&) = delete;
+    RingBuffer& operator=(const RingBuffer&) = delete;
+
+    // Moves on to the next region, waiting for its fence if the GPU isn't done with it
+    void beginFrame();
+    // 'bytes' of this frame's region at an 'alignment' multiple: returns where to write them and sets 'offset' (into Buffer).
+    // NULL if the region is full, the caller has to get its data to the GPU some other way
+    void* allocate(size_t bytes, size_t alignment, size_t& offset);
+    // After the frame's writes, before any draw reads them
+    void flush();
+    // After the frame's last draw reading the region
+    void endFrame();
+
+    size_t regionBytes() const { return regionSize; }
+    int regionCount() const { return (int)fences.size(); }
+    void report() const;
+
+private:
+    size_t regionSize;
+    int region = -1;            // Being written this frame
+    size_t used = 0;            // In the current region
+    unsigned char* mapped = NULL;   // Whole buffer (persistent), or the current region from mappedStart on (3.3, until flush())
+    size_t mappedStart = 0;
+    std::vector<GLsync> fences;
+};
+
+#endif
@@ -6,24 +6,90 @@
 #include <fstream>
 #include <sstream>
 #include <iostream>
+#include <vector>
+#include <chrono>
   
 
+class AssetPack;
+
+// Resolved uniform location, fetched once via Shader::uniform() so the per-draw setters skip the name lookup
+struct UniformHandle
+{
+    GLint location = -1;
+    bool valid() const { return location >= 0; }
+};
+
+// One active uniform of a linked program, as reported by glGetActiveUniform
+struct UniformInfo
+{
+    std::string name;   // Array uniforms are stored without their "[0]" suffix
+    GLint location;
+    GLenum type;
+    GLint size;         // Array length, 1 for non-arrays
+};
+
+
 class Shader
 {
 public:
     unsigned int ID;
+    std::string VertexPath, FragmentPath;
+    std::vector<UniformInfo> Uniforms;  // Flat table of active uniforms, filled at link time
+    static unsigned long StringLookups; // Debug counter of name-based setter calls, these should be kept off the per-draw path
+    static std::string CacheDirectory;  // Where linked program binaries are cached between runs, empty disables the cache
   
     // Constructor reads and builds the shader
     Shader(const char* vertexPath, const char* fragmentPath);
+    // Builds from ASSET_SHADER sources in a pack (no hot reload, the pack is read-only)
+    Shader(const AssetPack& pack, const char* vertexName, const char* fragmentName);
     // Destructor
     ~Shader();
     // Aactivate the shader
     void use();
-    // Utility uniform functions
+    // Hot reload: re-reads the source files and starts building a replacement program without waiting for it
+    void beginReload();
+    // Swaps the replacement in once the driver has linked it, so call between frames. Never blocks on the link when
+    // GL_KHR_parallel_shader_compile is available. Returns true if ID changed (uniform handles have to be re-resolved)
+    bool pollReload();
+    // Registers the binding point for a named uniform block, applied to every program declaring it when it is (re)linked
+    static void setBlockBinding(const std::string &blockName, unsigned binding);
+    // Looks up a uniform in the reflected table, returns an invalid handle if the program has no such active uniform
+    UniformHandle uniform(const std::string &name) const;
+    // Utility uniform functions (name based, each call counts towards StringLookups)
     void setBool(const std::string &name, bool value) const;  
     void setInt(const std::string &name, int value) const;   
     void setFloat(const std::string &name, float value) const;
     void setMat4(const std::string &name, bool transpose, const GLfloat* value) const;
+    // Handle based uniform functions, for the hot path
+    void setBool(UniformHandle handle, bool value) const;
+    void setInt(UniformHandle handle, int value) const;
+    void setFloat(UniformHandle handle, float value) const;
+    void setMat4(UniformHandle handle, bool transpose, const GLfloat* value) const;
+
+private:
+    unsigned pendingID = 0, pendingVertex = 0, pendingFragment = 0;    // Replacement program being built by beginReload()
+    std::string pendingCachePath;
+    bool reloadQueued = false;      // Files changed again while a rebuild was in flight
+    std::chrono::steady_clock::time_point pendingStart;
+    bool fromPack = false;
+
+    // Binary cache lookup or compile, then reflection. Shared by both constructors
+    void build(const char* vertexCode, size_t vertexLength, const char* fragmentCode, size_t fragmentLength);
+    // Compiles & links the program from GLSL source into ID, returns false on failure
+    bool buildFromSource(const char* vShaderCode, size_t vLength, const char* fShaderCode, size_t fLength);
+    // Issues the compile/link commands for a new program, finishBuild() then checks (and waits on) the results
+    static unsigned startBuild(const char* vShaderCode, size_t vLength, const char* fShaderCode, size_t fLength, unsigned &vertex, unsigned &fragment);
+    static bool finishBuild(unsigned program, unsigned vertex, unsigned fragment);
+    // Cache file for this pair of sources on the current driver, empty if caching is off/unsupported
+    std::string binaryCachePath(const char* vertexCode, size_t vertexLength, const char* fragmentCode, size_t fragmentLength) const;
+    // Creates ID from a cached program binary, returns false if there is none or the driver rejects it
+    bool loadBinary(const std::string &cachePath);
+    void saveBinary(const std::string &cachePath) const;
+    static std::vector<std::pair<std::string, unsigned>> blockBindings;
+
+    // Enumerates the active uniforms of the linked program into the Uniforms table and binds registered uniform blocks
+    void reflectUniforms();
+    GLint lookupLocation(const std::string &name) const;
 };
   
 #endif
\ No newline at end of file
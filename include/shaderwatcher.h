@@ -0,0 +1,43 @@
+#ifndef SHADERWATCHER_H
+#define SHADERWATCHER_H
+
+#include <string>
+#include <vector>
+#include <chrono>
+#include <filesystem>
+#include "shader.h"
+
+
+// Watches the source files of registered shaders and rebuilds them in the background when they change.
+// Uses inotify on Linux, elsewhere it falls back to polling the file modification times a few times a second
+class ShaderWatcher
+{
+public:
+    ShaderWatcher();
+    ~ShaderWatcher();
+    // Starts watching shader->VertexPath and shader->FragmentPath. The shader has to outlive the watcher (or be removed first)
+    void add(Shader* shader);
+    void remove(Shader* shader);
+    // Call once per frame, before rendering: kicks off rebuilds for changed files and swaps in programs that finished linking.
+    // Returns the shaders whose program changed this frame, so their uniform handles can be re-resolved
+    std::vector<Shader*> update();
+
+private:
+    struct WatchedFile
+    {
+        std::string path;
+        Shader* shader;
+        std::filesystem::file_time_type lastWrite;  // Only used by the polling fallback
+    };
+    std::vector<WatchedFile> files;
+    std::vector<Shader*> shaders;
+    int inotifyFD = -1;
+    std::vector<std::pair<int, std::string>> watchedDirs;   // inotify watch descriptor -> directory
+    std::chrono::steady_clock::time_point lastPoll;
+
+    void watchFile(const std::string& path, Shader* shader);
+    // Collects the shaders with at least one changed source file since the last call
+    void collectChanged(std::vector<Shader*>& changed);
+};
+
+#endif
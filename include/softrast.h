@@ -0,0 +1,93 @@
+#ifndef SOFTRAST_H
+#define SOFTRAST_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include "meshbuilder.h"
+#include "mipmap.h"
+#include "workerpool.h"
+#include "tiledraster.h"
+
+// RGBA8 texture with its whole mip chain, the same levels the GL path uploads (level 0 is the image, bottom row first)
+struct SoftTexture
+{
+    std::vector<MipLevel> Levels;
+    bool Repeat = true;     // GL_REPEAT, else GL_CLAMP_TO_EDGE
+    bool Mipmapped = true;  // GL_LINEAR_MIPMAP_LINEAR when minified, else GL_LINEAR from level 0 only
+};
+
+// Decodes an image (flipped bottom-up, like the texture loader) and builds its mip chain with the CPU generator
+bool loadSoftTexture(const char* path, SoftTexture& texture, const MipOptions& options = MipOptions());
+
+// What the last frame cost the software rasterizer
+struct SoftRasterStats
+{
+    size_t Triangles = 0;       // Submitted
+    size_t Rasterized = 0;      // Set up for rasterization: after rejection, plus the extra ones clipping split off
+    size_t Binned = 0;          // Triangle & tile pairs
+    size_t Fragments = 0;       // That passed the depth test and were shaded
+    double GeometryMs = 0.0, RasterMs = 0.0;
+};
+
+// CPU backend for the scene's plain (non-material) programs, for machines without any GL driver. draw() runs what
+// vertexShader.vs does (projection * view * model on position + UV meshes, as configBuffers() lays them out), clips against
+// the near & far planes (and a guard band, so x/y rarely need it), then bins the triangles into 32x32 tiles. finish()
+// rasterizes the tiles in parallel with the tiled edge-function rasterizer occlusion culling uses too: depth test 4 pixels
+// at a time (GL_LESS, top-left fill rule), then fragmentShader.fs's texture() for the covered ones: perspective-correct UVs, bilinear or trilinear filtering with
+// the LOD from the UVs' exact screen derivatives. Blending, face culling & multisampling are not implemented
+class SoftRasterizer
+{
+public:
+    SoftRasterStats Stats;
+
+    SoftRasterizer(int width, int height, WorkerPool* pool = NULL);    // Single threaded without a pool
+
+    // Starts a frame: every draw until finish() uses this view & projection, and the tiles are cleared first
+    void begin(const glm::mat4& view, const glm::mat4& projection, const glm::vec4& clearColour);
+    // Transforms, clips & bins the mesh's triangles. The texture has to stay alive until finish()
+    void draw(const MeshData& mesh, const glm::mat4& model, const SoftTexture* texture);
+    // Clears & rasterizes every tile, in submission order within each
+    void finish();
+
+    int width() const { return Width; }
+    int height() const { return Height; }
+    // The finished frame as tightly packed RGBA8 rows, bottom row first (like glReadPixels)
+    void readPixels(std::vector<unsigned char>& pixels) const;
+
+private:
+    static constexpr float GUARD_BAND = 4.0f;  // x & y are clipped only past 4x the viewport
+
+    // What a rasterized triangle's fragments need besides its RasterTriangle: planes of what is interpolated linearly in
+    // screen space, 1/w and the UVs over w
+    struct TriangleShading
+    {
+        float qA, qB, qC;       // 1/w
+        float uA, uB, uC;       // u/w
+        float vA, vB, vC;       // v/w
+        const SoftTexture* texture;
+    };
+    struct ClipVertex
+    {
+        glm::vec4 Position;
+        glm::vec2 UV;
+    };
+
+    int Width, Height, stride;     // Rows are padded to 4 pixels
+    RasterTiles tiles;
+    glm::mat4 viewProjection = glm::mat4(1.0f);
+    uint32_t clearValue = 0;
+    std::vector<uint32_t> colour;       // RGBA8, R in the lowest byte
+    std::vector<float> depth;
+    std::vector<RasterTriangle> triangles;
+    std::vector<TriangleShading> shading;       // Per triangle
+    std::vector<size_t> tileFragments;          // Per tile, so the workers never share a counter
+
+    void clipTriangle(const ClipVertex corners[3], const SoftTexture* texture);
+    void setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, const SoftTexture* texture);
+    void rasterizeTile(int tile);
+    uint32_t shade(const TriangleShading& triangle, float px, float py) const;   // RGBA8 of a covered pixel center
+};
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef TEXCOMPRESS_H
+#define TEXCOMPRESS_H
+
+#include <vector>
+#include <cstddef>
+
+// CPU block compression (BCn / S3TC / BPTC). Every format works on 4x4 texel blocks of RGBA8 input:
+//   BC1 - 8 bytes/block, RGB only (always 4-colour mode, no punch-through alpha)
+//   BC3 - 16 bytes/block, BC1 colour + interpolated 8-bit alpha
+//   BC7 - 16 bytes/block, mode 6 only (one subset, RGBA with 7-bit endpoints + p-bits and 4-bit indices)
+// The decoders are there for quality checks and as a fallback when the driver can't sample a format.
+// The BC7 decoder only understands mode 6, the only mode the encoder emits
+enum BlockFormat
+{
+    BLOCK_BC1,
+    BLOCK_BC3,
+    BLOCK_BC7
+};
+
+size_t blockBytes(BlockFormat format);
+// Size of one image (or mip level) in the given format, partial blocks at the edges are padded to 4x4
+size_t compressedSize(BlockFormat format, int width, int height);
+
+// Single blocks, 'rgba' is 16 texels (64 bytes) in row-major order
+void encodeBlockBC1(const unsigned char* rgba, unsigned char* block);
+void encodeBlockBC3(const unsigned char* rgba, unsigned char* block);
+void encodeBlockBC7(const unsigned char* rgba, unsigned char* block);
+void decodeBlockBC1(const unsigned char* block, unsigned char* rgba);
+void decodeBlockBC3(const unsigned char* block, unsigned char* rgba);
+void decodeBlockBC7(const unsigned char* block, unsigned char* rgba);
+
+// Whole images (RGBA8, tightly packed rows). Compression splits block rows across 'threads' (0 = hardware thread count)
+std::vector<unsigned char> compressImage(const unsigned char* rgba, int width, int height, BlockFormat format, unsigned threads = 0);
+std::vector<unsigned char> decompressImage(const unsigned char* blocks, int width, int height, BlockFormat format);
+
+// Peak signal-to-noise ratio in dB over the first 'channels' channels of two RGBA8 images (higher is better, identical = 99)
+double computePSNR(const unsigned char* a, const unsigned char* b, size_t texels, int channels = 4);
+
+#endif
@@ -0,0 +1,161 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <glad/glad.h> // include glad to get all the required OpenGL headers
+#include <string>
+#include <vector>
+#include <deque>
+#include <map>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include "mipmap.h"
+
+class AssetPack;
+
+
+// A GL texture object, deleted when the last Texture sharing it is released
+struct TextureObject
+{
+    unsigned ID = 0;
+    size_t Bytes = 0;   // Approximate VRAM footprint, mip chain included
+
+    TextureObject();
+    ~TextureObject();
+};
+
+// What load() hands out. Several Textures can share one TextureObject once their decoded contents turn out to be identical
+struct Texture
+{
+    std::shared_ptr<TextureObject> Object;
+    int Width = 1, Height = 1;
+    bool Resident = false;  // False while the placeholder is shown
+    size_t pendingShares = 0;   // Path cache hits that arrived while it was still loading (for the stats)
+
+    unsigned id() const { return Object->ID; }
+};
+typedef std::shared_ptr<Texture> TextureRef;
+
+// Sampler state is part of a texture object, so it is part of every cache key too
+struct TextureParams
+{
+    GLenum sWrap, tWrap, minFilter, magFilter;
+
+    bool operator<(const TextureParams& other) const
+    {
+        if (sWrap != other.sWrap) return sWrap < other.sWrap;
+        if (tWrap != other.tWrap) return tWrap < other.tWrap;
+        if (minFilter != other.minFilter) return minFilter < other.minFilter;
+        return magFilter < other.magFilter;
+    }
+};
+
+
+// Loads textures without stalling the render thread: worker threads decode the images, a ring of pixel unpack buffers (PBOs)
+// stages the uploads, and update() issues a few uploads per frame within a time budget.
+// load() returns a usable texture straight away, showing a 1x1 placeholder until the real image is resident.
+// .ktx2 files (from texbake) keep their block compression and precomputed mips, or are decoded on the CPU if the driver
+// can't sample their format. Loads are deduplicated twice: by canonical path (no second decode) and by decoded content hash (no second upload)
+class TextureLoader
+{
+public:
+    // Set before the first load(): mip chains are built on the workers with the CPU generator (gamma-correct box filter by
+    // default) and uploaded with the image, or left to glGenerateMipmap on the GL thread when CpuMipmaps is false
+    bool CpuMipmaps = true;
+    MipOptions Mipmaps;
+
+    // workers == 0 picks from the hardware thread count
+    TextureLoader(unsigned workers = 0, unsigned stagingBuffers = 3);
+    ~TextureLoader();
+
+    // Queues the image for decoding (always as RGBA8, flipped so row 0 is the bottom), returns the texture right away
+    TextureRef load(const std::string& imagePath, GLenum sWrap, GLenum tWrap, GLenum minFilter, GLenum magFilter);
+    // Same, for a texture stored in an asset pack: no decode, the levels are uploaded straight from the mapped pages.
+    // The pack has to outlive the upload (finish(), or pending() reaching 0)
+    TextureRef load(const AssetPack& pack, const std::string& name, GLenum sWrap, GLenum tWrap, GLenum minFilter, GLenum magFilter);
+    // Same, for RGBA8 levels built in memory (e.g. a TextureAtlas), level 0 first and bottom-up. Nothing to decode, they are
+    // uploaded by the next update(). 'name' keys the path cache, so it has to be unique
+    TextureRef loadPixels(const std::string& name, int width, int height, std::vector<std::vector<unsigned char>> levels,
+                          GLenum sWrap, GLenum tWrap, GLenum minFilter, GLenum magFilter);
+    // GL thread, once per frame: uploads decoded images until budgetMs is used up (at least one per call, so loading always progresses)
+    void update(double budgetMs = 2.0);
+    // GL thread: blocks until every queued texture is resident
+    void finish();
+    // Number of textures still decoding or waiting for upload
+    size_t pending() const { return requested - resident; }
+    // Prints path/content cache hits and the decode & VRAM bytes they saved
+    void report() const;
+
+private:
+    struct Request
+    {
+        std::weak_ptr<Texture> texture;
+        TextureParams params;
+        std::string path;
+    };
+    struct Decoded
+    {
+        std::weak_ptr<Texture> texture;     // Skipped if every user released it before it was uploaded
+        TextureParams params;
+        std::string path;
+        int width, height;
+        unsigned char* pixels;  // stbi allocation (level 0), NULL for .ktx2 files or if decoding failed
+        std::vector<std::vector<unsigned char>> levels;     // Every level after 'pixels' (CPU mips), or the whole .ktx2 chain,
+                                                            // block compressed unless compressedFormat is 0 (RGBA8)
+        GLenum compressedFormat;
+        std::vector<std::pair<const unsigned char*, size_t>> mapped;  // Levels borrowed from an AssetPack mapping
+        unsigned long long contentHash;
+        double decodeMs;
+    };
+    struct StagingBuffer
+    {
+        unsigned PBO = 0;
+        size_t capacity = 0;
+        GLsync fence = 0;       // Signalled once the GPU has consumed the last upload from this buffer
+    };
+    struct ContentKey
+    {
+        unsigned long long hash;
+        int width, height;
+        TextureParams params;
+
+        bool operator<(const ContentKey& other) const
+        {
+            if (hash != other.hash) return hash < other.hash;
+            if (width != other.width) return width < other.width;
+            if (height != other.height) return height < other.height;
+            return params < other.params;
+        }
+    };
+
+    std::vector<std::thread> workers;
+    std::deque<Request> requests;       // Guarded by mutex
+    std::deque<Decoded> decoded;        // Guarded by mutex
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping = false;
+
+    // Caches hold weak references, a texture goes away as soon as nothing uses it
+    std::map<std::pair<std::string, TextureParams>, std::weak_ptr<Texture>> pathCache;
+    std::map<ContentKey, std::weak_ptr<TextureObject>> contentCache;
+    size_t pathHits = 0, contentHits = 0, decodeBytesSaved = 0, vramBytesSaved = 0;
+
+    std::map<unsigned, GLenum> compressedFormats;   // KTX2 vkFormat -> GL internal format, for the formats the driver can sample
+
+    std::vector<StagingBuffer> staging;
+    size_t nextStaging = 0;
+    size_t requested = 0, resident = 0;
+
+    // Path cache lookup (counting the hit), NULL on a miss
+    TextureRef findCached(const std::string& key, const TextureParams& params);
+    // New texture object showing the placeholder, registered in the path cache and counted as requested
+    TextureRef createPlaceholder(const std::string& key, const TextureParams& params);
+    void workerLoop();
+    // Worker side of a .ktx2 request, fills levels/compressedFormat (or leaves levels empty on failure)
+    void readCompressed(Decoded& image) const;
+    // Returns false (leaving the image queued) if the next staging buffer is still in use by the GPU and 'wait' is false
+    bool upload(Decoded& image, bool wait);
+};
+
+#endif
@@ -0,0 +1,153 @@
+#ifndef TILEDRASTER_H
+#define TILEDRASTER_H
+
+#include <glm/glm.hpp>
+#include <vector>
+#include <cstdint>
+#include <cstddef>
+#include <functional>
+#include <algorithm>
+#include "workerpool.h"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define TILEDRASTER_X86 1
+#include <immintrin.h>
+#endif
+
+// Screen space triangle ready to rasterize: edge functions A*x + B*y + C (>= 0 inside) and its depth plane
+struct RasterTriangle
+{
+    float EdgeA[3], EdgeB[3], EdgeC[3];
+    bool TopLeft[3];            // A top or left edge: pixel centers exactly on it are covered under the fill rule
+    float DepthA, DepthB, DepthC;
+    int MinX, MinY, MaxX, MaxY; // Pixel bounds, inclusive, clamped to the target
+};
+
+// Sets up the triangle through 3 screen space corners (x & y in pixels, z the depth) for a width x height target.
+// Clockwise corners get 1 & 2 swapped in place ('flipped' says so, for the caller's own per-corner data), so both windings
+// rasterize. 'area' is twice the triangle's. False for degenerate & off screen triangles
+bool setupRasterTriangle(glm::vec3 screen[3], int width, int height, RasterTriangle& triangle, float& area, bool& flipped);
+// Coefficients of the plane A*x + B*y + C through the (set up) corners' values, for anything interpolated linearly in screen space
+void rasterPlane(const glm::vec3 screen[3], float value0, float value1, float value2, float area, float& A, float& B, float& C);
+
+// 4 horizontally adjacent pixels of a triangle, at least one of them covered
+struct RasterQuad
+{
+    int X, Y;
+    int Mask;               // Bit i: pixel X + i is covered
+    float Depth[4];
+#ifdef TILEDRASTER_X86
+    __m128 Covered, Z;      // The same as SSE lanes (all bits set where covered), nothing to unpack for SIMD callers
+#endif
+};
+
+// Splits a target into 32x32 tiles, bins triangles into the tiles their bounds touch and runs a job per tile. Tiles own
+// disjoint pixels, so the jobs run in parallel on the pool (single threaded without one) without any locking
+class RasterTiles
+{
+public:
+    static const int TILE_SIZE = 32;
+
+    RasterTiles(int width, int height, WorkerPool* pool = NULL);
+
+    // Drops the last bins and bins every triangle in order. Returns the triangle & tile pairs
+    size_t bin(const std::vector<RasterTriangle>& triangles);
+    // job(tile) for every tile, returns once they're all done
+    void run(const std::function<void(int)>& job);
+
+    int count() const { return tilesX * tilesY; }
+    // Indices of the triangles binned into the tile, in submission order
+    const std::vector<uint32_t>& triangles(int tile) const { return bins[tile]; }
+    // Pixel rectangle of the tile, inclusive
+    void bounds(int tile, int& x0, int& y0, int& x1, int& y1) const;
+
+private:
+    int width, height, tilesX, tilesY;
+    WorkerPool* pool;
+    std::vector<std::vector<uint32_t>> bins;
+};
+
+// Walks the triangle's pixels inside a tile rectangle 4 at a time (SSE2 edge functions on x86) and calls quad(RasterQuad)
+// for every group of 4 with a covered pixel center. With FillRule coverage follows GL's top-left rule (every pixel once
+// where triangles share an edge), else a pixel center on any edge is covered. Groups start 4-aligned (tiles do too, so
+// they never cross one), rows have to be padded to 4; lanes at or past 'width' are never covered
+template <bool FillRule, typename Quad>
+void rasterizeQuads(const RasterTriangle& t, int tileX0, int tileY0, int tileX1, int tileY1, int width, Quad&& quad)
+{
+    int x0 = std::max(t.MinX, tileX0) & ~3, x1 = std::min(t.MaxX, tileX1);
+    int y0 = std::max(t.MinY, tileY0), y1 = std::min(t.MaxY, tileY1);
+#ifdef TILEDRASTER_X86
+    __m128 laneOffsets = _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f);  // Pixel centers
+    __m128 zero = _mm_setzero_ps();
+    __m128 columnLimit = _mm_set1_ps((float)width);
+    __m128 edgeA[3], edgeB[3], edgeC[3];
+    for (int edge = 0; edge < 3; edge++)
+    {
+        edgeA[edge] = _mm_set1_ps(t.EdgeA[edge]);
+        edgeB[edge] = _mm_set1_ps(t.EdgeB[edge]);
+        edgeC[edge] = _mm_set1_ps(t.EdgeC[edge]);
+    }
+    __m128 depthA = _mm_set1_ps(t.DepthA), depthB = _mm_set1_ps(t.DepthB), depthC = _mm_set1_ps(t.DepthC);
+    // Else reloaded after every quad(), which may write anywhere
+    bool inclusive0 = !FillRule || t.TopLeft[0], inclusive1 = !FillRule || t.TopLeft[1], inclusive2 = !FillRule || t.TopLeft[2];
+    RasterQuad current;
+    for (int y = y0; y <= y1; y++)
+    {
+        __m128 py = _mm_set1_ps(y + 0.5f);
+        // Row constant parts of the edge & depth functions
+        __m128 rowEdge[3];
+        for (int edge = 0; edge < 3; edge++)
+            rowEdge[edge] = _mm_add_ps(_mm_mul_ps(edgeB[edge], py), edgeC[edge]);
+        __m128 rowDepth = _mm_add_ps(_mm_mul_ps(depthB, py), depthC);
+        for (int x = x0; x <= x1; x += 4)
+        {
+            __m128 px = _mm_add_ps(_mm_set1_ps((float)x), laneOffsets);
+            // Unrolled by hand, GCC keeps the edge loop rolled at -O2
+            __m128 value0 = _mm_add_ps(_mm_mul_ps(edgeA[0], px), rowEdge[0]);
+            __m128 value1 = _mm_add_ps(_mm_mul_ps(edgeA[1], px), rowEdge[1]);
+            __m128 value2 = _mm_add_ps(_mm_mul_ps(edgeA[2], px), rowEdge[2]);
+            __m128 covered = _mm_and_ps(_mm_cmplt_ps(px, columnLimit), inclusive0 ? _mm_cmpge_ps(value0, zero) : _mm_cmpgt_ps(value0, zero));
+            covered = _mm_and_ps(covered, inclusive1 ? _mm_cmpge_ps(value1, zero) : _mm_cmpgt_ps(value1, zero));
+            covered = _mm_and_ps(covered, inclusive2 ? _mm_cmpge_ps(value2, zero) : _mm_cmpgt_ps(value2, zero));
+            current.Mask = _mm_movemask_ps(covered);
+            if (current.Mask == 0) continue;
+            current.X = x;
+            current.Y = y;
+            current.Covered = covered;
+            current.Z = _mm_add_ps(_mm_mul_ps(depthA, px), rowDepth);
+            _mm_storeu_ps(current.Depth, current.Z);    // Dead when the callback only uses the lanes
+            quad((const RasterQuad&)current);
+        }
+    }
+#else
+    RasterQuad current;
+    for (int y = y0; y <= y1; y++)
+    {
+        float py = y + 0.5f;
+        for (int x = x0; x <= x1; x += 4)
+        {
+            int mask = 0;
+            for (int lane = 0; lane < 4 && x + lane < width; lane++)
+            {
+                float px = x + lane + 0.5f;
+                bool covered = true;
+                for (int edge = 0; edge < 3; edge++)
+                {
+                    float value = t.EdgeA[edge] * px + t.EdgeB[edge] * py + t.EdgeC[edge];
+                    covered = covered && (!FillRule || t.TopLeft[edge] ? value >= 0.0f : value > 0.0f);
+                }
+                if (covered)
+                    mask |= 1 << lane;
+                current.Depth[lane] = t.DepthA * px + t.DepthB * py + t.DepthC;
+            }
+            if (mask == 0) continue;
+            current.X = x;
+            current.Y = y;
+            current.Mask = mask;
+            quad((const RasterQuad&)current);
+        }
+    }
+#endif
+}
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef WORKERPOOL_H
+#define WORKERPOOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// Persistent threads for fork-join loops that run every frame (e.g. one job per screen tile): parallelFor() hands the
+// indices out to the workers and the calling thread, and returns once every one of them is done. Nothing is allocated per
+// call and the threads sleep in between. One parallelFor() at a time
+class WorkerPool
+{
+public:
+    // Workers besides the calling thread. 0 picks one less than the hardware threads, at most 7
+    WorkerPool(unsigned workerCount = 0);
+    ~WorkerPool();
+    WorkerPool(const WorkerPool&) = delete;
+    WorkerPool& operator=(const WorkerPool&) = delete;
+
+    // Calls body(i) for every i in [0, count), in any order and on any of the threads
+    void parallelFor(int count, const std::function<void(int)>& body);
+    // Including the calling thread
+    unsigned threadCount() const { return (unsigned)workers.size() + 1; }
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable wake, done;
+    bool stopping = false;
+    unsigned generation = 0;                        // Bumped per parallelFor(), guarded by mutex
+    const std::function<void(int)>* job = NULL;     // Guarded by mutex
+    int jobCount = 0;
+    int busy = 0;                                   // Workers still on the current job, guarded by mutex
+    std::atomic<int> next{0};
+
+    void workerLoop();
+};
+
+#endif
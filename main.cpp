@@ -1,6 +1,12 @@
 #include <iostream>
 #include <cmath>
 #include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <algorithm>
 #include <glad/glad.h> 
 #include <GLFW/glfw3.h>
 #include <glm/glm.hpp>
@@ -8,6 +14,28 @@
 #include <glm/gtc/type_ptr.hpp>
 #include "shader.h"
 #include "camera.h"
+#include "headless.h"
+#include "framestats.h"
+#include "glfeatures.h"
+#include "shaderwatcher.h"
+#include "frameuniforms.h"
+#include "meshbuilder.h"
+#include "meshpool.h"
+#include "textureloader.h"
+#include "mipmap.h"
+#include "assetpack.h"
+#include "atlas.h"
+#include "material.h"
+#include "renderqueue.h"
+#include "glstate.h"
+#include "indirectdraw.h"
+#include "ringbuffer.h"
+#include "culling.h"
+#include "occlusion.h"
+#include "softrast.h"
+#include "regression.h"
+#include "profiler.h"
+#include "gputimer.h"
 
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
@@ -18,14 +46,44 @@ using namespace glm;
 // SETTINGS
 // --------
 int SCR_WIDTH = 800, SCR_HEIGHT = 600; 
+struct {
+    bool headless = false;  // --headless: render into an FBO with no window/vsync and report frame times at exit
+    int frames = 1000;      // --frames N: number of frames rendered in headless mode
+    int containers = 0;     // --containers N: extra containers spawned with random transforms
+    bool instancing = true; // --no-instancing: draw the extra containers with one draw call each instead of one instanced call
+    bool mipBenchmark = false;  // --mip-benchmark: time the CPU mip generator against glGenerateMipmap, then exit
+    const char* pack = NULL;    // --pack FILE: take textures & shaders from an asset pack built by tools/mkpack instead of loose files
+    bool atlas = false;     // --atlas: pack the scene's textures into one atlas and remap the mesh UVs into it, so draws share one texture
+    bool materials = false; // --materials: every texture is a layer of a texture array bound once per frame, draws only pick a layer
+    bool indirect = false;  // --indirect: spawned containers (with --materials the whole scene) are commands of one multi-draw indirect batch
+    bool culling = true;    // --no-culling: submit every spawned container, including the ones outside the view frustum
+    bool cullBenchmark = false; // --cull-benchmark: time the frustum culling kernels over 10k/100k/1M objects, then exit
+    const char* profile = NULL; // --profile FILE: record PROFILE_SCOPE zones, written as a Chrome trace at exit (and whenever P is pressed)
+    const char* regress = NULL; // --regress DIR: render fixed camera poses (--frames N each, headless) and compare images & frame times with DIR's references
+    bool regressUpdate = false; // --regress-update: (re)write --regress's reference images & baseline from this run instead of comparing
+    double regressThreshold = 10.0; // --regress-threshold PCT: how much slower than the baseline a pose's median frame may get
+    bool software = false;  // --software: render the plain scene (--frames N of it) with the CPU rasterizer, no GL context or window at all
+    bool occlusion = false; // --occlusion: also skip spawned containers hidden behind the floor or the center container (CPU depth buffer)
+    bool ring = true;       // --no-ring: per-frame instance data (indirect batch, culled instances) is re-specified in place every frame instead of streamed through a ring buffer
+    bool stateCache = true; // --no-state-cache: issue every bind & state call even when it changes nothing (GLState still counts them)
+    bool gpuTiming = false; // --gpu-timing: time the clear & each kind of draw on the GPU (timer queries), print every frame's times and a summary at exit
+} RunOptions;
 
 
 // FUNCTIONS
 // ---------
 // Utilities
+bool parseArgs(int argc, char** argv);
 GLFWwindow* configGLFW();
-void configBuffers(unsigned& VBO, unsigned& VAO, const std::vector<float>& vertices);
-void loadTexture(unsigned& texture, std::string imagePath, GLenum sWrap, GLenum tWrap, GLenum minFilter, GLenum maxFilter);
+void configInstanceBuffer(unsigned& instanceVBO, unsigned VAO, const std::vector<mat4>& models, const std::vector<int>& materials);
+void pointInstanceAttributes(unsigned VAO, unsigned buffer, size_t modelOffset, size_t materialOffset);
+std::vector<mat4> randomTransforms(int count, unsigned seed);
+void runMipBenchmark();
+void runCullBenchmark();
+int runSoftwareRenderer();
+void writeProfile();
+bool buildSceneAtlas(const AssetPack* pack, TextureAtlas& atlas);
+bool loadSceneMaterials(const AssetPack* pack, MaterialLibrary& materials);
 
 // Callbacks
 void framebufferSizeCallback(GLFWwindow* window, int width, int height);
@@ -42,165 +100,542 @@ struct {
     float lastFrame = 0.0f; // Time of last frame
 } TimeStruct;
 
-int main()
+// SCENE GEOMETRY (POSITION XYZ + UV, SHARED BY THE GL & SOFTWARE RENDERERS)
+// -------------------------------------------------------------------------
+const std::vector<float> CONTAINER_VERTICES = {
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+    0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
+    0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+    0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
+
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+    0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+    0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+
+    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+    0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+    0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+    0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+    0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+    0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+    0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
+    0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+    0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
+    -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
+    -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
+
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
+    0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
+    0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+    0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
+    -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
+    -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
+};
+const std::vector<float> FLOOR_VERTICES = {
+    -0.5f, -0.5f, 0.0f,  0.0f, 0.0f,
+    0.5f, -0.5f, 0.0f,  1.0f, 0.0f,
+    0.5f,  0.5f, 0.0f,  1.0f, 1.0f,
+    -0.5f,  0.5f, 0.0f,  0.0f, 1.0f,
+};
+
+const std::vector<unsigned> FLOOR_INDICES = {
+    0, 1, 2,
+    2, 3, 0
+};
+
+
+int main(int argc, char** argv)
 {
-    // GLFW: INIT & CONFIG
-    // -------------------
-    GLFWwindow* window = configGLFW();
-    if (window == NULL) return -1;
+    if (!parseArgs(argc, argv)) return -1;
+    Profiler.Recording = RunOptions.profile != NULL;
+    PROFILE_THREAD("main");
+    GLState.Enabled = RunOptions.stateCache;
+    if (RunOptions.cullBenchmark)
+    {
+        runCullBenchmark();     // CPU only, no context needed
+        return 0;
+    }
+    if (RunOptions.software)
+        return runSoftwareRenderer();
+
+    // GLFW: INIT & CONFIG (OR A WINDOW-LESS CONTEXT WHEN HEADLESS)
+    // ------------------------------------------------------------
+    GLFWwindow* window = NULL;
+    HeadlessContext* headless = NULL;
+    GLADloadproc loadProc;
+    if (RunOptions.headless)
+    {
+        headless = new HeadlessContext(SCR_WIDTH, SCR_HEIGHT);
+        if (!headless->Valid) return -1;
+        loadProc = (GLADloadproc)HeadlessContext::getProcAddress;
+    }
+    else
+    {
+        window = configGLFW();
+        if (window == NULL) return -1;
+        loadProc = (GLADloadproc)glfwGetProcAddress;
+    }
 
     // INIT GLAD, WHICH MANAGES FUNCTION POINTERS FOR OPENGL
     // -----------------------------------------------------
-    if (!gladLoadGLLoader((GLADloadproc)glfwGetProcAddress))
+    if (!gladLoadGLLoader(loadProc))
     {
         std::cout << "Failed to initialize GLAD" << std::endl;
         return -1;
     }
+    loadGLFeatures(loadProc);
+    if (headless && !headless->createFramebuffer()) return -1;
 
-    glEnable(GL_DEPTH_TEST);
+    if (RunOptions.mipBenchmark)
+    {
+        runMipBenchmark();
+        delete headless;
+        if (window) glfwTerminate();
+        return 0;
+    }
+
+    GLState.enable(GL_DEPTH_TEST, true);
+
+    // LOAD TEXTURES (DECODED ON WORKER THREADS WHILE THE SHADERS COMPILE, PLACEHOLDERS UNTIL THEN)
+    // --------------------------------------------------------------------------------------------
+    // With --pack they come straight out of the mapped file, already decoded & mipmapped, so no worker is involved
+    AssetPack* assetPack = NULL;
+    if (RunOptions.pack)
+    {
+        assetPack = new AssetPack(RunOptions.pack);
+        if (!assetPack->Valid) return -1;
+    }
+    // With --atlas they are packed into one texture up front instead (built here, uploaded by the loader like any other)
+    TextureAtlas atlas;
+    if (RunOptions.atlas && !buildSceneAtlas(assetPack, atlas)) return -1;
+    // With --materials they all go into texture arrays instead, uploaded before the first frame
+    MaterialLibrary* materials = NULL;
+    if (RunOptions.materials)
+    {
+        materials = new MaterialLibrary();
+        if (!loadSceneMaterials(assetPack, *materials) || !materials->build()) return -1;
+    }
+    TextureLoader* textureLoader = new TextureLoader();
+    TextureRef wallTexture, floorTexture;
+    if (RunOptions.atlas)
+        wallTexture = floorTexture = textureLoader->loadPixels("atlas", atlas.Width, atlas.Height, std::move(atlas.Levels),
+                                                              GL_CLAMP_TO_EDGE, GL_CLAMP_TO_EDGE, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+    else if (!materials)
+    {
+        wallTexture = assetPack ? textureLoader->load(*assetPack, "textures/wall.png", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR)
+            : textureLoader->load("textures//wall.png", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+        floorTexture = assetPack ? textureLoader->load(*assetPack, "textures/face1.png", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR)
+            : textureLoader->load("textures//face1.png", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+    }
+
+    // PER-FRAME UNIFORM BUFFER (CREATED FIRST SO PROGRAMS BIND ITS BLOCK AT LINK TIME)
+    // -------------------------------------------------------------------------------
+    FrameUniformBuffer* frameUniforms = new FrameUniformBuffer();
 
     // BUILD & COMPILE SHADER PROGRAM
     // ------------------------------
-    Shader* shader = new Shader("src//vertexShader.vs", "src//fragmentShader.fs");
+    auto makeShader = [&](const char* vertexPath, const char* fragmentPath) {
+        return assetPack ? new Shader(*assetPack, vertexPath, fragmentPath) : new Shader(vertexPath, fragmentPath);
+    };
+    const char* fragmentPath = materials ? materials->fragmentShaderPath() : "src/fragmentShader.fs";
+    Shader* shader = makeShader("src/vertexShader.vs", fragmentPath);
+    Shader* instancedShader = RunOptions.containers > 0 || RunOptions.indirect ? makeShader("src/instancedShader.vs", fragmentPath) : NULL;
     
     // INIT VERTEX & INDEX DATA
     // ------------------------
-    std::vector<float> containerVertices = {
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-        0.5f, -0.5f, -0.5f,  1.0f, 0.0f,
-        0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 0.0f,
-
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-        0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 1.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-
-        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-        0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-        0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-        0.5f, -0.5f, -0.5f,  1.0f, 1.0f,
-        0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-        0.5f, -0.5f,  0.5f,  1.0f, 0.0f,
-        -0.5f, -0.5f,  0.5f,  0.0f, 0.0f,
-        -0.5f, -0.5f, -0.5f,  0.0f, 1.0f,
-
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f,
-        0.5f,  0.5f, -0.5f,  1.0f, 1.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-        0.5f,  0.5f,  0.5f,  1.0f, 0.0f,
-        -0.5f,  0.5f,  0.5f,  0.0f, 0.0f,
-        -0.5f,  0.5f, -0.5f,  0.0f, 1.0f
-    };
-    std::vector<float> floorVertices = {
-        -0.5f, -0.5f, 0.0f,  0.0f, 0.0f,
-        0.5f, -0.5f, 0.0f,  1.0f, 0.0f,
-        0.5f,  0.5f, 0.0f,  1.0f, 1.0f,
-        -0.5f,  0.5f, 0.0f,  0.0f, 1.0f,
-    };
+    std::vector<float> containerVertices = CONTAINER_VERTICES;
+    std::vector<float> floorVertices = FLOOR_VERTICES;
 
-    std::vector<unsigned> floorIndices = {
-        0, 1, 2,
-        2, 3, 0
-    };
+    // Move the UVs into each texture's atlas region, so the container and the floor sample the same texture
+    if (RunOptions.atlas)
+    {
+        size_t outside = remapUVs(containerVertices, 5, 3, atlas.Regions["textures/wall.png"])
+                       + remapUVs(floorVertices, 5, 3, atlas.Regions["textures/face1.png"]);
+        if (outside)
+            std::cout << "WARNING::ATLAS::UVS_OUTSIDE_0_1 " << outside << " vertices repeat their texture, which an atlas region can't" << std::endl;
+    }
 
-    // CONFIG VBOs, VAOs
-    // -----------------
-    unsigned VBO1, VAO1;
-    configBuffers(VBO1, VAO1, containerVertices);
+    // UPLOAD MESHES INTO THE SHARED POOL (ONE VBO/EBO/VAO FOR THE POSITION + UV FORMAT)
+    // ---------------------------------------------------------------------------------
+    MeshPool* meshPool = new MeshPool({{0, 3}, {2, 2}});    // Position at location 0, texture coords at location 2
 
-    unsigned VBO2, VAO2;
-    configBuffers(VBO2, VAO2, floorVertices);
+    // Weld the duplicated container corners into an indexed mesh, ordered for the post-transform vertex cache
+    MeshData containerMesh = buildMesh(containerVertices, 5, "container");
+    MeshHandle containerHandle = meshPool->add(containerMesh);
 
-    // LOAD TEXTURES
-    // -------------
-    unsigned wallTexture, floorTexture;
-    loadTexture(wallTexture, "textures//wall.png", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
-    loadTexture(floorTexture, "textures//face1.png", GL_REPEAT, GL_REPEAT, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR);
+    MeshData floorMesh;
+    floorMesh.Vertices = floorVertices;
+    floorMesh.Indices = FLOOR_INDICES;
+    floorMesh.FloatsPerVertex = 5;
+    MeshHandle floorHandle = meshPool->add(floorMesh);
 
-    // Activate the shader program
-    shader->use();
-    // Set each uniform sampler to the correct texture unit (only 1 atm)
-    shader->setInt("ourTexture", 0);
+    // Spawned containers use the pool's VAO too, with their model matrices (and materials, cycling through all of them
+    // with --materials) in a per-instance buffer
+    std::vector<mat4> spawnedModels = randomTransforms(RunOptions.containers, 1234);
+    std::vector<int> spawnedMaterials(spawnedModels.size(), -1);
+    const char* materialNames[] = {"textures/wall.png", "textures/face1.png", "textures/face2.png", "textures/numbers.png"};
+    for (size_t i = 0; materials && i < spawnedMaterials.size(); i++)
+        spawnedMaterials[i] = materials->find(materialNames[i % 4]).id();
+    Material wallMaterial = materials ? materials->find("textures/wall.png") : Material();
+    Material floorMaterial = materials ? materials->find("textures/face1.png") : Material();
+    unsigned instanceVBO = 0;
+    if (!spawnedModels.empty() && !RunOptions.indirect)
+        configInstanceBuffer(instanceVBO, meshPool->VAO, spawnedModels, spawnedMaterials);
+    // Spawned containers never move, so their world bounds for frustum culling are computed once
+    CullingBounds spawnedBounds;
+    LocalBounds containerBounds = computeBounds(containerMesh);
+    spawnedBounds.reserve(spawnedModels.size());
+    for (const mat4& model : spawnedModels)
+        spawnedBounds.add(containerBounds, model);
+    std::vector<uint32_t> spawnedVisible;
+    std::vector<mat4> visibleModels;    // Instanced path: the visible ones' instance data, compacted
+    std::vector<int> visibleMaterials;
+    // Occlusion culling rasterizes the floor & center container on the CPU, its tiles spread over a pool of worker threads
+    WorkerPool* workerPool = RunOptions.occlusion ? new WorkerPool() : NULL;
+    OcclusionBuffer* occlusionBuffer = RunOptions.occlusion ? new OcclusionBuffer(256, 128, workerPool) : NULL;
+    // Or they are recorded into an indirect batch every frame, which has its own VAO & per-draw buffer
+    IndirectBatch* indirectBatch = RunOptions.indirect ? new IndirectBatch(meshPool) : NULL;
+    // Whose per-draw data is streamed through a ring of 3 regions (frames in flight), each sized for the whole scene. So are
+    // the culled instances' compacted models & materials, rewriting the instance buffer a draw may still read would stall
+    bool compactInstances = !indirectBatch && RunOptions.instancing && !spawnedModels.empty() && (RunOptions.culling || occlusionBuffer);
+    RingBuffer* streamRing = NULL;
+    if (indirectBatch && RunOptions.ring)
+    {
+        size_t drawBytes = sizeof(IndirectDrawRecord) + sizeof(DrawElementsIndirectCommand);
+        streamRing = new RingBuffer((spawnedModels.size() + 2) * drawBytes + 256, 3);
+    }
+    else if (compactInstances && RunOptions.ring)
+        streamRing = new RingBuffer(spawnedModels.size() * (sizeof(mat4) + sizeof(int)) + 256, 3);
+
+    // Rebuild the shader program in the background whenever its source files are saved (not for packed shaders, there
+    // are no files to watch)
+    ShaderWatcher shaderWatcher;
+    if (!assetPack)
+    {
+        shaderWatcher.add(shader);
+        if (instancedShader) shaderWatcher.add(instancedShader);
+    }
+
+    // Activate the shader program, then set each uniform sampler to the correct texture unit (only 1 atm, or one per
+    // material array). Redone after a hot reload. Per-draw uniforms are the render queue's business
+    auto setupShader = [&]() {
+        if (instancedShader)
+        {
+            instancedShader->use();
+            if (materials)
+                materials->setupShader(*instancedShader);
+            else
+                instancedShader->setInt("ourTexture", 0);
+        }
+        shader->use();
+        if (materials)
+            materials->setupShader(*shader);
+        else
+            shader->setInt("ourTexture", 0);
+    };
+    setupShader();
 
     // OBJECT TRANSFORMATIONS
     // ----------------------
     mat4 containerModel = mat4(1.0f);      // (LOCAL -> WORLD): specifies the local-space transformations of coordinates on an object
     mat4 floorModel = mat4(1.0f);
 
-    mat4 view = mat4(1.0f);       // (WORLD -> VIEW): specifies the position of the camera relative to world-space coordinates
-    mat4 projection = mat4(1.0f); // (VIEW -> CLIP) - specifies how the 3D coordinates should be transformed to a 2D viewport
+    FrameUniformData frameData;
+    frameData.view = mat4(1.0f);       // (WORLD -> VIEW): specifies the position of the camera relative to world-space coordinates
+    frameData.projection = mat4(1.0f); // (VIEW -> CLIP) - specifies how the 3D coordinates should be transformed to a 2D viewport
 
     containerModel = translate(containerModel, vec3(0.0f, 0.0, -3.0f));
     floorModel = rotate(floorModel, radians(90.0f), vec3(1.0f, 0.0f, 0.0f));
     floorModel = translate(floorModel, vec3(0.0f, 0.0f, 3.0f));
     floorModel = scale(floorModel, vec3(10.0f, 10.0f, 10.0f));
 
+    // Benchmarks measure the final scene, so wait for every texture up front there
+    if (RunOptions.headless)
+        textureLoader->finish();
+
+    // With --regress the loop renders every pose in turn, each for --frames frames
+    RegressionRun* regression = RunOptions.regress ? new RegressionRun(RunOptions.regress, "gl", RunOptions.frames, RunOptions.regressUpdate, RunOptions.regressThreshold) : NULL;
+    int frameLimit = regression ? regression->totalFrames() : RunOptions.frames;
+    std::vector<unsigned char> framePixels;
+
     // RENDER LOOP
     // -----------
-    while(!glfwWindowShouldClose(window))
+    FrameStats stats(RunOptions.headless ? frameLimit : 0);
+    int frameCount = 0;
+    int drawCalls = 0;  // Per frame
+    RenderQueue renderQueue;
+    RenderQueueStats queueTotals;   // Summed over all frames
+    // GPU times of the passes come back a few frames late, each frame's line is printed once they have
+    GpuTimer* gpuTimer = RunOptions.gpuTiming ? new GpuTimer() : NULL;
+    renderQueue.Timer = gpuTimer;
+    int gpuFramePrinted = -1;
+    size_t culledTotal = 0;
+    double cullMs = 0.0;
+    OcclusionStats occlusionTotals; // Summed over all frames
+    GLState.resetCounters();        // Only count what the frames issue, not the loading
+    while(RunOptions.headless ? frameCount < frameLimit : !glfwWindowShouldClose(window))
     {
+        PROFILE_SCOPE("frame");
+        auto frameStart = std::chrono::steady_clock::now();
+        drawCalls = 0;
+        if (regression)
+            regression->beginFrame(frameCount, mainCam);
+        if (gpuTimer)
+        {
+            gpuTimer->beginFrame();
+            if (gpuTimer->lastFrameIndex() > gpuFramePrinted)
+            {
+                gpuFramePrinted = gpuTimer->lastFrameIndex();
+                printf("GPU frame %d (ms):", gpuFramePrinted);
+                for (const GpuPassTime& pass : gpuTimer->lastFrame())
+                    printf(" %s %.3f", pass.Name, pass.Ms);
+                printf("\n");
+            }
+        }
+
         // INPUT
         // -----
-        processInput(window);
+        if (!RunOptions.headless)
+        {
+            PROFILE_SCOPE("input");
+            processInput(window);
+        }
+
+        // SHADER HOT RELOAD (SWAPS ONLY BETWEEN FRAMES)
+        // ---------------------------------------------
+        if (!shaderWatcher.update().empty())
+            setupShader();
+
+        // Upload textures that finished decoding, within a small per-frame budget
+        {
+            PROFILE_SCOPE("texture uploads");
+            textureLoader->update();
+        }
 
         // RENDER
         // ------
         // Clear colour & depth buffers
+        if (gpuTimer) gpuTimer->beginPass("clear");
         glClearColor(0.2f, 0.3f, 0.3f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+        if (gpuTimer) gpuTimer->endPass();
         
-        view = mainCam.GetViewMatrix();
-        projection = perspective(radians(mainCam.Fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
-        shader->setMat4("view", GL_FALSE, value_ptr(view));
-        shader->setMat4("projection", GL_FALSE, value_ptr(projection));
-
-        // RENDER CONTAINER
-        // ----------------
-        // Bind textures to corresponding texture units (only 1 atm)
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, wallTexture);
-
-        // Update model matrix
-        containerModel = rotate(containerModel, radians(0.5f), vec3(0.5f, 1.0f, 0.0f));    // Rotate over time
-        shader->setMat4("model", GL_FALSE, value_ptr(containerModel));
+        // Upload view & projection once for every program that reads the FrameUniforms block
+        {
+            PROFILE_SCOPE("matrices");
+            frameData.view = mainCam.GetViewMatrix();
+            frameData.projection = perspective(radians(mainCam.Fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+            containerModel = rotate(containerModel, radians(0.5f), vec3(0.5f, 1.0f, 0.0f));    // Rotate over time
+        }
+        {
+            PROFILE_SCOPE("uniform upload");
+            frameUniforms->Update(frameData);
+        }
 
-        // Render triangle(s)
-        glBindVertexArray(VAO1); // Binds the defined VAO (and automatically the EBO if present) so OpenGL correctly uses vertex data
-        glDrawArrays(GL_TRIANGLES, 0, 36);
+        if (streamRing)
+            streamRing->beginFrame();
 
-        // RENDER FLOOR
-        // ------------
-        // Bind textures to corresponding texture units (only 1 atm)
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, floorTexture);
-        
-        // Change to correct model matrix
-        shader->setMat4("model", GL_FALSE, value_ptr(floorModel));
+        // Material arrays are all bound once, for every draw of the frame, so draws only pick their layer
+        if (materials)
+            materials->bind();
+
+        // FRUSTUM CULLING OF THE SPAWNED CONTAINERS, THE ONLY OBJECTS THERE ARE ENOUGH OF TO BOTHER
+        // -----------------------------------------------------------------------------------------
+        if (RunOptions.culling)
+        {
+            PROFILE_SCOPE("frustum culling");
+            auto cullStart = std::chrono::steady_clock::now();
+            cullFrustum(extractFrustum(frameData.projection * frameData.view), spawnedBounds, spawnedVisible);
+            cullMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - cullStart).count();
+            culledTotal += spawnedModels.size() - spawnedVisible.size();
+        }
+        else if (spawnedVisible.size() != spawnedModels.size())
+        {
+            spawnedVisible.resize(spawnedModels.size());
+            for (size_t i = 0; i < spawnedVisible.size(); i++)
+                spawnedVisible[i] = (uint32_t)i;
+        }
+
+        // OCCLUSION CULLING OF WHAT'S LEFT, BEHIND THE FLOOR & CENTER CONTAINER (THEY OCCLUDE, THEMSELVES ARE NEVER TESTED)
+        // -----------------------------------------------------------------------------------------------------------------
+        if (occlusionBuffer && !spawnedVisible.empty())
+        {
+            PROFILE_SCOPE("occlusion culling");
+            occlusionBuffer->begin(frameData.projection * frameData.view);
+            occlusionBuffer->addOccluder(containerMesh, containerModel);
+            occlusionBuffer->addOccluder(floorMesh, floorModel);
+            occlusionBuffer->rasterize();
+            occlusionBuffer->cull(spawnedBounds, spawnedVisible);
+            const OcclusionStats& frameOcclusion = occlusionBuffer->Stats;
+            occlusionTotals.OccluderTriangles += frameOcclusion.OccluderTriangles;
+            occlusionTotals.Tested += frameOcclusion.Tested;
+            occlusionTotals.Occluded += frameOcclusion.Occluded;
+            occlusionTotals.RasterMs += frameOcclusion.RasterMs;
+            occlusionTotals.TestMs += frameOcclusion.TestMs;
+        }
 
-        // Render triangle(s)
-        glBindVertexArray(VAO2); // Binds the defined VAO (and automatically the EBO if present) so OpenGL correctly uses vertex data
-        glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, floorIndices.data());
+        // SUBMIT THIS FRAME'S DRAWS, THE QUEUE SORTS THEM BY STATE (AND DEPTH) BEFORE ISSUING ANY
+        // ---------------------------------------------------------------------------------------
+        renderQueue.begin(frameData.view, 100.0f);
+        DrawPacket packet;
+        packet.Pool = meshPool;
+        // With --indirect the spawned containers are commands of the batch instead, and so are the container & floor with
+        // --materials (which binds no per-draw texture), then the batch goes in as one packet
+        bool sceneInBatch = indirectBatch && materials;
+        if (indirectBatch)
+            indirectBatch->clear();
+
+        // Container
+        packet.Program = shader;
+        packet.Texture = materials ? 0 : wallTexture->id();
+        packet.Material = wallMaterial.id();
+        packet.Mesh = containerHandle;
+        packet.Model = containerModel;
+        packet.Timing = "container";
+        if (sceneInBatch)
+            indirectBatch->add(containerHandle, containerModel, packet.Material);
+        else
+            renderQueue.submit(packet);
+
+        // Spawned containers (same VAO & texture): all of them in one instanced draw that reads each model matrix from
+        // the instance buffer, or one draw each
+        packet.Timing = "spawned containers";
+        if (indirectBatch)
+        {
+            for (uint32_t i : spawnedVisible)
+                indirectBatch->add(containerHandle, spawnedModels[i], spawnedMaterials[i]);
+        }
+        else if (!spawnedVisible.empty() && RunOptions.instancing)
+        {
+            // Only the visible ones' instance data, compacted: written to this frame's ring region with the attributes moved
+            // there, or (--no-ring, or the region overflowed) to the front of each part of the instance buffer
+            if (compactInstances)
+            {
+                size_t count = spawnedVisible.size(), modelOffset = 0, materialOffset = 0;
+                mat4* models = streamRing ? (mat4*)streamRing->allocate(count * sizeof(mat4), sizeof(vec4), modelOffset) : NULL;
+                int* ids = models ? (int*)streamRing->allocate(count * sizeof(int), sizeof(int), materialOffset) : NULL;
+                if (ids)
+                {
+                    for (size_t n = 0; n < count; n++)
+                    {
+                        models[n] = spawnedModels[spawnedVisible[n]];
+                        ids[n] = spawnedMaterials[spawnedVisible[n]];
+                    }
+                    streamRing->flush();
+                    pointInstanceAttributes(meshPool->VAO, streamRing->Buffer, modelOffset, materialOffset);
+                }
+                else
+                {
+                    visibleModels.clear();
+                    visibleMaterials.clear();
+                    for (uint32_t i : spawnedVisible)
+                    {
+                        visibleModels.push_back(spawnedModels[i]);
+                        visibleMaterials.push_back(spawnedMaterials[i]);
+                    }
+                    GLState.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+                    glBufferSubData(GL_ARRAY_BUFFER, 0, visibleModels.size() * sizeof(mat4), visibleModels.data());
+                    glBufferSubData(GL_ARRAY_BUFFER, spawnedModels.size() * sizeof(mat4), visibleMaterials.size() * sizeof(int), visibleMaterials.data());
+                    GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+                    if (streamRing)
+                        pointInstanceAttributes(meshPool->VAO, instanceVBO, 0, spawnedModels.size() * sizeof(mat4));
+                }
+            }
+            DrawPacket instanced = packet;
+            instanced.Program = instancedShader;
+            instanced.Material = -1;    // Per instance
+            instanced.Instances = (GLsizei)spawnedVisible.size();
+            renderQueue.submit(instanced);
+        }
+        else if (!RunOptions.instancing)
+        {
+            for (uint32_t i : spawnedVisible)
+            {
+                packet.Model = spawnedModels[i];
+                packet.Material = spawnedMaterials[i];
+                renderQueue.submit(packet);
+            }
+        }
+
+        // Floor, same VAO as the container, just a different range of the shared buffers (with --atlas the same texture too)
+        packet.Texture = materials ? 0 : floorTexture->id();
+        packet.Material = floorMaterial.id();
+        packet.Mesh = floorHandle;
+        packet.Model = floorModel;
+        packet.Timing = "floor";
+        if (sceneInBatch)
+            indirectBatch->add(floorHandle, floorModel, packet.Material);
+        else
+            renderQueue.submit(packet);
+
+        // The batch reads its per-draw data the way instanced draws do, so it goes through the instanced program
+        if (indirectBatch && indirectBatch->size() > 0)
+        {
+            indirectBatch->upload(streamRing);
+            if (streamRing)
+                streamRing->flush();
+            DrawPacket batched;
+            batched.Program = instancedShader;
+            batched.Texture = materials ? 0 : wallTexture->id();
+            batched.Batch = indirectBatch;
+            batched.Timing = "indirect batch";
+            renderQueue.submit(batched);
+        }
+
+        {
+            PROFILE_SCOPE("draws");
+            renderQueue.execute();
+        }
+        if (streamRing)
+            streamRing->endFrame();     // Fences this frame's region, once every draw reading it is issued
+        drawCalls = (int)renderQueue.Stats.Draws;
+        queueTotals.ProgramSwitches += renderQueue.Stats.ProgramSwitches;
+        queueTotals.TextureSwitches += renderQueue.Stats.TextureSwitches;
+        queueTotals.VaoSwitches += renderQueue.Stats.VaoSwitches;
+        if (gpuTimer)
+            gpuTimer->endFrame();
+
+        if (RunOptions.headless)
+        {
+            // No swap to wait on, so finish the frame explicitly, otherwise only command submission would be timed
+            {
+                PROFILE_SCOPE("glFinish");
+                glFinish();
+            }
+            std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+            stats.AddFrame(frameTime.count());
+            TimeStruct.deltaTime = (float)(frameTime.count() / 1000.0);
+            if (regression)
+            {
+                bool capture = regression->captureFrame(frameCount);
+                if (capture)
+                    headless->readPixels(framePixels);     // After the frame is timed
+                regression->endFrame(frameCount, frameTime.count(), drawCalls, capture ? &framePixels : NULL, SCR_WIDTH, SCR_HEIGHT);
+            }
+            frameCount++;
+            continue;
+        }
 
         // GLFW: POLL & CALL IOEVENTS + SWAP BUFFERS
         // -----------------------------------------
-        glfwSwapBuffers(window);    // For reader - search 'double buffer'
+        {
+            PROFILE_SCOPE("glfwSwapBuffers");
+            glfwSwapBuffers(window);    // For reader - search 'double buffer'
+        }
         glfwPollEvents();
 
         // Calculate delta time
@@ -208,14 +643,63 @@ int main()
         TimeStruct.deltaTime = currentFrame - TimeStruct.lastFrame;
         TimeStruct.lastFrame = currentFrame; 
     }
+    if (RunOptions.headless)
+    {
+        std::cout << "Renderer: " << glGetString(GL_RENDERER) << " (" << SCR_WIDTH << "x" << SCR_HEIGHT << ")" << std::endl;
+        stats.Report();
+        const char* spawnMode = indirectBatch ? indirectBatch->pathName() : RunOptions.instancing ? "instanced" : "one draw each";
+        std::cout << "spawned containers: " << spawnedModels.size() << " (" << spawnMode << "), draw calls per frame: " << drawCalls << std::endl;
+        if (indirectBatch)
+            std::cout << "indirect commands per frame: " << indirectBatch->size() << std::endl;
+        if (streamRing)
+            streamRing->report();
+        if (RunOptions.culling)
+            printf("frustum culling (%s): %.1f of %zu spawned containers culled per frame, %.4f ms per frame\n", cullSimdName(CULL_SIMD_BEST),
+                   (double)culledTotal / frameCount, spawnedModels.size(), cullMs / frameCount);
+        if (occlusionBuffer)
+            printf("occlusion culling (%dx%d, %u threads): %.1f of %.1f tested containers occluded per frame, %.1f occluder triangles, %.4f ms raster + %.4f ms test per frame\n",
+                   occlusionBuffer->width(), occlusionBuffer->height(), workerPool->threadCount(), (double)occlusionTotals.Occluded / frameCount,
+                   (double)occlusionTotals.Tested / frameCount, (double)occlusionTotals.OccluderTriangles / frameCount,
+                   occlusionTotals.RasterMs / frameCount, occlusionTotals.TestMs / frameCount);
+        printf("state switches per frame: %.1f program, %.1f texture, %.1f VAO\n", (double)queueTotals.ProgramSwitches / frameCount,
+               (double)queueTotals.TextureSwitches / frameCount, (double)queueTotals.VaoSwitches / frameCount);
+        GLState.report(frameCount);
+        textureLoader->report();
+        std::cout << "string uniform lookups: " << Shader::StringLookups << std::endl;
+    }
+    if (gpuTimer)
+    {
+        gpuTimer->finish();
+        gpuTimer->report();
+    }
+    bool regressionPassed = !regression || regression->finish();
+    delete regression;
+    if (RunOptions.profile)
+        writeProfile();
 
     // OPTIONAL: DE-ALLOC ALL RESOURCES ONCE PURPOSES ARE OUTLIVED
     // -----------------------------------------------------------
-    unsigned VAOs[2] = {VAO1, VAO2};
-    unsigned VBOs[2] = {VBO1, VBO2};
-    glDeleteVertexArrays(2, VAOs);
-    glDeleteBuffers(2, VBOs);
+    delete gpuTimer;
+    delete indirectBatch;
+    delete streamRing;
+    delete occlusionBuffer;
+    delete workerPool;
+    delete meshPool;
+    if (instanceVBO) GLState.deleteBuffers(1, &instanceVBO);
+    wallTexture.reset();    // Textures are reference counted, the GL objects go once the last user lets go
+    floorTexture.reset();
+    delete textureLoader;
+    delete assetPack;       // After the loader, its uploads read straight from the mapping
+    delete materials;
     delete shader;
+    delete instancedShader;
+    delete frameUniforms;
+
+    if (headless)
+    {
+        delete headless;
+        return regressionPassed ? 0 : 1;
+    }
 
     // GLFW: TERMINATE GLFW, CLEARING ALL PREVIOUSLY ALLOCATED GLFW RESOURCES
     glfwTerminate();
@@ -223,6 +707,100 @@ int main()
 }
 
 
+// PARSES COMMAND LINE OPTIONS: --headless --frames N --size WxH
+// -------------------------------------------------------------
+bool parseArgs(int argc, char** argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+            RunOptions.headless = true;
+        else if (strcmp(argv[i], "--no-shader-cache") == 0)
+            Shader::CacheDirectory.clear();
+        else if (strcmp(argv[i], "--containers") == 0 && i + 1 < argc)
+            RunOptions.containers = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--no-instancing") == 0)
+            RunOptions.instancing = false;
+        else if (strcmp(argv[i], "--mip-benchmark") == 0)
+            RunOptions.mipBenchmark = true;
+        else if (strcmp(argv[i], "--pack") == 0 && i + 1 < argc)
+            RunOptions.pack = argv[++i];
+        else if (strcmp(argv[i], "--atlas") == 0)
+            RunOptions.atlas = true;
+        else if (strcmp(argv[i], "--materials") == 0)
+            RunOptions.materials = true;
+        else if (strcmp(argv[i], "--indirect") == 0)
+            RunOptions.indirect = true;
+        else if (strcmp(argv[i], "--no-culling") == 0)
+            RunOptions.culling = false;
+        else if (strcmp(argv[i], "--cull-benchmark") == 0)
+            RunOptions.cullBenchmark = true;
+        else if (strcmp(argv[i], "--profile") == 0 && i + 1 < argc)
+            RunOptions.profile = argv[++i];
+        else if (strcmp(argv[i], "--regress") == 0 && i + 1 < argc)
+        {
+            RunOptions.regress = argv[++i];
+            RunOptions.headless = true;     // Frames are read back from the offscreen framebuffer
+        }
+        else if (strcmp(argv[i], "--regress-update") == 0)
+            RunOptions.regressUpdate = true;
+        else if (strcmp(argv[i], "--regress-threshold") == 0 && i + 1 < argc)
+            RunOptions.regressThreshold = atof(argv[++i]);
+        else if (strcmp(argv[i], "--software") == 0)
+            RunOptions.software = true;
+        else if (strcmp(argv[i], "--occlusion") == 0)
+            RunOptions.occlusion = true;
+        else if (strcmp(argv[i], "--no-ring") == 0)
+            RunOptions.ring = false;
+        else if (strcmp(argv[i], "--no-state-cache") == 0)
+            RunOptions.stateCache = false;
+        else if (strcmp(argv[i], "--gpu-timing") == 0)
+            RunOptions.gpuTiming = true;
+        else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+            RunOptions.frames = atoi(argv[++i]);
+        else if (strcmp(argv[i], "--size") == 0 && i + 1 < argc)
+        {
+            if (sscanf(argv[++i], "%dx%d", &SCR_WIDTH, &SCR_HEIGHT) != 2 || SCR_WIDTH <= 0 || SCR_HEIGHT <= 0)
+            {
+                std::cout << "Invalid --size, expected WxH (e.g. 1920x1080)" << std::endl;
+                return false;
+            }
+        }
+        else
+        {
+            std::cout << "Usage: " << argv[0] << " [--headless] [--frames N] [--size WxH] [--no-shader-cache] [--containers N] [--no-instancing] [--mip-benchmark] [--pack FILE] [--atlas] [--materials] [--indirect] [--no-ring] [--no-culling] [--cull-benchmark] [--profile FILE] [--regress DIR] [--regress-update] [--regress-threshold PCT] [--software] [--occlusion] [--no-state-cache] [--gpu-timing]" << std::endl;
+            return false;
+        }
+    }
+    if (RunOptions.frames <= 0 || RunOptions.containers < 0)
+    {
+        std::cout << "--frames has to be > 0 and --containers >= 0" << std::endl;
+        return false;
+    }
+    if (RunOptions.atlas && RunOptions.materials)
+    {
+        std::cout << "--atlas and --materials are alternatives, pick one" << std::endl;
+        return false;
+    }
+    if (RunOptions.indirect && !RunOptions.instancing)
+    {
+        std::cout << "--indirect and --no-instancing are alternatives, pick one" << std::endl;
+        return false;
+    }
+    if (RunOptions.regressUpdate && !RunOptions.regress)
+    {
+        std::cout << "--regress-update needs --regress DIR" << std::endl;
+        return false;
+    }
+    if (RunOptions.software && (RunOptions.pack || RunOptions.atlas || RunOptions.materials || RunOptions.indirect || RunOptions.occlusion || RunOptions.gpuTiming))
+    {
+        std::cout << "--software renders the plain scene from loose files, without --pack, --atlas, --materials, --indirect, --occlusion or --gpu-timing" << std::endl;
+        return false;
+    }
+    return true;
+}
+
+
 // GLFW: INIT & SETUP WINDOW OBJECT
 // --------------------------------
 GLFWwindow* configGLFW()
@@ -255,80 +833,372 @@ GLFWwindow* configGLFW()
     return window;
 }
 
-// INIT VERTEX BUFFER (VBO), INIT INDEX DRAWING BUFFER (EBO), AND CONFIG VERTEX ATTRIBUTES (VAO)
-// ---------------------------------------------------------------------------------------------
-void configBuffers(unsigned& VBO, unsigned& VAO, const std::vector<float>& vertices)
+// ADD A PER-INSTANCE MODEL MATRIX ATTRIBUTE (LOCATIONS 3-6) TO AN EXISTING VAO
+// ----------------------------------------------------------------------------
+void configInstanceBuffer(unsigned& instanceVBO, unsigned VAO, const std::vector<mat4>& models, const std::vector<int>& materials)
 {
-    // INIT & BIND VAO THAT STORES STATE CONFIGS FOR SUPPLYING INTERPRETABLE VERTEX DATA TO OPENGL
-    glGenVertexArrays(1, &VAO); // // Generates the object and stores the resulting id in passed in integer
-    glBindVertexArray(VAO); // Binds 'VAO' as current active vertex array object
-
-    // INIT, BIND & SET VBO THAT STORES MANY VERTICES IN GPU MEM FOR SPEEDY GPU ACCESS
-    glGenBuffers(1, &VBO);
-
-    glBindBuffer(GL_ARRAY_BUFFER, VBO);  // Binds newly created object to the correct buffer type, which when updated/configured will update 'VBO' (as seen below)
-    glBufferData(GL_ARRAY_BUFFER, size(vertices) * sizeof(float), vertices.data(), GL_STATIC_DRAW);  // Copies vertex data into the buffer
-
-    // CONFIG VAO
-    glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);                     // Describes to OpenGL how to interpet vertex POSITION data
-    glVertexAttribPointer(2, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));   // Describes to OpenGL how to interpet vertex TEXTURE data
-    // Enable vertex attributes at location = n, since they are disabled by default
-    glEnableVertexAttribArray(0);
-    glEnableVertexAttribArray(1);
-    glEnableVertexAttribArray(2);
-
-    // UNBIND VBO FROM CURRENT ACTIVE BUFFER
-    glBindBuffer(GL_ARRAY_BUFFER, 0); // This is allowed, the call to glVertexAttribPointer registered 'VBO' as the vertex attribute's bound VBO, so can safely unbind after
+    GLState.bindVertexArray(VAO);
+
+    // Model matrices first, then the material ids, in one buffer
+    glGenBuffers(1, &instanceVBO);
+    GLState.bindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+    size_t modelBytes = models.size() * sizeof(mat4);
+    glBufferData(GL_ARRAY_BUFFER, modelBytes + materials.size() * sizeof(int), NULL, GL_STATIC_DRAW);
+    glBufferSubData(GL_ARRAY_BUFFER, 0, modelBytes, models.data());
+    glBufferSubData(GL_ARRAY_BUFFER, modelBytes, materials.size() * sizeof(int), materials.data());
+    GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+    pointInstanceAttributes(VAO, instanceVBO, 0, modelBytes);
+    GLState.bindVertexArray(0);
 }
 
-// CONFIG + LOAD TEXTURE (IMAGE HAS TO BE MORE > 24 BIT PER PIXEL)
-// ---------------------------------------------------------------
-void loadTexture(unsigned& texture, std::string imagePath, GLenum sWrap, GLenum tWrap, GLenum minFilter, GLenum maxFilter)
+// POINTS THE VAO'S PER-INSTANCE ATTRIBUTES (3-6: MODEL, 7: MATERIAL) AT TIGHTLY PACKED MODELS & IDS IN 'buffer', LEAVES IT BOUND
+// -------------------------------------------------------------------------------------------------------------------------------
+void pointInstanceAttributes(unsigned VAO, unsigned buffer, size_t modelOffset, size_t materialOffset)
 {
-    // GEN TEXTURE GLOBJECT
-    // --------------------
-    glGenTextures(1, &texture);
-    glBindTexture(GL_TEXTURE_2D, texture);
-
-    // CONFIG WRAPPING & FILTERING
-    // ---------------------------
-    // Config texture wrapping for s & t axes (x & y)
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, sWrap);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, tWrap);
-
-    // Config upscaling and downscaling texture filtering methods
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);   // Downscaling
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, maxFilter);   // Upscaling
-
-    // LOAD TEXTURE FROM IMAGE (IMAGE HAS TO BE MORE > 24 BIT PER PIXEL)
-    // -----------------------------------------------------------------
-    int width, height, nrChannels;
-    stbi_set_flip_vertically_on_load(true); // Loads upside-down for some reason
-    unsigned char *data = stbi_load(imagePath.c_str(), &width, &height, &nrChannels, 4);  // Set number of channels to 4 manually (don't know why)
-    nrChannels = 4; 
-    if (data)   // Use previous image data to load texture
+    GLState.bindVertexArray(VAO);
+    GLState.bindBuffer(GL_ARRAY_BUFFER, buffer);
+
+    // A mat4 attribute is fed as 4 vec4 columns on consecutive locations
+    for (int column = 0; column < 4; column++)
     {
-        // Use stbi data to determine image format
-        GLenum internalFormat = nrChannels == 4 ? GL_RGBA8 :
-            nrChannels == 3 ? GL_RGB8 : 0;
-        GLenum dataFormat = nrChannels == 4 ? GL_RGBA :
-            nrChannels == 3 ? GL_RGB : 0;
-
-        glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, width, height, 0, dataFormat, GL_UNSIGNED_BYTE, data);
-        glGenerateMipmap(GL_TEXTURE_2D);    // For reader, search 'OpenGL mipmaps'
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(mat4), (void*)(modelOffset + column * sizeof(vec4)));
+        glEnableVertexAttribArray(3 + column);
+        glVertexAttribDivisor(3 + column, 1);  // Advance once per instance instead of once per vertex
     }
-    else
-        std::cout << "Failed to load texture" << std::endl;  
+    // Integer attribute: the I variant, so the id isn't converted to float
+    glVertexAttribIPointer(7, 1, GL_INT, sizeof(int), (void*)materialOffset);
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+    GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+}
 
-    stbi_image_free(data);  // Free image from memory
-    glBindTexture(GL_TEXTURE_2D, 0);
+// RANDOM (BUT REPRODUCIBLE FOR A GIVEN SEED) CONTAINER TRANSFORMS IN FRONT OF THE CAMERA
+// -------------------------------------------------------------------------------------
+std::vector<mat4> randomTransforms(int count, unsigned seed)
+{
+    std::mt19937 rng(seed);
+    std::uniform_real_distribution<float> xy(-40.0f, 40.0f), depth(-90.0f, -5.0f), unit(-1.0f, 1.0f), angle(0.0f, 360.0f), size(0.25f, 1.5f);
+    std::vector<mat4> models;
+    models.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        mat4 model = translate(mat4(1.0f), vec3(xy(rng), xy(rng), depth(rng)));
+        vec3 axis = vec3(unit(rng), unit(rng), unit(rng));
+        if (length(axis) > 0.001f)
+            model = rotate(model, radians(angle(rng)), normalize(axis));
+        model = scale(model, vec3(size(rng)));
+        models.push_back(model);
+    }
+    return models;
 }
 
+// TIMES THE CPU MIP GENERATOR (EVERY FILTER & INSTRUCTION SET) AGAINST THE DRIVER'S glGenerateMipmap, AVERAGED OVER A FEW RUNS
+// ----------------------------------------------------------------------------------------------------------------------------
+void runMipBenchmark()
+{
+    const char* images[] = {"textures//wall.png", "textures//face1.png", "textures//face2.png", "textures//numbers.png"};
+    const int runs = 10;
+    auto msSince = [](std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    };
+    std::cout << "mip generation (ms per chain, CPU best: " << mipSimdName(MIP_SIMD_BEST) << ")" << std::endl;
+    for (const char* path : images)
+    {
+        int width, height, nrChannels;
+        unsigned char* pixels = stbi_load(path, &width, &height, &nrChannels, 4);
+        if (!pixels)
+        {
+            std::cout << "Failed to load texture: " << path << std::endl;
+            continue;
+        }
+        std::cout << path << " " << width << "x" << height << std::endl;
+
+        // Driver: level 0 is re-specified (untimed) before every run, then the mips are timed until the GPU is done
+        unsigned texture;
+        glGenTextures(1, &texture);
+        GLState.bindTexture(0, GL_TEXTURE_2D, texture);
+        double driverMs = 0.0;
+        for (int run = 0; run < runs; run++)
+        {
+            glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+            glFinish();
+            auto start = std::chrono::steady_clock::now();
+            glGenerateMipmap(GL_TEXTURE_2D);
+            glFinish();
+            driverMs += msSince(start);
+        }
+        printf("  %-28s %8.3f\n", "glGenerateMipmap", driverMs / runs);
+
+        // CPU: generation only, then separately what uploading its levels costs, which the driver path doesn't pay
+        std::vector<MipLevel> levels;
+        for (MipFilter filter : {MIP_FILTER_BOX, MIP_FILTER_KAISER})
+            for (int simd = MIP_SIMD_SCALAR; simd <= detectMipSimd(); simd++)
+            {
+                MipOptions options;
+                options.Filter = filter;
+                options.Simd = (MipSimd)simd;
+                auto start = std::chrono::steady_clock::now();
+                for (int run = 0; run < runs; run++)
+                    levels = generateMipChain(pixels, width, height, 4, options);
+                std::string label = std::string("CPU ") + (filter == MIP_FILTER_BOX ? "box " : "kaiser ") + mipSimdName((MipSimd)simd);
+                printf("  %-28s %8.3f\n", label.c_str(), msSince(start) / runs);
+            }
+        double uploadMs = 0.0;
+        for (int run = 0; run < runs; run++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (size_t level = 0; level < levels.size(); level++)
+                glTexImage2D(GL_TEXTURE_2D, (GLint)level + 1, GL_RGBA8, levels[level].Width, levels[level].Height, 0, GL_RGBA, GL_UNSIGNED_BYTE, levels[level].Pixels.data());
+            glFinish();
+            uploadMs += msSince(start);
+        }
+        printf("  %-28s %8.3f\n", "upload of the CPU levels", uploadMs / runs);
+
+        GLState.deleteTextures(1, &texture);
+        stbi_image_free(pixels);
+    }
+}
+
+// FRUSTUM CULLING KERNELS OVER RANDOM OBJECTS ALL AROUND THE CAMERA (A FEW PERCENT OF THEM VISIBLE)
+// -------------------------------------------------------------------------------------------------
+void runCullBenchmark()
+{
+    Frustum frustum = extractFrustum(perspective(radians(45.0f), 16.0f / 9.0f, 0.1f, 100.0f)
+                                     * lookAt(vec3(0.0f), vec3(0.0f, 0.0f, -1.0f), vec3(0.0f, 1.0f, 0.0f)));
+    LocalBounds cube;
+    cube.Min = vec3(-0.5f);
+    cube.Max = vec3(0.5f);
+    cube.Radius = sqrtf(0.75f);
+    std::mt19937 rng(1234);
+    std::uniform_real_distribution<float> position(-100.0f, 100.0f), unit(-1.0f, 1.0f), angle(0.0f, 360.0f), size(0.25f, 4.0f);
+
+    std::cout << "frustum culling (ms per pass, CPU best: " << cullSimdName(CULL_SIMD_BEST) << ")" << std::endl;
+    std::vector<uint32_t> visible;
+    for (size_t count : {(size_t)10000, (size_t)100000, (size_t)1000000})
+    {
+        CullingBounds bounds;
+        bounds.reserve(count);
+        for (size_t i = 0; i < count; i++)
+        {
+            mat4 model = translate(mat4(1.0f), vec3(position(rng), position(rng), position(rng)));
+            model = rotate(model, radians(angle(rng)), normalize(vec3(unit(rng), unit(rng), unit(rng)) + vec3(0.0f, 0.0f, 1e-3f)));
+            bounds.add(cube, scale(model, vec3(size(rng), size(rng), size(rng))));
+        }
+
+        int runs = (int)std::max((size_t)5, 10000000 / count);
+        size_t scalarVisible = 0;
+        for (int simd = CULL_SIMD_SCALAR; simd <= detectCullSimd(); simd++)
+        {
+            auto start = std::chrono::steady_clock::now();
+            for (int run = 0; run < runs; run++)
+                cullFrustum(frustum, bounds, visible, (CullSimd)simd);
+            double ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() / runs;
+            if (simd == CULL_SIMD_SCALAR)
+                scalarVisible = visible.size();
+            printf("  %7zu objects  %-6s %8.3f  (%.2f ns per object, %zu visible)%s\n", count, cullSimdName((CullSimd)simd), ms,
+                   ms * 1e6 / count, visible.size(), visible.size() == scalarVisible ? "" : "  MISMATCH WITH SCALAR");
+        }
+    }
+}
+
+// RENDERS THE PLAIN SCENE WITH THE CPU RASTERIZER, THE SAME WAY THE GL PATH DOES WITHOUT ANY OPTIONS, AND REPORTS LIKE --headless
+// -------------------------------------------------------------------------------------------------------------------------------
+int runSoftwareRenderer()
+{
+    SoftTexture wallTexture, floorTexture;
+    if (!loadSoftTexture("textures/wall.png", wallTexture) || !loadSoftTexture("textures/face1.png", floorTexture))
+        return -1;
+
+    MeshData containerMesh = buildMesh(CONTAINER_VERTICES, 5, "container");
+    MeshData floorMesh;
+    floorMesh.Vertices = FLOOR_VERTICES;
+    floorMesh.Indices = FLOOR_INDICES;
+    floorMesh.FloatsPerVertex = 5;
+
+    std::vector<mat4> spawnedModels = randomTransforms(RunOptions.containers, 1234);
+    CullingBounds spawnedBounds;
+    LocalBounds containerBounds = computeBounds(containerMesh);
+    spawnedBounds.reserve(spawnedModels.size());
+    for (const mat4& model : spawnedModels)
+        spawnedBounds.add(containerBounds, model);
+    std::vector<uint32_t> spawnedVisible;
+
+    mat4 containerModel = translate(mat4(1.0f), vec3(0.0f, 0.0, -3.0f));
+    mat4 floorModel = rotate(mat4(1.0f), radians(90.0f), vec3(1.0f, 0.0f, 0.0f));
+    floorModel = translate(floorModel, vec3(0.0f, 0.0f, 3.0f));
+    floorModel = scale(floorModel, vec3(10.0f, 10.0f, 10.0f));
+
+    WorkerPool workerPool;
+    SoftRasterizer rasterizer(SCR_WIDTH, SCR_HEIGHT, &workerPool);
+    RegressionRun* regression = RunOptions.regress ? new RegressionRun(RunOptions.regress, "software", RunOptions.frames, RunOptions.regressUpdate, RunOptions.regressThreshold) : NULL;
+    int frames = regression ? regression->totalFrames() : RunOptions.frames;
+    std::vector<unsigned char> framePixels;
+    FrameStats stats(frames);
+    SoftRasterStats totals;     // Summed over all frames
+    size_t spawnedDrawn = 0;
+    for (int frame = 0; frame < frames; frame++)
+    {
+        PROFILE_SCOPE("frame");
+        auto frameStart = std::chrono::steady_clock::now();
+        if (regression)
+            regression->beginFrame(frame, mainCam);
+        mat4 view = mainCam.GetViewMatrix();
+        mat4 projection = perspective(radians(mainCam.Fov), (float)SCR_WIDTH / (float)SCR_HEIGHT, 0.1f, 100.0f);
+        rasterizer.begin(view, projection, vec4(0.2f, 0.3f, 0.3f, 1.0f));
+
+        containerModel = rotate(containerModel, radians(0.5f), vec3(0.5f, 1.0f, 0.0f));    // Rotate over time
+        rasterizer.draw(containerMesh, containerModel, &wallTexture);
+        if (RunOptions.culling)
+            cullFrustum(extractFrustum(projection * view), spawnedBounds, spawnedVisible);
+        else if (spawnedVisible.size() != spawnedModels.size())
+        {
+            spawnedVisible.resize(spawnedModels.size());
+            for (size_t i = 0; i < spawnedVisible.size(); i++)
+                spawnedVisible[i] = (uint32_t)i;
+        }
+        for (uint32_t i : spawnedVisible)
+            rasterizer.draw(containerMesh, spawnedModels[i], &wallTexture);
+        spawnedDrawn += spawnedVisible.size();
+        rasterizer.draw(floorMesh, floorModel, &floorTexture);
+        rasterizer.finish();
+
+        std::chrono::duration<double, std::milli> frameTime = std::chrono::steady_clock::now() - frameStart;
+        stats.AddFrame(frameTime.count());
+        totals.Triangles += rasterizer.Stats.Triangles;
+        totals.Rasterized += rasterizer.Stats.Rasterized;
+        totals.Binned += rasterizer.Stats.Binned;
+        totals.Fragments += rasterizer.Stats.Fragments;
+        totals.GeometryMs += rasterizer.Stats.GeometryMs;
+        totals.RasterMs += rasterizer.Stats.RasterMs;
+        if (regression)
+        {
+            bool capture = regression->captureFrame(frame);
+            if (capture)
+                rasterizer.readPixels(framePixels);
+            regression->endFrame(frame, frameTime.count(), (int)(spawnedVisible.size() + 2), capture ? &framePixels : NULL, SCR_WIDTH, SCR_HEIGHT);
+        }
+    }
+
+    std::cout << "Renderer: software rasterizer, " << workerPool.threadCount() << " threads (" << SCR_WIDTH << "x" << SCR_HEIGHT << ")" << std::endl;
+    stats.Report();
+    printf("spawned containers: %zu, %.1f drawn per frame\n", spawnedModels.size(), (double)spawnedDrawn / frames);
+    printf("triangles per frame: %.1f submitted, %.1f rasterized, %.1f tile bins, %.1f fragments shaded\n", (double)totals.Triangles / frames,
+           (double)totals.Rasterized / frames, (double)totals.Binned / frames, (double)totals.Fragments / frames);
+    printf("software raster (ms per frame): geometry %.3f, tiles %.3f\n", totals.GeometryMs / frames, totals.RasterMs / frames);
+    bool regressionPassed = !regression || regression->finish();
+    delete regression;
+    if (RunOptions.profile)
+        writeProfile();
+    return regressionPassed ? 0 : 1;
+}
+
+// WRITES WHAT THE PROFILER HAS RECORDED SO FAR TO --profile's FILE
+// ---------------------------------------------------------------
+void writeProfile()
+{
+    long events = Profiler.writeChromeTrace(RunOptions.profile);
+    if (events >= 0)
+        std::cout << "profile: " << events << " zones written to " << RunOptions.profile << " (open in chrome://tracing or ui.perfetto.dev)" << std::endl;
+}
+
+// PACKS THE SCENE'S TEXTURES INTO ONE ATLAS, TAKING THEM FROM THE PACK WHEN IT HAS THEM AS RGBA8, ELSE DECODING THE FILES
+// ----------------------------------------------------------------------------------------------------------------------
+bool buildSceneAtlas(const AssetPack* pack, TextureAtlas& atlas)
+{
+    const char* names[] = {"textures/wall.png", "textures/face1.png"};
+    std::vector<AtlasImage> images;
+    std::vector<unsigned char*> decoded;
+    bool loaded = true;
+    stbi_set_flip_vertically_on_load_thread(true);  // Bottom-up, like everything the texture loader uploads
+    for (const char* name : names)
+    {
+        AtlasImage image;
+        image.Name = name;
+        const AssetEntry* entry = pack ? pack->find(name) : NULL;
+        // Only when the blob really holds level 0 (a stale or broken pack falls back to the file, like the other pack readers)
+        if (entry && entry->Type == ASSET_TEXTURE && entry->Params[3] == 0 && entry->Params[2] >= 1 && entry->Params[0] > 0 && entry->Params[1] > 0
+            && entry->Size >= (uint64_t)entry->Params[0] * entry->Params[1] * 4)
+        {
+            image.Width = (int)entry->Params[0];
+            image.Height = (int)entry->Params[1];
+            image.Pixels = pack->data(*entry);  // Level 0 comes first
+        }
+        else
+        {
+            int nrChannels;
+            unsigned char* pixels = stbi_load(name, &image.Width, &image.Height, &nrChannels, 4);
+            if (!pixels)
+            {
+                std::cout << "Failed to load texture: " << name << std::endl;
+                loaded = false;
+                continue;
+            }
+            decoded.push_back(pixels);
+            image.Pixels = pixels;
+        }
+        images.push_back(image);
+    }
+    loaded = loaded && buildAtlas(images, AtlasOptions(), atlas);
+    for (unsigned char* pixels : decoded)
+        stbi_image_free(pixels);
+    return loaded;
+}
+
+// LOADS EVERY TEXTURE OF THE SCENE AS A MATERIAL: FROM THE PACK WHEN IT HAS IT AS RGBA8 (MIPS INCLUDED), ELSE DECODED HERE
+// ------------------------------------------------------------------------------------------------------------------------
+bool loadSceneMaterials(const AssetPack* pack, MaterialLibrary& materials)
+{
+    const char* names[] = {"textures/wall.png", "textures/face1.png", "textures/face2.png", "textures/numbers.png"};
+    MipOptions mipOptions;
+    stbi_set_flip_vertically_on_load_thread(true);  // Bottom-up, like everything the texture loader uploads
+    for (const char* name : names)
+    {
+        int width, height;
+        std::vector<std::vector<unsigned char>> levels;
+        const AssetEntry* entry = pack ? pack->find(name) : NULL;
+        if (entry && entry->Type == ASSET_TEXTURE && entry->Params[3] == 0)
+        {
+            width = (int)entry->Params[0];
+            height = (int)entry->Params[1];
+            size_t offset = 0;
+            for (uint32_t i = 0; i < entry->Params[2]; i++)
+            {
+                size_t bytes = (size_t)std::max(1, width >> i) * std::max(1, height >> i) * 4;
+                if (offset + bytes > entry->Size) break;
+                levels.emplace_back(pack->data(*entry) + offset, pack->data(*entry) + offset + bytes);
+                offset += bytes;
+            }
+        }
+        else
+        {
+            int nrChannels;
+            unsigned char* pixels = stbi_load(name, &width, &height, &nrChannels, 4);
+            if (!pixels)
+            {
+                std::cout << "Failed to load texture: " << name << std::endl;
+                return false;
+            }
+            levels.emplace_back(pixels, pixels + (size_t)width * height * 4);
+            for (MipLevel& level : generateMipChain(pixels, width, height, 4, mipOptions))
+                levels.push_back(std::move(level.Pixels));
+            stbi_image_free(pixels);
+        }
+        materials.add(name, width, height, std::move(levels));
+    }
+    return true;
+}
 
 // PROCESSES INPUT BY QUERING GLFW ABOUT CURRENT FRAME
 // ---------------------------------------------------
 void processInput(GLFWwindow *window)
 {
+    // P writes the profile so far (once per press)
+    static bool profileKeyDown = false;
+    bool profileKey = glfwGetKey(window, GLFW_KEY_P) == GLFW_PRESS;
+    if (profileKey && !profileKeyDown && RunOptions.profile)
+        writeProfile();
+    profileKeyDown = profileKey;
+
     if (glfwGetKey(window, GLFW_KEY_ESCAPE) == GLFW_PRESS)   // GLFW_RELEASE RETURNED FROM GetKey IF NOT PRESSED 
         glfwSetWindowShouldClose(window, true);
     else if (glfwGetKey(window, GLFW_KEY_W) == GLFW_PRESS)
@@ -350,7 +1220,7 @@ void processInput(GLFWwindow *window)
 // --------------------------------------------------------
 void framebufferSizeCallback(GLFWwindow* window, int width, int height)
 {
-    glViewport(0, 0, width, height);
+    GLState.viewport(0, 0, width, height);
     mainCam.Mouse.PrevPos = vec2(width / 2.0f, height / 2.0f);
 }
 
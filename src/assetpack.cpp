@@ -0,0 +1,256 @@
+#include "assetpack.h"
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+static_assert(sizeof(AssetPackHeader) == 64, "asset pack header must match the file layout");
+static_assert(sizeof(AssetEntry) == 64, "asset pack entries must match the file layout");
+
+unsigned long long hashBytes(const void* data, size_t bytes)
+{
+    const unsigned char* p = (const unsigned char*)data;
+    uint64_t hash = 0x9E3779B97F4A7C15ULL ^ bytes;
+    size_t i = 0;
+    for (; i + 8 <= bytes; i += 8)
+    {
+        uint64_t word;
+        memcpy(&word, p + i, 8);
+        hash = (hash ^ word) * 0xFF51AFD7ED558CCDULL;
+        hash ^= hash >> 32;
+    }
+    for (; i < bytes; i++)
+        hash = (hash ^ p[i]) * 0x100000001B3ULL;
+    return hash;
+}
+
+// READING
+// -------
+AssetPack::AssetPack(const std::string& path) : Path(path)
+{
+    // MAP THE WHOLE FILE READ-ONLY, PAGES ARE ONLY READ FROM DISK WHEN SOMETHING TOUCHES THEM
+    // -----------------------------------------------------------------------------------------
+#ifdef _WIN32
+    fileHandle = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+    if (fileHandle == INVALID_HANDLE_VALUE)
+    {
+        fileHandle = NULL;
+        std::cout << "ERROR::ASSETPACK::CANNOT_OPEN " << path << std::endl;
+        return;
+    }
+    LARGE_INTEGER fileSize;
+    GetFileSizeEx(fileHandle, &fileSize);
+    size = (size_t)fileSize.QuadPart;
+    mappingHandle = size ? CreateFileMappingA(fileHandle, NULL, PAGE_READONLY, 0, 0, NULL) : NULL;
+    base = mappingHandle ? (const unsigned char*)MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, 0) : NULL;
+#else
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+    {
+        std::cout << "ERROR::ASSETPACK::CANNOT_OPEN " << path << std::endl;
+        return;
+    }
+    struct stat info;
+    if (fstat(fd, &info) == 0 && info.st_size > 0)
+    {
+        size = (size_t)info.st_size;
+        void* mapped = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        base = mapped == MAP_FAILED ? NULL : (const unsigned char*)mapped;
+    }
+    close(fd);  // The mapping keeps the file alive
+#endif
+    if (base == NULL)
+    {
+        std::cout << "ERROR::ASSETPACK::CANNOT_MAP " << path << std::endl;
+        return;
+    }
+
+    // VALIDATE THE HEADER & TABLE OF CONTENTS, SO LATER ACCESSES CAN'T RUN OFF THE MAPPING
+    // ------------------------------------------------------------------------------------
+    header = (const AssetPackHeader*)base;
+    bool valid = size >= sizeof(AssetPackHeader) && memcmp(header->Magic, "GLAP", 4) == 0 && header->Version == ASSET_PACK_VERSION
+        && header->FileSize == size && header->TocOffset % 8 == 0
+        && (uint64_t)header->AssetCount * sizeof(AssetEntry) <= size && header->TocOffset <= size - (uint64_t)header->AssetCount * sizeof(AssetEntry)
+        && header->NamesSize <= size && header->NamesOffset <= size - header->NamesSize;   // (subtracted, a crafted sum could wrap)
+    if (valid)
+    {
+        entries = (const AssetEntry*)(base + header->TocOffset);
+        for (uint32_t i = 0; i < header->AssetCount && valid; i++)
+        {
+            const AssetEntry& entry = entries[i];
+            valid = entry.Size <= size && entry.Offset <= size - entry.Size && (uint64_t)entry.NameOffset + entry.NameLength <= header->NamesSize;
+            if (valid)
+                index[name(entry)] = i;
+        }
+    }
+    if (!valid)
+    {
+        std::cout << "ERROR::ASSETPACK::CORRUPT_OR_WRONG_VERSION " << path << std::endl;
+        entries = NULL;
+        index.clear();
+        return;
+    }
+    Valid = true;
+}
+
+AssetPack::~AssetPack()
+{
+#ifdef _WIN32
+    if (base) UnmapViewOfFile(base);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    if (fileHandle) CloseHandle(fileHandle);
+#else
+    if (base) munmap((void*)base, size);
+#endif
+}
+
+const AssetEntry* AssetPack::find(const std::string& name) const
+{
+    auto found = index.find(name);
+    return found == index.end() ? NULL : &entries[found->second];
+}
+
+std::string AssetPack::name(const AssetEntry& entry) const
+{
+    return std::string((const char*)base + header->NamesOffset + entry.NameOffset, entry.NameLength);
+}
+
+void AssetPack::prefetch(const AssetEntry& entry) const
+{
+#ifndef _WIN32
+    // madvise wants a page aligned start
+    size_t page = (size_t)sysconf(_SC_PAGESIZE);
+    size_t start = (size_t)entry.Offset / page * page;
+    posix_madvise((void*)(base + start), (size_t)(entry.Offset + entry.Size - start), POSIX_MADV_WILLNEED);
+#else
+    (void)entry;    // Windows faults the pages in on first touch, PrefetchVirtualMemory needs 8+ and isn't worth the dependency
+#endif
+}
+
+bool AssetPack::verify(const AssetEntry& entry) const
+{
+    return hashBytes(data(entry), (size_t)entry.Size) == entry.Hash;
+}
+
+// WRITING
+// -------
+void AssetPackWriter::addRaw(const std::string& name, const void* data, size_t bytes, AssetType type, const uint32_t* params)
+{
+    Pending asset;
+    asset.name = name;
+    asset.type = type;
+    for (int i = 0; i < 5; i++)
+        asset.params[i] = params ? params[i] : 0;
+    asset.blob.assign((const unsigned char*)data, (const unsigned char*)data + bytes);
+    asset.hash = hashBytes(data, bytes);
+    assets.push_back(std::move(asset));
+}
+
+void AssetPackWriter::addTexture(const std::string& name, int width, int height, unsigned vkFormat, const std::vector<std::vector<unsigned char>>& levels)
+{
+    std::vector<unsigned char> blob;
+    for (const std::vector<unsigned char>& level : levels)
+        blob.insert(blob.end(), level.begin(), level.end());
+    uint32_t params[5] = {(uint32_t)width, (uint32_t)height, (uint32_t)levels.size(), vkFormat, 0};
+    addRaw(name, blob.data(), blob.size(), ASSET_TEXTURE, params);
+}
+
+void AssetPackWriter::addMesh(const std::string& name, const MeshData& mesh)
+{
+    std::vector<unsigned char> blob(mesh.Vertices.size() * sizeof(float) + mesh.Indices.size() * sizeof(unsigned));
+    memcpy(blob.data(), mesh.Vertices.data(), mesh.Vertices.size() * sizeof(float));
+    memcpy(blob.data() + mesh.Vertices.size() * sizeof(float), mesh.Indices.data(), mesh.Indices.size() * sizeof(unsigned));
+    uint32_t params[5] = {(uint32_t)mesh.FloatsPerVertex, (uint32_t)mesh.VertexCount(), (uint32_t)mesh.Indices.size(), 0, 0};
+    addRaw(name, blob.data(), blob.size(), ASSET_MESH, params);
+}
+
+void AssetPackWriter::addShader(const std::string& name, const std::string& source)
+{
+    addRaw(name, source.data(), source.size(), ASSET_SHADER);
+}
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool AssetPackWriter::write(const std::string& path) const
+{
+    // LAYOUT: HEADER, TABLE OF CONTENTS, NAMES, THEN ALIGNED BLOBS (IDENTICAL BLOBS SHARE ONE COPY)
+    // ---------------------------------------------------------------------------------------------
+    AssetPackHeader header = {};
+    memcpy(header.Magic, "GLAP", 4);
+    header.Version = ASSET_PACK_VERSION;
+    header.AssetCount = (uint32_t)assets.size();
+    header.Alignment = ASSET_ALIGNMENT;
+    header.TocOffset = sizeof(AssetPackHeader);
+
+    std::string names;
+    std::vector<AssetEntry> entries(assets.size());
+    for (size_t i = 0; i < assets.size(); i++)
+    {
+        memset(&entries[i], 0, sizeof(AssetEntry));
+        entries[i].NameOffset = (uint32_t)names.size();
+        entries[i].NameLength = (uint32_t)assets[i].name.size();
+        names += assets[i].name;
+    }
+    header.NamesOffset = header.TocOffset + entries.size() * sizeof(AssetEntry);
+    header.NamesSize = names.size();
+
+    uint64_t offset = header.NamesOffset + header.NamesSize;
+    std::vector<size_t> writeOrder;     // Assets whose blob is actually stored
+    for (size_t i = 0; i < assets.size(); i++)
+    {
+        const Pending& asset = assets[i];
+        entries[i].Size = asset.blob.size();
+        entries[i].Hash = asset.hash;
+        entries[i].Type = asset.type;
+        memcpy(entries[i].Params, asset.params, sizeof(asset.params));
+
+        size_t duplicate = i;
+        for (size_t j : writeOrder)
+            if (assets[j].hash == asset.hash && assets[j].blob == asset.blob)
+            {
+                duplicate = j;
+                break;
+            }
+        if (duplicate != i)
+        {
+            entries[i].Offset = entries[duplicate].Offset;
+            continue;
+        }
+        offset = alignUp(offset, ASSET_ALIGNMENT);
+        entries[i].Offset = offset;
+        offset += asset.blob.size();
+        writeOrder.push_back(i);
+    }
+    header.FileSize = offset;
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "ERROR::ASSETPACK::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)entries.data(), entries.size() * sizeof(AssetEntry));
+    file.write(names.data(), names.size());
+    uint64_t written = header.NamesOffset + header.NamesSize;
+    const char padding[ASSET_ALIGNMENT] = {};
+    for (size_t i : writeOrder)
+    {
+        file.write(padding, entries[i].Offset - written);
+        file.write((const char*)assets[i].blob.data(), assets[i].blob.size());
+        written = entries[i].Offset + assets[i].blob.size();
+    }
+    return (bool)file;
+}
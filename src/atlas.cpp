@@ -0,0 +1,217 @@
+#include "atlas.h"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+// PACKING
+// -------
+SkylinePacker::SkylinePacker(int width, int height) : width(width), height(height)
+{
+    skyline.push_back({0, 0, width});
+}
+
+int SkylinePacker::fitAt(size_t index, int rectWidth, int rectHeight) const
+{
+    if (skyline[index].x + rectWidth > width) return -1;
+    // Rests on the highest segment under its span
+    int y = 0;
+    for (int remaining = rectWidth; remaining > 0; index++)
+    {
+        y = std::max(y, skyline[index].y);
+        if (y + rectHeight > height) return -1;
+        remaining -= skyline[index].width;
+    }
+    return y;
+}
+
+bool SkylinePacker::insert(int rectWidth, int rectHeight, int& x, int& y)
+{
+    // LOWEST TOP EDGE WINS, THE LEFTMOST ON TIES
+    // ------------------------------------------
+    size_t best = skyline.size();
+    int bestY = 0;
+    for (size_t i = 0; i < skyline.size(); i++)
+    {
+        int fitY = fitAt(i, rectWidth, rectHeight);
+        if (fitY >= 0 && (best == skyline.size() || fitY < bestY))
+        {
+            best = i;
+            bestY = fitY;
+        }
+    }
+    if (best == skyline.size()) return false;
+    x = skyline[best].x;
+    y = bestY;
+
+    // RAISE THE OUTLINE OVER THE NEW RECTANGLE, TRIMMING THE SEGMENTS IT COVERS
+    // -------------------------------------------------------------------------
+    skyline.insert(skyline.begin() + best, {x, y + rectHeight, rectWidth});
+    size_t i = best + 1;
+    while (i < skyline.size() && skyline[i].x < x + rectWidth)
+    {
+        int covered = x + rectWidth - skyline[i].x;
+        if (covered >= skyline[i].width)
+        {
+            skyline.erase(skyline.begin() + i);
+            continue;
+        }
+        skyline[i].x += covered;
+        skyline[i].width -= covered;
+        break;
+    }
+    for (i = 0; i + 1 < skyline.size(); )
+    {
+        if (skyline[i].y == skyline[i + 1].y)
+        {
+            skyline[i].width += skyline[i + 1].width;
+            skyline.erase(skyline.begin() + i + 1);
+        }
+        else
+            i++;
+    }
+    return true;
+}
+
+// BUILDING
+// --------
+static int roundUp(int value, int multiple)
+{
+    return (value + multiple - 1) / multiple * multiple;
+}
+
+// Source texel for a gutter texel 'i' texels off an image edge of 'size' texels
+static int gutterSource(int i, int size, bool wrap)
+{
+    if (wrap) return ((i % size) + size) % size;
+    return std::min(std::max(i, 0), size - 1);
+}
+
+bool buildAtlas(const std::vector<AtlasImage>& images, const AtlasOptions& options, TextureAtlas& atlas)
+{
+    int padding = options.Padding;
+    if (padding < 0 || (padding & (padding - 1)) != 0)
+    {
+        std::cout << "ERROR::ATLAS::PADDING_NOT_POWER_OF_TWO " << padding << std::endl;
+        return false;
+    }
+
+    // Cells are the images plus gutters, rounded up to the padding so every cell (and image) starts on a multiple of it:
+    // then a level-k texel (2^k level-0 texels, aligned) never straddles two cells for k <= log2(padding)
+    int alignment = std::max(1, padding);
+    std::vector<int> cellWidth(images.size()), cellHeight(images.size()), cellX(images.size()), cellY(images.size());
+    int widest = 1;
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        cellWidth[i] = roundUp(images[i].Width + 2 * padding, alignment);
+        cellHeight[i] = roundUp(images[i].Height + 2 * padding, alignment);
+        widest = std::max(widest, cellWidth[i]);
+    }
+    std::vector<size_t> order(images.size());
+    for (size_t i = 0; i < order.size(); i++)
+        order[i] = i;
+    std::sort(order.begin(), order.end(), [&](size_t a, size_t b) {
+        return cellHeight[a] != cellHeight[b] ? cellHeight[a] > cellHeight[b] : cellWidth[a] > cellWidth[b];
+    });
+
+    // TRY EVERY POWER-OF-TWO WIDTH, TRIMMING THE HEIGHT TO WHAT THE PACK USED, AND KEEP THE SMALLEST
+    // (A MULTIPLE OF THE PADDING IS ENOUGH FOR THE HEIGHT, EVERY KEPT MIP LEVEL STILL HALVES EXACTLY)
+    // ---------------------------------------------------------------------------------------------
+    int width = 0, height = 0;
+    std::vector<int> packedX(images.size()), packedY(images.size());
+    for (int tryWidth = 1; tryWidth <= options.MaxSize; tryWidth *= 2)
+    {
+        if (tryWidth < widest) continue;
+        SkylinePacker packer(tryWidth, options.MaxSize);
+        int top = 0;
+        bool packed = true;
+        for (size_t i : order)
+        {
+            if (!packer.insert(cellWidth[i], cellHeight[i], packedX[i], packedY[i]))
+            {
+                packed = false;
+                break;
+            }
+            top = std::max(top, packedY[i] + cellHeight[i]);
+        }
+        top = roundUp(std::max(top, 1), alignment);
+        if (packed && (width == 0 || (size_t)tryWidth * top < (size_t)width * height))
+        {
+            width = tryWidth;
+            height = top;
+            cellX = packedX;
+            cellY = packedY;
+        }
+    }
+    if (width == 0)
+    {
+        std::cout << "ERROR::ATLAS::TOO_SMALL " << images.size() << " images don't fit in " << options.MaxSize << "x" << options.MaxSize << std::endl;
+        return false;
+    }
+
+    // COPY EVERY IMAGE INTO ITS CELL, FILLING THE GUTTERS SO FILTERING ACROSS THE EDGE SEES WHAT GL_REPEAT/GL_CLAMP_TO_EDGE WOULD
+    // --------------------------------------------------------------------------------------------------------------------------
+    atlas.Width = width;
+    atlas.Height = height;
+    atlas.Regions.clear();
+    atlas.Levels.assign(1, std::vector<unsigned char>((size_t)width * height * 4, 0));
+    unsigned char* pixels = atlas.Levels[0].data();
+    size_t used = 0;
+    for (size_t i = 0; i < images.size(); i++)
+    {
+        const AtlasImage& image = images[i];
+        for (int y = 0; y < cellHeight[i]; y++)
+        {
+            int sourceY = gutterSource(y - padding, image.Height, image.Wrap);
+            for (int x = 0; x < cellWidth[i]; x++)
+            {
+                int sourceX = gutterSource(x - padding, image.Width, image.Wrap);
+                memcpy(pixels + ((size_t)(cellY[i] + y) * width + cellX[i] + x) * 4,
+                       image.Pixels + ((size_t)sourceY * image.Width + sourceX) * 4, 4);
+            }
+        }
+
+        AtlasRegion region;
+        region.X = cellX[i] + padding;
+        region.Y = cellY[i] + padding;
+        region.Width = image.Width;
+        region.Height = image.Height;
+        region.UMin = (float)region.X / width;
+        region.VMin = (float)region.Y / height;
+        region.UMax = (float)(region.X + region.Width) / width;
+        region.VMax = (float)(region.Y + region.Height) / height;
+        atlas.Regions[image.Name] = region;
+        used += (size_t)image.Width * image.Height;
+    }
+    atlas.Occupancy = (float)used / ((float)width * height);
+
+    // MIPS, ONLY AS DEEP AS THE GUTTERS KEEP THE IMAGES APART
+    // -------------------------------------------------------
+    int maxLevel = 0;
+    while ((1 << (maxLevel + 1)) <= padding) maxLevel++;
+    std::vector<MipLevel> chain = generateMipChain(pixels, width, height, 4, options.Mipmaps);
+    for (int level = 0; level < maxLevel && level < (int)chain.size(); level++)
+        atlas.Levels.push_back(std::move(chain[level].Pixels));
+
+    std::cout << "ATLAS::BUILT " << width << "x" << height << ", " << images.size() << " images, "
+              << (int)(atlas.Occupancy * 100.0f + 0.5f) << "% occupied, " << atlas.Levels.size() << " mip levels" << std::endl;
+    for (const auto& entry : atlas.Regions)
+        std::cout << "  " << entry.first << " at " << entry.second.X << "," << entry.second.Y << " " << entry.second.Width << "x" << entry.second.Height
+                  << " uv [" << entry.second.UMin << ", " << entry.second.VMin << "] - [" << entry.second.UMax << ", " << entry.second.VMax << "]" << std::endl;
+    return true;
+}
+
+size_t remapUVs(std::vector<float>& vertices, int floatsPerVertex, int uvOffset, const AtlasRegion& region)
+{
+    const float epsilon = 1e-4f;
+    size_t outside = 0;
+    for (size_t i = uvOffset; i + 1 < vertices.size(); i += floatsPerVertex)
+    {
+        float& u = vertices[i];
+        float& v = vertices[i + 1];
+        if (u < -epsilon || u > 1.0f + epsilon || v < -epsilon || v > 1.0f + epsilon)
+            outside++;
+        u = region.UMin + u * (region.UMax - region.UMin);
+        v = region.VMin + v * (region.VMax - region.VMin);
+    }
+    return outside;
+}
@@ -0,0 +1,21 @@
+#version 400 core
+#extension GL_ARB_bindless_texture : require
+#extension GL_NV_gpu_shader5 : require     // The handle differs per instance / indirect draw, so it isn't dynamically uniform
+
+// From vertex shader
+in vec2 texCoordToFrag;
+flat in int materialToFrag;     // Texture array << 16 | layer (see material.h)
+
+out vec4 fragColor;
+
+// Resident handles of every texture array, nothing is bound to a texture unit (see MaterialLibrary::build)
+layout (std140) uniform MaterialHandles
+{
+    uvec2 materialHandles[16];
+};
+
+void main()
+{
+    sampler2DArray materialArray = sampler2DArray(materialHandles[materialToFrag >> 16]);
+    fragColor = texture(materialArray, vec3(texCoordToFrag, float(materialToFrag & 0xFFFF)));
+}
@@ -0,0 +1,251 @@
+#include "culling.h"
+#include <cmath>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define CULLING_X86 1
+#include <immintrin.h>
+#endif
+
+// AVX2 code lives in functions compiled for AVX2 only, the rest of the file stays baseline so it runs on any x86-64 CPU
+#if defined(CULLING_X86) && defined(__GNUC__)
+#define CULLING_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define CULLING_TARGET_AVX2
+#endif
+
+// FRUSTUM
+// -------
+Frustum extractFrustum(const glm::mat4& m)
+{
+    // A clip space point is inside when -w <= x, y, z <= w, each side is a row of the matrix plus or minus the w row
+    // (glm is column major, m[column][row])
+    glm::vec4 rows[4];
+    for (int row = 0; row < 4; row++)
+        rows[row] = glm::vec4(m[0][row], m[1][row], m[2][row], m[3][row]);
+    Frustum frustum;
+    frustum.Planes[0] = rows[3] + rows[0];
+    frustum.Planes[1] = rows[3] - rows[0];
+    frustum.Planes[2] = rows[3] + rows[1];
+    frustum.Planes[3] = rows[3] - rows[1];
+    frustum.Planes[4] = rows[3] + rows[2];
+    frustum.Planes[5] = rows[3] - rows[2];
+    for (glm::vec4& plane : frustum.Planes)
+        plane /= glm::length(glm::vec3(plane));  // Unit normals, so d is a distance the radii can be compared with
+    return frustum;
+}
+
+// BOUNDS
+// ------
+LocalBounds computeBounds(const MeshData& mesh)
+{
+    LocalBounds bounds;
+    size_t count = mesh.VertexCount();
+    if (count == 0 || mesh.FloatsPerVertex < 3) return bounds;
+    bounds.Min = bounds.Max = glm::vec3(mesh.Vertices[0], mesh.Vertices[1], mesh.Vertices[2]);
+    for (size_t i = 1; i < count; i++)
+    {
+        glm::vec3 position(mesh.Vertices[i * mesh.FloatsPerVertex], mesh.Vertices[i * mesh.FloatsPerVertex + 1], mesh.Vertices[i * mesh.FloatsPerVertex + 2]);
+        bounds.Min = glm::min(bounds.Min, position);
+        bounds.Max = glm::max(bounds.Max, position);
+    }
+    glm::vec3 center = (bounds.Min + bounds.Max) * 0.5f;
+    for (size_t i = 0; i < count; i++)
+    {
+        glm::vec3 position(mesh.Vertices[i * mesh.FloatsPerVertex], mesh.Vertices[i * mesh.FloatsPerVertex + 1], mesh.Vertices[i * mesh.FloatsPerVertex + 2]);
+        bounds.Radius = std::max(bounds.Radius, glm::length(position - center));
+    }
+    return bounds;
+}
+
+void CullingBounds::clear()
+{
+    for (std::vector<float>* component : {&CenterX, &CenterY, &CenterZ, &ExtentX, &ExtentY, &ExtentZ, &SphereX, &SphereY, &SphereZ, &Radius})
+        component->clear();
+}
+
+void CullingBounds::reserve(size_t count)
+{
+    for (std::vector<float>* component : {&CenterX, &CenterY, &CenterZ, &ExtentX, &ExtentY, &ExtentZ, &SphereX, &SphereY, &SphereZ, &Radius})
+        component->reserve(count);
+}
+
+size_t CullingBounds::add(const LocalBounds& local, const glm::mat4& model)
+{
+    // Box: the transformed center, and each world half extent is how far the rotated & scaled local extents reach along
+    // that axis (Arvo's method, exact for the transformed box's own AABB)
+    glm::vec3 center = glm::vec3(model * glm::vec4((local.Min + local.Max) * 0.5f, 1.0f));
+    glm::vec3 extent = (local.Max - local.Min) * 0.5f;
+    glm::vec3 worldExtent(0.0f);
+    for (int axis = 0; axis < 3; axis++)
+        for (int column = 0; column < 3; column++)
+            worldExtent[axis] += std::fabs(model[column][axis]) * extent[column];
+
+    // Sphere: same center, scaled by the largest axis scale so it still contains everything under non-uniform scaling
+    float scale = std::max(glm::length(glm::vec3(model[0])), std::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+    return add(center - worldExtent, center + worldExtent, center, local.Radius * scale);
+}
+
+size_t CullingBounds::add(const glm::vec3& boxMin, const glm::vec3& boxMax, const glm::vec3& sphereCenter, float radius)
+{
+    glm::vec3 center = (boxMin + boxMax) * 0.5f, extent = (boxMax - boxMin) * 0.5f;
+    CenterX.push_back(center.x);
+    CenterY.push_back(center.y);
+    CenterZ.push_back(center.z);
+    ExtentX.push_back(extent.x);
+    ExtentY.push_back(extent.y);
+    ExtentZ.push_back(extent.z);
+    SphereX.push_back(sphereCenter.x);
+    SphereY.push_back(sphereCenter.y);
+    SphereZ.push_back(sphereCenter.z);
+    Radius.push_back(radius);
+    return size() - 1;
+}
+
+// KERNELS: AN OBJECT IS OUT AS SOON AS ITS BOX OR SPHERE IS ENTIRELY BEHIND ONE PLANE. THE BOX'S PROJECTED RADIUS ON A
+// PLANE'S NORMAL IS |a|*ex + |b|*ey + |c|*ez. EACH WRITES THE VISIBLE INDICES FROM 'first' ON, STARTING AT out[count]
+// ----------------------------------------------------------------------------------------------------------------------
+static size_t cullScalar(const Frustum& frustum, const CullingBounds& b, size_t first, uint32_t* out, size_t count)
+{
+    for (size_t i = first; i < b.size(); i++)
+    {
+        bool inside = true;
+        for (int p = 0; p < 6 && inside; p++)
+        {
+            const glm::vec4& plane = frustum.Planes[p];
+            float box = plane.x * b.CenterX[i] + plane.y * b.CenterY[i] + plane.z * b.CenterZ[i] + plane.w
+                      + std::fabs(plane.x) * b.ExtentX[i] + std::fabs(plane.y) * b.ExtentY[i] + std::fabs(plane.z) * b.ExtentZ[i];
+            float sphere = plane.x * b.SphereX[i] + plane.y * b.SphereY[i] + plane.z * b.SphereZ[i] + plane.w + b.Radius[i];
+            inside = box >= 0.0f && sphere >= 0.0f;
+        }
+        if (inside)
+            out[count++] = (uint32_t)i;
+    }
+    return count;
+}
+
+#ifdef CULLING_X86
+static size_t cullSSE2(const Frustum& frustum, const CullingBounds& b, uint32_t* out, size_t& first)
+{
+    // Every plane component broadcast once, outside the loop
+    __m128 px[6], py[6], pz[6], pw[6], ax[6], ay[6], az[6];
+    __m128 signMask = _mm_set1_ps(-0.0f);
+    for (int p = 0; p < 6; p++)
+    {
+        px[p] = _mm_set1_ps(frustum.Planes[p].x);
+        py[p] = _mm_set1_ps(frustum.Planes[p].y);
+        pz[p] = _mm_set1_ps(frustum.Planes[p].z);
+        pw[p] = _mm_set1_ps(frustum.Planes[p].w);
+        ax[p] = _mm_andnot_ps(signMask, px[p]);
+        ay[p] = _mm_andnot_ps(signMask, py[p]);
+        az[p] = _mm_andnot_ps(signMask, pz[p]);
+    }
+    __m128 zero = _mm_setzero_ps();
+
+    size_t count = 0, i = 0;
+    for (; i + 4 <= b.size(); i += 4)
+    {
+        __m128 cx = _mm_loadu_ps(&b.CenterX[i]), cy = _mm_loadu_ps(&b.CenterY[i]), cz = _mm_loadu_ps(&b.CenterZ[i]);
+        __m128 ex = _mm_loadu_ps(&b.ExtentX[i]), ey = _mm_loadu_ps(&b.ExtentY[i]), ez = _mm_loadu_ps(&b.ExtentZ[i]);
+        __m128 sx = _mm_loadu_ps(&b.SphereX[i]), sy = _mm_loadu_ps(&b.SphereY[i]), sz = _mm_loadu_ps(&b.SphereZ[i]);
+        __m128 radius = _mm_loadu_ps(&b.Radius[i]);
+        __m128 inside = _mm_cmpeq_ps(zero, zero);   // All lanes set
+        for (int p = 0; p < 6; p++)
+        {
+            __m128 box = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], cx), _mm_mul_ps(py[p], cy)), _mm_add_ps(_mm_mul_ps(pz[p], cz), pw[p]));
+            box = _mm_add_ps(box, _mm_add_ps(_mm_add_ps(_mm_mul_ps(ax[p], ex), _mm_mul_ps(ay[p], ey)), _mm_mul_ps(az[p], ez)));
+            __m128 sphere = _mm_add_ps(_mm_add_ps(_mm_mul_ps(px[p], sx), _mm_mul_ps(py[p], sy)), _mm_add_ps(_mm_mul_ps(pz[p], sz), pw[p]));
+            sphere = _mm_add_ps(sphere, radius);
+            inside = _mm_and_ps(inside, _mm_and_ps(_mm_cmpge_ps(box, zero), _mm_cmpge_ps(sphere, zero)));
+        }
+        // Compact: one index per set bit of the lane mask
+        for (int mask = _mm_movemask_ps(inside), lane = 0; mask; mask >>= 1, lane++)
+            if (mask & 1)
+                out[count++] = (uint32_t)(i + lane);
+    }
+    first = i;
+    return count;
+}
+
+CULLING_TARGET_AVX2 static size_t cullAVX2(const Frustum& frustum, const CullingBounds& b, uint32_t* out, size_t& first)
+{
+    __m256 px[6], py[6], pz[6], pw[6], ax[6], ay[6], az[6];
+    __m256 signMask = _mm256_set1_ps(-0.0f);
+    for (int p = 0; p < 6; p++)
+    {
+        px[p] = _mm256_set1_ps(frustum.Planes[p].x);
+        py[p] = _mm256_set1_ps(frustum.Planes[p].y);
+        pz[p] = _mm256_set1_ps(frustum.Planes[p].z);
+        pw[p] = _mm256_set1_ps(frustum.Planes[p].w);
+        ax[p] = _mm256_andnot_ps(signMask, px[p]);
+        ay[p] = _mm256_andnot_ps(signMask, py[p]);
+        az[p] = _mm256_andnot_ps(signMask, pz[p]);
+    }
+    __m256 zero = _mm256_setzero_ps();
+
+    size_t count = 0, i = 0;
+    for (; i + 8 <= b.size(); i += 8)
+    {
+        __m256 cx = _mm256_loadu_ps(&b.CenterX[i]), cy = _mm256_loadu_ps(&b.CenterY[i]), cz = _mm256_loadu_ps(&b.CenterZ[i]);
+        __m256 ex = _mm256_loadu_ps(&b.ExtentX[i]), ey = _mm256_loadu_ps(&b.ExtentY[i]), ez = _mm256_loadu_ps(&b.ExtentZ[i]);
+        __m256 sx = _mm256_loadu_ps(&b.SphereX[i]), sy = _mm256_loadu_ps(&b.SphereY[i]), sz = _mm256_loadu_ps(&b.SphereZ[i]);
+        __m256 radius = _mm256_loadu_ps(&b.Radius[i]);
+        __m256 inside = _mm256_cmp_ps(zero, zero, _CMP_EQ_OQ);
+        for (int p = 0; p < 6; p++)
+        {
+            __m256 box = _mm256_fmadd_ps(px[p], cx, _mm256_fmadd_ps(py[p], cy, _mm256_fmadd_ps(pz[p], cz, pw[p])));
+            box = _mm256_fmadd_ps(ax[p], ex, _mm256_fmadd_ps(ay[p], ey, _mm256_fmadd_ps(az[p], ez, box)));
+            __m256 sphere = _mm256_fmadd_ps(px[p], sx, _mm256_fmadd_ps(py[p], sy, _mm256_fmadd_ps(pz[p], sz, _mm256_add_ps(pw[p], radius))));
+            inside = _mm256_and_ps(inside, _mm256_and_ps(_mm256_cmp_ps(box, zero, _CMP_GE_OQ), _mm256_cmp_ps(sphere, zero, _CMP_GE_OQ)));
+        }
+        for (int mask = _mm256_movemask_ps(inside), lane = 0; mask; mask >>= 1, lane++)
+            if (mask & 1)
+                out[count++] = (uint32_t)(i + lane);
+    }
+    first = i;
+    return count;
+}
+#endif
+
+// DISPATCH
+// --------
+CullSimd detectCullSimd()
+{
+#if defined(CULLING_X86) && defined(__GNUC__)
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return CULL_SIMD_AVX2;
+    return CULL_SIMD_SSE2;
+#elif defined(CULLING_X86)
+    return CULL_SIMD_SSE2;
+#else
+    return CULL_SIMD_SCALAR;
+#endif
+}
+
+const char* cullSimdName(CullSimd simd)
+{
+    switch (simd)
+    {
+    case CULL_SIMD_SCALAR: return "scalar";
+    case CULL_SIMD_SSE2:   return "SSE2";
+    case CULL_SIMD_AVX2:   return "AVX2";
+    default:               return cullSimdName(detectCullSimd());
+    }
+}
+
+size_t cullFrustum(const Frustum& frustum, const CullingBounds& bounds, std::vector<uint32_t>& visible, CullSimd simd)
+{
+    if (simd == CULL_SIMD_BEST)
+        simd = detectCullSimd();
+    visible.resize(bounds.size());  // Worst case, trimmed to what was written at the end
+    size_t count = 0, first = 0;
+#ifdef CULLING_X86
+    if (simd == CULL_SIMD_AVX2)
+        count = cullAVX2(frustum, bounds, visible.data(), first);
+    else if (simd == CULL_SIMD_SSE2)
+        count = cullSSE2(frustum, bounds, visible.data(), first);
+#endif
+    count = cullScalar(frustum, bounds, first, visible.data(), count);     // What's left after the last full SIMD block
+    visible.resize(count);
+    return count;
+}
@@ -0,0 +1,91 @@
+#include "glfeatures.h"
+#include <cstring>
+
+GLFeatures GLExt;
+
+bool hasGLExtension(const char* name)
+{
+    int count = 0;
+    glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+    for (int i = 0; i < count; i++)
+    {
+        const char* extension = (const char*)glGetStringi(GL_EXTENSIONS, i);
+        if (extension && strcmp(extension, name) == 0)
+            return true;
+    }
+    return false;
+}
+
+bool hasGLVersion(int major, int minor)
+{
+    return GLExt.Major > major || (GLExt.Major == major && GLExt.Minor >= minor);
+}
+
+void loadGLFeatures(GLADloadproc load)
+{
+    glGetIntegerv(GL_MAJOR_VERSION, &GLExt.Major);
+    glGetIntegerv(GL_MINOR_VERSION, &GLExt.Minor);
+
+    // PROGRAM BINARIES (only usable if the driver exposes at least one binary format)
+    // ---------------------------------------------------------------------------------
+    if (hasGLVersion(4, 1) || hasGLExtension("GL_ARB_get_program_binary"))
+    {
+        GLExt.GetProgramBinary = (decltype(GLExt.GetProgramBinary))load("glGetProgramBinary");
+        GLExt.ProgramBinary = (decltype(GLExt.ProgramBinary))load("glProgramBinary");
+        GLExt.ProgramParameteri = (decltype(GLExt.ProgramParameteri))load("glProgramParameteri");
+        int formats = 0;
+        glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        GLExt.ProgramBinarySupported = GLExt.GetProgramBinary && GLExt.ProgramBinary && GLExt.ProgramParameteri && formats > 0;
+    }
+
+    // PARALLEL SHADER COMPILE
+    // -----------------------
+    if (hasGLExtension("GL_KHR_parallel_shader_compile"))
+        GLExt.MaxShaderCompilerThreads = (decltype(GLExt.MaxShaderCompilerThreads))load("glMaxShaderCompilerThreadsKHR");
+    else if (hasGLExtension("GL_ARB_parallel_shader_compile"))
+        GLExt.MaxShaderCompilerThreads = (decltype(GLExt.MaxShaderCompilerThreads))load("glMaxShaderCompilerThreadsARB");
+    if (GLExt.MaxShaderCompilerThreads)
+    {
+        GLExt.MaxShaderCompilerThreads(0xFFFFFFFF);    // Let the driver pick how many threads to use
+        GLExt.ParallelShaderCompile = true;
+    }
+
+    // COMPRESSED TEXTURE FORMATS
+    // --------------------------
+    GLExt.TextureCompressionS3TC = hasGLExtension("GL_EXT_texture_compression_s3tc");
+    GLExt.TextureCompressionS3TCsRGB = GLExt.TextureCompressionS3TC
+        && (hasGLExtension("GL_EXT_texture_sRGB") || hasGLExtension("GL_EXT_texture_compression_s3tc_srgb"));
+    GLExt.TextureCompressionBPTC = hasGLVersion(4, 2) || hasGLExtension("GL_ARB_texture_compression_bptc");
+
+    // BINDLESS TEXTURES
+    // -----------------
+    if (hasGLExtension("GL_ARB_bindless_texture"))
+    {
+        GLExt.GetTextureHandle = (decltype(GLExt.GetTextureHandle))load("glGetTextureHandleARB");
+        GLExt.MakeTextureHandleResident = (decltype(GLExt.MakeTextureHandleResident))load("glMakeTextureHandleResidentARB");
+        GLExt.MakeTextureHandleNonResident = (decltype(GLExt.MakeTextureHandleNonResident))load("glMakeTextureHandleNonResidentARB");
+        GLExt.BindlessTexture = GLExt.GetTextureHandle && GLExt.MakeTextureHandleResident && GLExt.MakeTextureHandleNonResident;
+    }
+    GLExt.GpuShader5NV = hasGLExtension("GL_NV_gpu_shader5");
+
+    // BASE INSTANCE & MULTI-DRAW INDIRECT
+    // -----------------------------------
+    if (hasGLVersion(4, 2) || hasGLExtension("GL_ARB_base_instance"))
+    {
+        GLExt.DrawElementsInstancedBaseVertexBaseInstance = (decltype(GLExt.DrawElementsInstancedBaseVertexBaseInstance))load("glDrawElementsInstancedBaseVertexBaseInstance");
+        GLExt.BaseInstance = GLExt.DrawElementsInstancedBaseVertexBaseInstance != NULL;
+    }
+    if (GLExt.BaseInstance && (hasGLVersion(4, 3) || hasGLExtension("GL_ARB_multi_draw_indirect")))
+    {
+        GLExt.MultiDrawElementsIndirect = (decltype(GLExt.MultiDrawElementsIndirect))load("glMultiDrawElementsIndirect");
+        GLExt.MultiDrawIndirect = GLExt.MultiDrawElementsIndirect != NULL;
+    }
+
+    // IMMUTABLE BUFFER STORAGE
+    // ------------------------
+    if (hasGLVersion(4, 4) || hasGLExtension("GL_ARB_buffer_storage"))
+    {
+        GLExt.BufferStorage = (decltype(GLExt.BufferStorage))load("glBufferStorage");
+        GLExt.BufferStorageSupported = GLExt.BufferStorage != NULL;
+    }
+}
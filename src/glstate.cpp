@@ -0,0 +1,239 @@
+#include "glstate.h"
+#include <iostream>
+#include <cstdio>
+
+GLStateCache GLState;
+
+// SHADOW BOOKKEEPING
+// ------------------
+bool GLStateCache::same(unsigned& shadow, unsigned value, GLStateKind kind)
+{
+    if (Enabled && shadow == value)
+    {
+        Elided[kind]++;
+        return true;
+    }
+    shadow = value;
+    Issued[kind]++;
+    return false;
+}
+
+int GLStateCache::bufferSlot(GLenum target)
+{
+    switch (target)
+    {
+        case GL_ARRAY_BUFFER: return SLOT_ARRAY;
+        case GL_ELEMENT_ARRAY_BUFFER: return SLOT_ELEMENT_ARRAY;
+        case GL_UNIFORM_BUFFER: return SLOT_UNIFORM;
+        case GL_PIXEL_UNPACK_BUFFER: return SLOT_PIXEL_UNPACK;
+        case GL_COPY_READ_BUFFER: return SLOT_COPY_READ;
+        case GL_COPY_WRITE_BUFFER: return SLOT_COPY_WRITE;
+        case GL_DRAW_INDIRECT_BUFFER: return SLOT_DRAW_INDIRECT;
+        default: return -1;
+    }
+}
+
+int GLStateCache::textureSlot(GLenum target)
+{
+    return target == GL_TEXTURE_2D ? 0 : target == GL_TEXTURE_2D_ARRAY ? 1 : -1;
+}
+
+int GLStateCache::capabilitySlot(GLenum capability)
+{
+    switch (capability)
+    {
+        case GL_DEPTH_TEST: return CAP_DEPTH_TEST;
+        case GL_BLEND: return CAP_BLEND;
+        case GL_CULL_FACE: return CAP_CULL_FACE;
+        default: return -1;
+    }
+}
+
+void GLStateCache::invalidate()
+{
+    program = vertexArray = activeUnit = UNKNOWN;
+    for (unsigned& buffer : buffers) buffer = UNKNOWN;
+    for (unsigned& binding : uniformBindings) binding = UNKNOWN;
+    for (auto& unit : textures)
+        unit[0] = unit[1] = UNKNOWN;
+    for (unsigned& capability : capabilities) capability = UNKNOWN;
+    depthFuncState = depthMaskState = blendSource = blendDestination = cullFaceState = UNKNOWN;
+    for (int& value : viewportState) value = -1;
+}
+
+void GLStateCache::resetCounters()
+{
+    for (int kind = 0; kind < STATE_KIND_COUNT; kind++)
+        Issued[kind] = Elided[kind] = 0;
+}
+
+// BINDINGS
+// --------
+bool GLStateCache::useProgram(unsigned id)
+{
+    if (same(program, id, STATE_PROGRAM)) return false;
+    glUseProgram(id);
+    return true;
+}
+
+bool GLStateCache::bindVertexArray(unsigned vao)
+{
+    if (same(vertexArray, vao, STATE_VERTEX_ARRAY)) return false;
+    glBindVertexArray(vao);
+    buffers[SLOT_ELEMENT_ARRAY] = UNKNOWN;  // The element array binding is part of the VAO
+    return true;
+}
+
+bool GLStateCache::bindBuffer(GLenum target, unsigned buffer)
+{
+    int slot = bufferSlot(target);
+    unsigned untracked = UNKNOWN;
+    if (same(slot >= 0 ? buffers[slot] : untracked, buffer, STATE_BUFFER)) return false;
+    glBindBuffer(target, buffer);
+    return true;
+}
+
+bool GLStateCache::bindBufferBase(GLenum target, unsigned index, unsigned buffer)
+{
+    unsigned untracked = UNKNOWN;
+    bool tracked = target == GL_UNIFORM_BUFFER && index < (unsigned)GL_STATE_UNIFORM_BINDINGS;
+    if (same(tracked ? uniformBindings[index] : untracked, buffer, STATE_BUFFER)) return false;
+    glBindBufferBase(target, index, buffer);
+    int slot = bufferSlot(target);
+    if (slot >= 0) buffers[slot] = buffer;
+    return true;
+}
+
+bool GLStateCache::bindTexture(unsigned unit, GLenum target, unsigned texture)
+{
+    int slot = textureSlot(target);
+    unsigned untracked = UNKNOWN;
+    if (same(slot >= 0 && unit < (unsigned)GL_STATE_TEXTURE_UNITS ? textures[unit][slot] : untracked, texture, STATE_TEXTURE)) return false;
+    if (!same(activeUnit, unit, STATE_ACTIVE_TEXTURE))
+        glActiveTexture(GL_TEXTURE0 + unit);
+    glBindTexture(target, texture);
+    return true;
+}
+
+// FIXED FUNCTION STATE
+// --------------------
+bool GLStateCache::enable(GLenum capability, bool enabled)
+{
+    int slot = capabilitySlot(capability);
+    unsigned untracked = UNKNOWN;
+    if (same(slot >= 0 ? capabilities[slot] : untracked, enabled ? 1 : 0, STATE_CAPABILITY)) return false;
+    if (enabled) glEnable(capability);
+    else glDisable(capability);
+    return true;
+}
+
+bool GLStateCache::depthFunc(GLenum func)
+{
+    if (same(depthFuncState, func, STATE_FIXED_FUNCTION)) return false;
+    glDepthFunc(func);
+    return true;
+}
+
+bool GLStateCache::depthMask(bool write)
+{
+    if (same(depthMaskState, write ? 1 : 0, STATE_FIXED_FUNCTION)) return false;
+    glDepthMask(write ? GL_TRUE : GL_FALSE);
+    return true;
+}
+
+bool GLStateCache::blendFunc(GLenum source, GLenum destination)
+{
+    // One call, so one count: compare both before touching either
+    if (Enabled && blendSource == source && blendDestination == destination)
+    {
+        Elided[STATE_FIXED_FUNCTION]++;
+        return false;
+    }
+    blendSource = source;
+    blendDestination = destination;
+    Issued[STATE_FIXED_FUNCTION]++;
+    glBlendFunc(source, destination);
+    return true;
+}
+
+bool GLStateCache::cullFace(GLenum face)
+{
+    if (same(cullFaceState, face, STATE_FIXED_FUNCTION)) return false;
+    glCullFace(face);
+    return true;
+}
+
+bool GLStateCache::viewport(int x, int y, int width, int height)
+{
+    if (Enabled && viewportState[0] == x && viewportState[1] == y && viewportState[2] == width && viewportState[3] == height)
+    {
+        Elided[STATE_VIEWPORT]++;
+        return false;
+    }
+    viewportState[0] = x;
+    viewportState[1] = y;
+    viewportState[2] = width;
+    viewportState[3] = height;
+    Issued[STATE_VIEWPORT]++;
+    glViewport(x, y, width, height);
+    return true;
+}
+
+// DELETION (GL RESETS EVERY BINDING OF A DELETED OBJECT TO 0)
+// -----------------------------------------------------------
+void GLStateCache::deleteTextures(GLsizei count, const unsigned* ids)
+{
+    glDeleteTextures(count, ids);
+    for (GLsizei i = 0; i < count; i++)
+        for (auto& unit : textures)
+            for (unsigned& binding : unit)
+                if (binding == ids[i]) binding = 0;
+}
+
+void GLStateCache::deleteBuffers(GLsizei count, const unsigned* ids)
+{
+    glDeleteBuffers(count, ids);
+    for (GLsizei i = 0; i < count; i++)
+    {
+        for (unsigned& binding : buffers)
+            if (binding == ids[i]) binding = 0;
+        for (unsigned& binding : uniformBindings)
+            if (binding == ids[i]) binding = 0;
+    }
+}
+
+void GLStateCache::deleteVertexArrays(GLsizei count, const unsigned* ids)
+{
+    glDeleteVertexArrays(count, ids);
+    for (GLsizei i = 0; i < count; i++)
+        if (vertexArray == ids[i])
+        {
+            vertexArray = 0;
+            buffers[SLOT_ELEMENT_ARRAY] = 0;
+        }
+}
+
+void GLStateCache::deleteProgram(unsigned id)
+{
+    // The current program stays in use until another one replaces it, so the shadow stays valid, but its name could only
+    // be handed out again after that. Forget it anyway so a recycled name can never be mistaken for it
+    glDeleteProgram(id);
+    if (program == id) program = UNKNOWN;
+}
+
+// REPORT
+// ------
+void GLStateCache::report(int frames) const
+{
+    const char* names[STATE_KIND_COUNT] = {"program", "vertex array", "buffer", "texture", "active texture", "enable/disable", "depth/blend/cull", "viewport"};
+    size_t issued = 0, elided = 0;
+    printf("GL state calls per frame (issued / elided%s):\n", Enabled ? "" : ", cache disabled");
+    for (int kind = 0; kind < STATE_KIND_COUNT; kind++)
+    {
+        if (Issued[kind] + Elided[kind] == 0) continue;
+        printf("  %-18s %8.1f / %8.1f\n", names[kind], (double)Issued[kind] / frames, (double)Elided[kind] / frames);
+        issued += Issued[kind];
+        elided += Elided[kind];
+    }
+    printf("  %-18s %8.1f / %8.1f\n", "total", (double)issued / frames, (double)elided / frames);
+}
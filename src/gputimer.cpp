@@ -0,0 +1,128 @@
+#include "gputimer.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+GpuTimer::GpuTimer()
+{
+}
+
+GpuTimer::~GpuTimer()
+{
+    for (FrameSlot& slot : slots)
+        if (!slot.Queries.empty())
+            glDeleteQueries((GLsizei)slot.Queries.size(), slot.Queries.data());
+}
+
+// Writes the GPU's time once every command before it has completed, into the slot's next free query
+size_t GpuTimer::timestamp(FrameSlot& slot)
+{
+    if (slot.Used == slot.Queries.size())
+    {
+        unsigned query;
+        glGenQueries(1, &query);
+        slot.Queries.push_back(query);
+    }
+    glQueryCounter(slot.Queries[slot.Used], GL_TIMESTAMP);
+    return slot.Used++;
+}
+
+void GpuTimer::beginFrame()
+{
+    frame++;
+    FrameSlot& slot = slots[frame % FRAMES_IN_FLIGHT];
+    collect(slot, false);
+    slot.Used = 0;
+    slot.Passes.clear();
+    slot.Frame = frame;
+    open.clear();
+    beginPass("frame");
+}
+
+void GpuTimer::beginPass(const char* name)
+{
+    if (frame < 0) return;
+    FrameSlot& slot = slots[frame % FRAMES_IN_FLIGHT];
+    slot.Passes.push_back({name, timestamp(slot), 0});
+    open.push_back(slot.Passes.size() - 1);
+}
+
+void GpuTimer::endPass()
+{
+    if (open.empty()) return;
+    FrameSlot& slot = slots[frame % FRAMES_IN_FLIGHT];
+    slot.Passes[open.back()].End = timestamp(slot);
+    open.pop_back();
+}
+
+void GpuTimer::endFrame()
+{
+    while (!open.empty())
+        endPass();
+}
+
+void GpuTimer::finish()
+{
+    endFrame();
+    for (int i = frame - FRAMES_IN_FLIGHT + 1; i <= frame; i++)
+        if (i >= 0)
+            collect(slots[i % FRAMES_IN_FLIGHT], true);
+}
+
+// READ BACK A FINISHED FRAME, UNLESS THE GPU ISN'T DONE WITH IT & WE MAY NOT WAIT
+// ------------------------------------------------------------------------------
+void GpuTimer::collect(FrameSlot& slot, bool wait)
+{
+    if (slot.Frame < 0 || slot.Used == 0) return;
+    // Timestamps complete in order, so the last one being available means they all are
+    GLint available = 0;
+    if (!wait)
+        glGetQueryObjectiv(slot.Queries[slot.Used - 1], GL_QUERY_RESULT_AVAILABLE, &available);
+    if (!wait && !available)
+    {
+        slot.Frame = -1;
+        droppedFrames++;
+        return;
+    }
+
+    std::vector<GLuint64> times(slot.Used);
+    for (size_t i = 0; i < slot.Used; i++)
+        glGetQueryObjectui64v(slot.Queries[i], GL_QUERY_RESULT, &times[i]);
+    resolved.clear();
+    for (const PassRecord& pass : slot.Passes)
+    {
+        if (pass.End <= pass.Begin) continue;   // Never ended
+        double ms = (double)(times[pass.End] - times[pass.Begin]) / 1e6;
+        auto same = std::find_if(resolved.begin(), resolved.end(), [&](const GpuPassTime& t) { return strcmp(t.Name, pass.Name) == 0; });
+        if (same != resolved.end())
+            same->Ms += ms;
+        else
+            resolved.push_back({pass.Name, ms});
+    }
+    resolvedFrame = slot.Frame;
+    slot.Frame = -1;    // Read once
+
+    for (const GpuPassTime& pass : resolved)
+    {
+        auto summary = std::find_if(summaries.begin(), summaries.end(), [&](const PassSummary& s) { return strcmp(s.Name, pass.Name) == 0; });
+        if (summary == summaries.end())
+        {
+            summaries.push_back({pass.Name, 0, 0.0, pass.Ms, pass.Ms});
+            summary = summaries.end() - 1;
+        }
+        summary->Frames++;
+        summary->TotalMs += pass.Ms;
+        summary->MinMs = std::min(summary->MinMs, pass.Ms);
+        summary->MaxMs = std::max(summary->MaxMs, pass.Ms);
+    }
+}
+
+void GpuTimer::report() const
+{
+    size_t frames = summaries.empty() ? 0 : summaries.front().Frames;     // "frame" is in every resolved frame
+    printf("GPU time per pass (ms, %zu frames resolved, %zu dropped as not ready):\n", frames, droppedFrames);
+    for (const PassSummary& summary : summaries)
+        printf("  %-20s mean %8.3f  min %8.3f  max %8.3f  (in %zu frames)\n", summary.Name, summary.TotalMs / summary.Frames,
+               summary.MinMs, summary.MaxMs, summary.Frames);
+}
@@ -0,0 +1,115 @@
+#include "headless.h"
+#include "glstate.h"
+
+#ifdef __linux__
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+HeadlessContext::HeadlessContext(int width, int height) : Width(width), Height(height)
+{
+#ifdef __linux__
+    // 1. get a display that doesn't need a window system (Mesa's surfaceless platform), else fall back to the default display
+    EGLDisplay eglDisplay = EGL_NO_DISPLAY;
+    PFNEGLGETPLATFORMDISPLAYEXTPROC getPlatformDisplay = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    if (getPlatformDisplay)
+        eglDisplay = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+    if (eglDisplay == EGL_NO_DISPLAY)
+        eglDisplay = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    EGLint major, minor;
+    if (eglDisplay == EGL_NO_DISPLAY || !eglInitialize(eglDisplay, &major, &minor))
+    {
+        std::cout << "ERROR::HEADLESS::EGL_INIT_FAILED" << std::endl;
+        return;
+    }
+    display = eglDisplay;
+
+    // 2. create a desktop GL 3.3 core context (same version GLFW is asked for) with no config and no surface
+    eglBindAPI(EGL_OPENGL_API);
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 3,
+        EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+        EGL_NONE
+    };
+    EGLContext eglContext = eglCreateContext(eglDisplay, EGL_NO_CONFIG_KHR, EGL_NO_CONTEXT, contextAttribs);
+    if (eglContext == EGL_NO_CONTEXT)
+    {
+        std::cout << "ERROR::HEADLESS::EGL_CONTEXT_CREATION_FAILED (0x" << std::hex << eglGetError() << std::dec << ")" << std::endl;
+        return;
+    }
+    context = eglContext;
+
+    // 3. make it current without a surface, all rendering goes to the FBO instead
+    if (!eglMakeCurrent(eglDisplay, EGL_NO_SURFACE, EGL_NO_SURFACE, eglContext))
+    {
+        std::cout << "ERROR::HEADLESS::EGL_MAKE_CURRENT_FAILED" << std::endl;
+        return;
+    }
+    Valid = true;
+#else
+    std::cout << "ERROR::HEADLESS::ONLY_SUPPORTED_ON_LINUX_EGL" << std::endl;
+#endif
+}
+
+HeadlessContext::~HeadlessContext()
+{
+#ifdef __linux__
+    if (context)
+    {
+        if (FBO)
+        {
+            glDeleteFramebuffers(1, &FBO);
+            unsigned RBOs[2] = {colourRBO, depthRBO};
+            glDeleteRenderbuffers(2, RBOs);
+        }
+        eglMakeCurrent((EGLDisplay)display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+        eglDestroyContext((EGLDisplay)display, (EGLContext)context);
+    }
+    if (display)
+        eglTerminate((EGLDisplay)display);
+#endif
+}
+
+bool HeadlessContext::createFramebuffer()
+{
+    // Colour & depth attachments are renderbuffers since they are never sampled from
+    glGenRenderbuffers(1, &colourRBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, colourRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, Width, Height);
+
+    glGenRenderbuffers(1, &depthRBO);
+    glBindRenderbuffer(GL_RENDERBUFFER, depthRBO);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, Width, Height);
+    glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+    glGenFramebuffers(1, &FBO);
+    glBindFramebuffer(GL_FRAMEBUFFER, FBO);    // Stays bound, so every draw in the render loop lands here instead of a window
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, colourRBO);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, depthRBO);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "ERROR::HEADLESS::FRAMEBUFFER_INCOMPLETE" << std::endl;
+        return false;
+    }
+    GLState.viewport(0, 0, Width, Height);
+    return true;
+}
+
+void HeadlessContext::readPixels(std::vector<unsigned char>& pixels) const
+{
+    pixels.resize((size_t)Width * Height * 4);
+    glPixelStorei(GL_PACK_ALIGNMENT, 1);
+    glReadPixels(0, 0, Width, Height, GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());    // From the FBO, it never gets unbound
+}
+
+void* HeadlessContext::getProcAddress(const char* name)
+{
+#ifdef __linux__
+    return (void*)eglGetProcAddress(name);
+#else
+    return NULL;
+#endif
+}
@@ -0,0 +1,146 @@
+#include "indirectdraw.h"
+#include "glfeatures.h"
+#include "glstate.h"
+#include <cstring>
+
+IndirectBatch::IndirectBatch(const MeshPool* pool, bool allowMultiDraw) : pool(pool)
+{
+    if (allowMultiDraw && GLExt.MultiDrawIndirect)
+        Path = MULTI_DRAW_INDIRECT;
+    else
+        Path = GLExt.BaseInstance ? BASE_INSTANCE_LOOP : ATTRIBUTE_LOOP;
+    glGenVertexArrays(1, &VAO);
+    glGenBuffers(1, &recordBuffer);
+    if (Path == MULTI_DRAW_INDIRECT)
+        glGenBuffers(1, &commandBuffer);
+}
+
+IndirectBatch::~IndirectBatch()
+{
+    GLState.deleteVertexArrays(1, &VAO);
+    GLState.deleteBuffers(1, &recordBuffer);
+    if (commandBuffer) GLState.deleteBuffers(1, &commandBuffer);
+}
+
+void IndirectBatch::clear()
+{
+    commands.clear();
+    records.clear();
+}
+
+void IndirectBatch::add(const MeshHandle& mesh, const glm::mat4& model, int material)
+{
+    DrawElementsIndirectCommand command;
+    command.count = (GLuint)mesh.indexCount;
+    command.instanceCount = 1;
+    command.firstIndex = mesh.firstIndex;
+    command.baseVertex = mesh.baseVertex;
+    command.baseInstance = (GLuint)records.size();
+    commands.push_back(command);
+
+    IndirectDrawRecord record;
+    record.Model = model;
+    record.Material = material;
+    records.push_back(record);
+}
+
+void IndirectBatch::upload(RingBuffer* ring)
+{
+    if (commands.empty()) return;
+
+    // PER-DRAW RECORDS & COMMANDS: INTO THE RING, OR RE-SPECIFY THE WHOLE STORE (ORPHANING LAST FRAME'S, SO THIS NEVER
+    // WAITS ON DRAWS STILL READING IT)
+    // --------------------------------------------------------------------------------------------------------------
+    size_t recordBytes = records.size() * sizeof(IndirectDrawRecord);
+    size_t commandBytes = Path == MULTI_DRAW_INDIRECT ? commands.size() * sizeof(DrawElementsIndirectCommand) : 0;
+    void* recordTarget = ring ? ring->allocate(recordBytes, 16, recordOffset) : NULL;
+    void* commandTarget = recordTarget && commandBytes ? ring->allocate(commandBytes, 16, commandOffset) : NULL;
+    if (recordTarget && (commandTarget || !commandBytes))
+    {
+        memcpy(recordTarget, records.data(), recordBytes);
+        if (commandTarget) memcpy(commandTarget, commands.data(), commandBytes);
+        recordSource = commandSource = ring->Buffer;
+    }
+    else
+    {
+        recordSource = recordBuffer;
+        commandSource = commandBuffer;
+        recordOffset = commandOffset = 0;
+        GLState.bindBuffer(GL_ARRAY_BUFFER, recordBuffer);
+        glBufferData(GL_ARRAY_BUFFER, recordBytes, records.data(), GL_STREAM_DRAW);
+        GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+        if (commandBytes)
+        {
+            GLState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandBuffer);
+            glBufferData(GL_DRAW_INDIRECT_BUFFER, commandBytes, commands.data(), GL_STREAM_DRAW);
+        }
+    }
+
+    // VAO: THE POOL'S VERTEX FORMAT (REDONE WHEN THE POOL HAS REPLACED ITS BUFFERS) + THIS FRAME'S RECORDS
+    // ----------------------------------------------------------------------------------------------------
+    GLState.bindVertexArray(VAO);
+    if (poolVBO != pool->VBO || poolEBO != pool->EBO)
+    {
+        GLState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, pool->EBO);
+        pool->configAttributes();
+        poolVBO = pool->VBO;
+        poolEBO = pool->EBO;
+    }
+    configRecordAttributes(0);
+}
+
+size_t IndirectBatch::draw() const
+{
+    if (commands.empty()) return 0;
+    GLState.bindVertexArray(VAO);
+    switch (Path)
+    {
+        case MULTI_DRAW_INDIRECT:
+            // Indirect "pointer" is an offset into the bound GL_DRAW_INDIRECT_BUFFER, stride 0 means tightly packed
+            GLState.bindBuffer(GL_DRAW_INDIRECT_BUFFER, commandSource);
+            GLExt.MultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT, (void*)commandOffset, (GLsizei)commands.size(), 0);
+            return 1;
+        case BASE_INSTANCE_LOOP:
+            for (const DrawElementsIndirectCommand& command : commands)
+                GLExt.DrawElementsInstancedBaseVertexBaseInstance(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(unsigned)),
+                                                                  command.instanceCount, command.baseVertex, command.baseInstance);
+            return commands.size();
+        case ATTRIBUTE_LOOP:
+            // GL 3.3 always starts per-instance attributes at instance 0, so the attributes are moved to the draw's records instead
+            for (const DrawElementsIndirectCommand& command : commands)
+            {
+                configRecordAttributes(command.baseInstance);
+                glDrawElementsInstancedBaseVertex(GL_TRIANGLES, command.count, GL_UNSIGNED_INT, (void*)(command.firstIndex * sizeof(unsigned)),
+                                                  command.instanceCount, command.baseVertex);
+            }
+            return commands.size();
+    }
+    return 0;
+}
+
+const char* IndirectBatch::pathName() const
+{
+    switch (Path)
+    {
+        case MULTI_DRAW_INDIRECT: return "multi-draw indirect";
+        case BASE_INSTANCE_LOOP: return "base instance loop";
+        default: return "attribute loop";
+    }
+}
+
+void IndirectBatch::configRecordAttributes(size_t first) const
+{
+    GLState.bindBuffer(GL_ARRAY_BUFFER, recordSource);
+    size_t base = recordOffset + first * sizeof(IndirectDrawRecord);
+    // A mat4 attribute is fed as 4 vec4 columns on consecutive locations, all advancing once per instance
+    for (int column = 0; column < 4; column++)
+    {
+        glVertexAttribPointer(3 + column, 4, GL_FLOAT, GL_FALSE, sizeof(IndirectDrawRecord), (void*)(base + column * sizeof(glm::vec4)));
+        glEnableVertexAttribArray(3 + column);
+        glVertexAttribDivisor(3 + column, 1);
+    }
+    glVertexAttribIPointer(7, 1, GL_INT, sizeof(IndirectDrawRecord), (void*)(base + sizeof(glm::mat4)));
+    glEnableVertexAttribArray(7);
+    glVertexAttribDivisor(7, 1);
+    GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+}
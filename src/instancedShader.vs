@@ -0,0 +1,23 @@
+#version 330 core
+layout (location = 0) in vec3 aPos;
+layout (location = 2) in vec2 aTexCoord;
+layout (location = 3) in mat4 aInstanceModel;  // Per-instance model matrix (attribute divisor 1), takes up locations 3-6
+layout (location = 7) in int aInstanceMaterial; // Per-instance material id, see material.h
+
+// Passed to fragment shader
+out vec2 texCoordToFrag;
+flat out int materialToFrag;    // Only read by the material fragment shaders
+
+// Shared by all programs, written once per frame (see frameuniforms.h)
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+};
+
+void main()
+{
+    gl_Position = projection * view * aInstanceModel * vec4(aPos, 1.0);
+    texCoordToFrag = aTexCoord;
+    materialToFrag = aInstanceMaterial;
+}
@@ -0,0 +1,263 @@
+#include "ktx2.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <algorithm>
+
+static const unsigned char KTX2_IDENTIFIER[12] = {0xAB, 'K', 'T', 'X', ' ', '2', '0', 0xBB, '\r', '\n', 0x1A, '\n'};
+
+// Fixed part of the file: identifier, header and index, followed by one LevelIndex per mip level
+struct Ktx2Header
+{
+    unsigned char identifier[12];
+    uint32_t vkFormat, typeSize, pixelWidth, pixelHeight, pixelDepth, layerCount, faceCount, levelCount, supercompressionScheme;
+    uint32_t dfdByteOffset, dfdByteLength, kvdByteOffset, kvdByteLength;
+    uint64_t sgdByteOffset, sgdByteLength;
+};
+static_assert(sizeof(Ktx2Header) == 80, "KTX2 header must match the file layout");
+struct Ktx2LevelIndex
+{
+    uint64_t byteOffset, byteLength, uncompressedByteLength;
+};
+
+// FORMAT MAPPING
+// --------------
+unsigned ktx2VkFormat(BlockFormat format, bool srgb)
+{
+    switch (format)
+    {
+    case BLOCK_BC1: return srgb ? VK_FORMAT_BC1_RGB_SRGB_BLOCK : VK_FORMAT_BC1_RGB_UNORM_BLOCK;
+    case BLOCK_BC3: return srgb ? VK_FORMAT_BC3_SRGB_BLOCK : VK_FORMAT_BC3_UNORM_BLOCK;
+    default:        return srgb ? VK_FORMAT_BC7_SRGB_BLOCK : VK_FORMAT_BC7_UNORM_BLOCK;
+    }
+}
+
+bool ktx2BlockFormat(unsigned vkFormat, BlockFormat& format, bool& srgb)
+{
+    switch (vkFormat)
+    {
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK: format = BLOCK_BC1; srgb = false; return true;
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:  format = BLOCK_BC1; srgb = true;  return true;
+    case VK_FORMAT_BC3_UNORM_BLOCK:     format = BLOCK_BC3; srgb = false; return true;
+    case VK_FORMAT_BC3_SRGB_BLOCK:      format = BLOCK_BC3; srgb = true;  return true;
+    case VK_FORMAT_BC7_UNORM_BLOCK:     format = BLOCK_BC7; srgb = false; return true;
+    case VK_FORMAT_BC7_SRGB_BLOCK:      format = BLOCK_BC7; srgb = true;  return true;
+    }
+    return false;
+}
+
+// WRITING
+// -------
+static void append32(std::vector<unsigned char>& out, uint32_t value)
+{
+    for (int i = 0; i < 4; i++) out.push_back((unsigned char)(value >> (i * 8)));
+}
+
+// Basic data format descriptor (Khronos Data Format spec, section 5) for a block compressed format: one sample per
+// compressed plane, alpha first for BC3
+static std::vector<unsigned char> buildDFD(BlockFormat format, bool srgb)
+{
+    struct Sample { unsigned bitOffset, bitLength, channel; };
+    std::vector<Sample> samples;
+    unsigned char colourModel;
+    if (format == BLOCK_BC1)      { colourModel = 128; samples.push_back({0, 64, 0}); }                              // KHR_DF_MODEL_BC1A
+    else if (format == BLOCK_BC3) { colourModel = 130; samples.push_back({0, 64, 15}); samples.push_back({64, 64, 0}); } // KHR_DF_MODEL_BC3
+    else                          { colourModel = 134; samples.push_back({0, 128, 0}); }                             // KHR_DF_MODEL_BC7
+
+    uint32_t blockSize = 24 + 16 * (uint32_t)samples.size();
+    std::vector<unsigned char> dfd;
+    append32(dfd, 4 + blockSize);                   // dfdTotalSize
+    append32(dfd, 0);                               // vendorId = Khronos, descriptorType = basic
+    append32(dfd, 2 | (blockSize << 16));           // versionNumber 1.3, descriptorBlockSize
+    dfd.push_back(colourModel);
+    dfd.push_back(1);                               // BT.709 primaries
+    dfd.push_back(srgb ? 2 : 1);                    // sRGB or linear transfer
+    dfd.push_back(0);                               // Straight alpha
+    dfd.push_back(3); dfd.push_back(3); dfd.push_back(0); dfd.push_back(0);     // 4x4x1x1 texel block (stored minus one)
+    dfd.push_back((unsigned char)blockBytes(format));
+    for (int i = 1; i < 8; i++) dfd.push_back(0);  // bytesPlane1..7
+    for (const Sample& sample : samples)
+    {
+        append32(dfd, sample.bitOffset | ((sample.bitLength - 1) << 16) | (sample.channel << 24));
+        append32(dfd, 0);                           // samplePosition
+        append32(dfd, 0);                           // sampleLower
+        append32(dfd, 0xFFFFFFFF);                  // sampleUpper
+    }
+    return dfd;
+}
+
+// Key/value entries must be sorted by key, each padded to 4 bytes
+static std::vector<unsigned char> buildKVD(const std::vector<std::pair<std::string, std::string>>& entries)
+{
+    std::vector<unsigned char> kvd;
+    for (const auto& entry : entries)
+    {
+        uint32_t length = (uint32_t)(entry.first.size() + 1 + entry.second.size() + 1);
+        append32(kvd, length);
+        kvd.insert(kvd.end(), entry.first.begin(), entry.first.end());
+        kvd.push_back(0);
+        kvd.insert(kvd.end(), entry.second.begin(), entry.second.end());
+        kvd.push_back(0);
+        while (kvd.size() % 4) kvd.push_back(0);
+    }
+    return kvd;
+}
+
+static uint64_t alignUp(uint64_t value, uint64_t alignment)
+{
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool writeKtx2(const std::string& path, const Ktx2Image& image)
+{
+    BlockFormat format;
+    bool srgb;
+    if (!ktx2BlockFormat(image.VkFormat, format, srgb) || image.Levels.empty())
+    {
+        std::cout << "ERROR::KTX2::UNSUPPORTED_FORMAT " << image.VkFormat << std::endl;
+        return false;
+    }
+
+    std::vector<unsigned char> dfd = buildDFD(format, srgb);
+    std::vector<unsigned char> kvd = buildKVD({{"KTXorientation", image.BottomUp ? "ru" : "rd"}, {"KTXwriter", "texbake"}});
+
+    // LAYOUT: HEADER, LEVEL INDEX, DFD, KVD, THEN THE LEVELS SMALLEST FIRST, EACH ALIGNED TO THE BLOCK SIZE
+    // ----------------------------------------------------------------------------------------------------
+    Ktx2Header header = {};
+    memcpy(header.identifier, KTX2_IDENTIFIER, 12);
+    header.vkFormat = image.VkFormat;
+    header.typeSize = 1;
+    header.pixelWidth = image.Width;
+    header.pixelHeight = image.Height;
+    header.faceCount = 1;
+    header.levelCount = (uint32_t)image.Levels.size();
+    header.dfdByteOffset = (uint32_t)(sizeof(Ktx2Header) + image.Levels.size() * sizeof(Ktx2LevelIndex));
+    header.dfdByteLength = (uint32_t)dfd.size();
+    header.kvdByteOffset = header.dfdByteOffset + header.dfdByteLength;
+    header.kvdByteLength = (uint32_t)kvd.size();
+
+    std::vector<Ktx2LevelIndex> levelIndex(image.Levels.size());
+    uint64_t offset = header.kvdByteOffset + header.kvdByteLength;
+    for (size_t level = image.Levels.size(); level-- > 0;)
+    {
+        offset = alignUp(offset, blockBytes(format));
+        levelIndex[level].byteOffset = offset;
+        levelIndex[level].byteLength = levelIndex[level].uncompressedByteLength = image.Levels[level].size();
+        offset += image.Levels[level].size();
+    }
+
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "ERROR::KTX2::CANNOT_WRITE " << path << std::endl;
+        return false;
+    }
+    file.write((const char*)&header, sizeof(header));
+    file.write((const char*)levelIndex.data(), levelIndex.size() * sizeof(Ktx2LevelIndex));
+    file.write((const char*)dfd.data(), dfd.size());
+    file.write((const char*)kvd.data(), kvd.size());
+    uint64_t written = header.kvdByteOffset + header.kvdByteLength;
+    const char padding[16] = {};
+    for (size_t level = image.Levels.size(); level-- > 0;)
+    {
+        file.write(padding, levelIndex[level].byteOffset - written);
+        file.write((const char*)image.Levels[level].data(), image.Levels[level].size());
+        written = levelIndex[level].byteOffset + levelIndex[level].byteLength;
+    }
+    return (bool)file;
+}
+
+// READING
+// -------
+bool readKtx2(const std::string& path, Ktx2Image& image)
+{
+    std::ifstream file(path, std::ios::binary | std::ios::ate);
+    uint64_t fileSize = file ? (uint64_t)file.tellg() : 0;
+    file.seekg(0);
+    Ktx2Header header;
+    if (!file || !file.read((char*)&header, sizeof(header)) || memcmp(header.identifier, KTX2_IDENTIFIER, 12) != 0)
+    {
+        std::cout << "ERROR::KTX2::NOT_A_KTX2_FILE " << path << std::endl;
+        return false;
+    }
+    BlockFormat format;
+    bool srgb;
+    if (!ktx2BlockFormat(header.vkFormat, format, srgb) || header.supercompressionScheme != 0 || header.pixelDepth > 1
+        || header.layerCount > 1 || header.faceCount != 1 || header.pixelWidth == 0 || header.pixelHeight == 0
+        || header.pixelWidth > 1u << 16 || header.pixelHeight > 1u << 16)
+    {
+        std::cout << "ERROR::KTX2::UNSUPPORTED_LAYOUT " << path << " (only uncompressed 2D BC1/BC3/BC7 textures)" << std::endl;
+        return false;
+    }
+
+    // Everything sized from the header is checked against the image & the file first, a corrupt one mustn't allocate or
+    // read past either
+    uint32_t levelCount = std::max(1u, header.levelCount);    // 0 means "generate mips at load", treat as a single level
+    uint32_t maxLevels = 1;
+    while ((std::max(header.pixelWidth, header.pixelHeight) >> maxLevels) > 0)
+        maxLevels++;
+    if (levelCount > maxLevels || (uint64_t)header.kvdByteLength > fileSize || header.kvdByteOffset > fileSize - header.kvdByteLength)
+    {
+        std::cout << "ERROR::KTX2::CORRUPT_HEADER " << path << std::endl;
+        return false;
+    }
+    std::vector<Ktx2LevelIndex> levelIndex(levelCount);
+    if (!file.read((char*)levelIndex.data(), levelCount * sizeof(Ktx2LevelIndex)))
+    {
+        std::cout << "ERROR::KTX2::TRUNCATED " << path << std::endl;
+        return false;
+    }
+
+    // KTXorientation tells which way the rows run, the default is top-down
+    image.BottomUp = false;
+    if (header.kvdByteLength > 0)
+    {
+        std::vector<char> kvd(header.kvdByteLength);
+        file.seekg(header.kvdByteOffset);
+        file.read(kvd.data(), kvd.size());
+        for (size_t at = 0; file && at + 4 <= kvd.size();)
+        {
+            uint32_t length;
+            memcpy(&length, &kvd[at], 4);
+            if (length == 0 || length > kvd.size() - at - 4) break;
+            // Key & value are NUL terminated inside the entry, unless it's malformed: never read past its length
+            const char* entry = &kvd[at + 4];
+            std::string key(entry, strnlen(entry, length));
+            if (key == "KTXorientation" && key.size() + 1 < length)
+            {
+                const char* value = entry + key.size() + 1;
+                image.BottomUp = std::string(value, strnlen(value, length - key.size() - 1)).find('u') != std::string::npos;
+            }
+            at = alignUp(at + 4 + length, 4);
+        }
+    }
+
+    image.VkFormat = header.vkFormat;
+    image.Width = header.pixelWidth;
+    image.Height = header.pixelHeight;
+    image.Levels.assign(levelCount, {});
+    for (uint32_t level = 0; level < levelCount; level++)
+    {
+        int width = std::max(1, image.Width >> level), height = std::max(1, image.Height >> level);
+        if (levelIndex[level].byteLength != compressedSize(format, width, height))
+        {
+            std::cout << "ERROR::KTX2::BAD_LEVEL_SIZE " << path << " level " << level << std::endl;
+            return false;
+        }
+        if (levelIndex[level].byteLength > fileSize || levelIndex[level].byteOffset > fileSize - levelIndex[level].byteLength)
+        {
+            std::cout << "ERROR::KTX2::TRUNCATED " << path << " level " << level << std::endl;
+            return false;
+        }
+        image.Levels[level].resize(levelIndex[level].byteLength);
+        file.seekg(levelIndex[level].byteOffset);
+        file.read((char*)image.Levels[level].data(), levelIndex[level].byteLength);
+    }
+    if (!file)
+    {
+        std::cout << "ERROR::KTX2::TRUNCATED " << path << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,162 @@
+#include "material.h"
+#include "glfeatures.h"
+#include "glstate.h"
+#include "mipmap.h"
+#include <iostream>
+#include <algorithm>
+
+#ifndef GL_MAX_ARRAY_TEXTURE_LAYERS
+#define GL_MAX_ARRAY_TEXTURE_LAYERS 0x88FF
+#endif
+
+MaterialLibrary::MaterialLibrary(bool allowBindless)
+{
+    // The bindless shader is GLSL 4.00 (what ARB_bindless_texture is written against) and picks each instance's handle from
+    // its material, which isn't dynamically uniform across an instanced or multi-draw call: that needs NV_gpu_shader5
+    Bindless = allowBindless && GLExt.BindlessTexture && hasGLVersion(4, 0) && GLExt.GpuShader5NV;
+    if (Bindless)
+        Shader::setBlockBinding("MaterialHandles", MATERIAL_HANDLES_BINDING);   // Before any program declaring it is linked
+}
+
+MaterialLibrary::~MaterialLibrary()
+{
+    for (TextureArray& array : arrays)
+    {
+        if (array.handle) GLExt.MakeTextureHandleNonResident(array.handle);
+        if (array.texture) GLState.deleteTextures(1, &array.texture);
+    }
+    if (handleUBO) GLState.deleteBuffers(1, &handleUBO);
+}
+
+Material MaterialLibrary::add(const std::string& name, int width, int height, std::vector<std::vector<unsigned char>> levels)
+{
+    auto existing = materials.find(name);
+    if (existing != materials.end())
+        return existing->second;
+
+    // SAME SIZE (EVERYTHING IS RGBA8) GOES INTO THE SAME ARRAY
+    // --------------------------------------------------------
+    size_t index = 0;
+    while (index < arrays.size() && (arrays[index].width != width || arrays[index].height != height))
+        index++;
+    if (index == arrays.size())
+    {
+        arrays.emplace_back();
+        arrays.back().width = width;
+        arrays.back().height = height;
+    }
+    Material material;
+    material.Array = (int)index;
+    material.Layer = (int)arrays[index].layers.size();
+    arrays[index].layers.push_back(std::move(levels));
+    materials[name] = material;
+    return material;
+}
+
+Material MaterialLibrary::find(const std::string& name) const
+{
+    auto found = materials.find(name);
+    return found == materials.end() ? Material() : found->second;
+}
+
+bool MaterialLibrary::build()
+{
+    int maxArrays = Bindless ? MAX_BINDLESS_MATERIAL_ARRAYS : MAX_MATERIAL_ARRAYS;
+    GLint maxLayers = 0;
+    glGetIntegerv(GL_MAX_ARRAY_TEXTURE_LAYERS, &maxLayers);
+    if ((int)arrays.size() > maxArrays)
+    {
+        std::cout << "ERROR::MATERIAL::TOO_MANY_SIZES " << arrays.size() << " texture sizes, the shaders address " << maxArrays << std::endl;
+        return false;
+    }
+
+    for (TextureArray& array : arrays)
+    {
+        if ((GLint)array.layers.size() > maxLayers)
+        {
+            std::cout << "ERROR::MATERIAL::TOO_MANY_LAYERS " << array.layers.size() << " textures of " << array.width << "x" << array.height
+                      << ", the driver allows " << maxLayers << std::endl;
+            return false;
+        }
+
+        // Every layer needs level 0, and gets the rest of its chain generated from it (on the CPU) if it came with fewer
+        size_t levels = 1;
+        while ((std::max(array.width, array.height) >> levels) > 0)
+            levels++;
+        for (auto& layer : array.layers)
+        {
+            if (layer.empty() || layer[0].size() < (size_t)array.width * array.height * 4)
+            {
+                std::cout << "ERROR::MATERIAL::NO_LEVEL_0 in a layer of " << array.width << "x" << array.height << std::endl;
+                return false;
+            }
+            if (layer.size() < levels)
+            {
+                layer.resize(1);
+                for (MipLevel& level : generateMipChain(layer[0].data(), array.width, array.height, 4))
+                    layer.push_back(std::move(level.Pixels));
+            }
+        }
+
+        // ALLOCATE EVERY LEVEL FOR ALL LAYERS, THEN FILL THEM LAYER BY LAYER
+        // ------------------------------------------------------------------
+        glGenTextures(1, &array.texture);
+        GLState.bindTexture(0, GL_TEXTURE_2D_ARRAY, array.texture);
+        for (size_t level = 0; level < levels; level++)
+        {
+            int width = std::max(1, array.width >> level), height = std::max(1, array.height >> level);
+            glTexImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, GL_RGBA8, width, height, (GLsizei)array.layers.size(), 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+            for (size_t layer = 0; layer < array.layers.size(); layer++)
+                glTexSubImage3D(GL_TEXTURE_2D_ARRAY, (GLint)level, 0, 0, (GLint)layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, array.layers[layer][level].data());
+        }
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAX_LEVEL, (GLint)levels - 1);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_REPEAT);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        GLState.bindTexture(0, GL_TEXTURE_2D_ARRAY, 0);
+        array.layers.clear();
+        array.layers.shrink_to_fit();
+
+        // The handle freezes the texture's state, so it is only taken once the array is complete
+        if (Bindless)
+        {
+            array.handle = GLExt.GetTextureHandle(array.texture);
+            GLExt.MakeTextureHandleResident(array.handle);
+        }
+    }
+
+    // BINDLESS: HANDLE TABLE FOR THE SHADERS (std140 PUTS EACH uvec2 ON ITS OWN 16 BYTES)
+    // -----------------------------------------------------------------------------------
+    if (Bindless)
+    {
+        std::vector<GLuint64> table(MAX_BINDLESS_MATERIAL_ARRAYS * 2, 0);
+        for (size_t i = 0; i < arrays.size(); i++)
+            table[i * 2] = arrays[i].handle;
+        glGenBuffers(1, &handleUBO);
+        GLState.bindBuffer(GL_UNIFORM_BUFFER, handleUBO);
+        glBufferData(GL_UNIFORM_BUFFER, table.size() * sizeof(GLuint64), table.data(), GL_STATIC_DRAW);
+        GLState.bindBuffer(GL_UNIFORM_BUFFER, 0);
+        GLState.bindBufferBase(GL_UNIFORM_BUFFER, MATERIAL_HANDLES_BINDING, handleUBO);
+    }
+
+    std::cout << "MATERIAL::BUILT " << materials.size() << " materials in " << arrays.size() << " texture arrays ("
+              << (Bindless ? "bindless handles" : "texture units") << ")" << std::endl;
+    return true;
+}
+
+void MaterialLibrary::bind() const
+{
+    if (Bindless) return;
+    for (size_t i = 0; i < arrays.size(); i++)
+        GLState.bindTexture((unsigned)i, GL_TEXTURE_2D_ARRAY, arrays[i].texture);
+}
+
+void MaterialLibrary::setupShader(const Shader& shader) const
+{
+    if (Bindless) return;   // The handle table is a uniform block, bound at link time
+    UniformHandle samplers = shader.uniform("materialArrays");
+    const GLint units[MAX_MATERIAL_ARRAYS] = {0, 1, 2, 3};
+    if (samplers.valid())
+        glUniform1iv(samplers.location, MAX_MATERIAL_ARRAYS, units);    // Program has to be in use
+}
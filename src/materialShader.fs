@@ -0,0 +1,28 @@
+#version 330 core
+
+// From vertex shader
+in vec2 texCoordToFrag;
+flat in int materialToFrag;     // Texture array << 16 | layer (see material.h)
+
+out vec4 fragColor;
+
+// One array per texture size, bound to units 0-3 for the whole frame
+uniform sampler2DArray materialArrays[4];
+
+void main()
+{
+    int array = materialToFrag >> 16;
+    vec3 coord = vec3(texCoordToFrag, float(materialToFrag & 0xFFFF));
+
+    // GLSL 3.30 only indexes sampler arrays with constants, hence the branches. The material is a varying, so they aren't
+    // uniform control flow where implicit derivatives would be defined: take them up front and sample with explicit ones
+    vec2 dx = dFdx(texCoordToFrag), dy = dFdy(texCoordToFrag);
+    if (array == 0)
+        fragColor = textureGrad(materialArrays[0], coord, dx, dy);
+    else if (array == 1)
+        fragColor = textureGrad(materialArrays[1], coord, dx, dy);
+    else if (array == 2)
+        fragColor = textureGrad(materialArrays[2], coord, dx, dy);
+    else
+        fragColor = textureGrad(materialArrays[3], coord, dx, dy);
+}
@@ -0,0 +1,208 @@
+#include "meshbuilder.h"
+#include <unordered_map>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <iomanip>
+
+// WELDING
+// -------
+// Hashes/compares vertices by their bit patterns (with -0.0 folded into 0.0), so only exact duplicates are merged
+struct VertexKey
+{
+    const float* data;
+    int count;
+};
+struct VertexKeyHash
+{
+    size_t operator()(const VertexKey& key) const
+    {
+        uint64_t hash = 14695981039346656037ULL;
+        for (int i = 0; i < key.count; i++)
+        {
+            float value = key.data[i] == 0.0f ? 0.0f : key.data[i];
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            hash = (hash ^ bits) * 1099511628211ULL;
+        }
+        return (size_t)hash;
+    }
+};
+struct VertexKeyEqual
+{
+    bool operator()(const VertexKey& a, const VertexKey& b) const
+    {
+        for (int i = 0; i < a.count; i++)
+            if (!(a.data[i] == b.data[i]))
+                return false;
+        return true;
+    }
+};
+
+MeshData weldVertices(const std::vector<float>& vertices, int floatsPerVertex)
+{
+    MeshData mesh;
+    mesh.FloatsPerVertex = floatsPerVertex;
+    size_t inputCount = vertices.size() / floatsPerVertex;
+    mesh.Indices.reserve(inputCount);
+
+    // Keys point into the input array, so no vertex is copied just to be looked up
+    std::unordered_map<VertexKey, unsigned, VertexKeyHash, VertexKeyEqual> unique;
+    unique.reserve(inputCount);
+    for (size_t i = 0; i < inputCount; i++)
+    {
+        VertexKey key = {&vertices[i * floatsPerVertex], floatsPerVertex};
+        auto inserted = unique.insert({key, (unsigned)mesh.VertexCount()});
+        if (inserted.second)
+            mesh.Vertices.insert(mesh.Vertices.end(), key.data, key.data + floatsPerVertex);
+        mesh.Indices.push_back(inserted.first->second);
+    }
+    return mesh;
+}
+
+// VERTEX CACHE OPTIMIZATION (TIPSIFY)
+// -----------------------------------
+void optimizeVertexCache(std::vector<unsigned>& indices, size_t vertexCount, int cacheSize)
+{
+    size_t triangleCount = indices.size() / 3;
+    if (triangleCount == 0) return;
+
+    // Vertex -> triangle adjacency in CSR form, plus the number of not yet emitted triangles per vertex
+    std::vector<unsigned> liveTriangles(vertexCount, 0), adjacencyOffset(vertexCount + 1, 0), adjacency(indices.size());
+    for (unsigned index : indices)
+        liveTriangles[index]++;
+    for (size_t v = 0; v < vertexCount; v++)
+        adjacencyOffset[v + 1] = adjacencyOffset[v] + liveTriangles[v];
+    std::vector<unsigned> fill(adjacencyOffset.begin(), adjacencyOffset.end() - 1);
+    for (size_t t = 0; t < triangleCount; t++)
+        for (int corner = 0; corner < 3; corner++)
+            adjacency[fill[indices[t * 3 + corner]]++] = (unsigned)t;
+
+    std::vector<int> cacheTime(vertexCount, 0);     // When each vertex last entered the (simulated) cache
+    std::vector<char> emitted(triangleCount, 0);
+    std::vector<unsigned> deadEnd;                  // Recently referenced vertices, used to restart after a dead end
+    std::vector<unsigned> candidates;
+    std::vector<unsigned> output;
+    output.reserve(indices.size());
+
+    int timeStamp = cacheSize + 1;
+    size_t cursor = 0;      // Scans forward for any vertex with live triangles when the dead-end stack runs dry
+    long fanning = 0;       // Current fanning vertex, start at the first one
+    while (fanning >= 0)
+    {
+        // 1. emit every remaining triangle around the fanning vertex
+        candidates.clear();
+        for (unsigned a = adjacencyOffset[fanning]; a < adjacencyOffset[fanning + 1]; a++)
+        {
+            unsigned t = adjacency[a];
+            if (emitted[t]) continue;
+            for (int corner = 0; corner < 3; corner++)
+            {
+                unsigned v = indices[t * 3 + corner];
+                output.push_back(v);
+                deadEnd.push_back(v);
+                candidates.push_back(v);
+                liveTriangles[v]--;
+                if (timeStamp - cacheTime[v] > cacheSize)   // Not in cache any more, so it is transformed (and cached) again
+                    cacheTime[v] = timeStamp++;
+            }
+            emitted[t] = 1;
+        }
+
+        // 2. next fanning vertex: the candidate still in cache after its remaining triangles are emitted, oldest first
+        long next = -1;
+        int bestPriority = -1;
+        for (unsigned v : candidates)
+        {
+            if (liveTriangles[v] == 0) continue;
+            int priority = 0;
+            if (timeStamp - cacheTime[v] + 2 * (int)liveTriangles[v] <= cacheSize)
+                priority = timeStamp - cacheTime[v];
+            if (priority > bestPriority)
+            {
+                bestPriority = priority;
+                next = v;
+            }
+        }
+
+        // 3. dead end: fall back to recently used vertices, then to any vertex with triangles left
+        if (next == -1)
+        {
+            while (!deadEnd.empty() && next == -1)
+            {
+                unsigned v = deadEnd.back();
+                deadEnd.pop_back();
+                if (liveTriangles[v] > 0) next = v;
+            }
+            while (next == -1 && cursor < vertexCount)
+            {
+                if (liveTriangles[cursor] > 0) next = (long)cursor;
+                cursor++;
+            }
+        }
+        fanning = next;
+    }
+    indices.swap(output);
+}
+
+// VERTEX FETCH OPTIMIZATION
+// -------------------------
+void optimizeVertexFetch(MeshData& mesh)
+{
+    const unsigned UNUSED = ~0u;
+    std::vector<unsigned> remap(mesh.VertexCount(), UNUSED);
+    std::vector<float> reordered;
+    reordered.reserve(mesh.Vertices.size());
+    for (unsigned& index : mesh.Indices)
+    {
+        if (remap[index] == UNUSED)
+        {
+            remap[index] = (unsigned)(reordered.size() / mesh.FloatsPerVertex);
+            const float* vertex = &mesh.Vertices[(size_t)index * mesh.FloatsPerVertex];
+            reordered.insert(reordered.end(), vertex, vertex + mesh.FloatsPerVertex);
+        }
+        index = remap[index];
+    }
+    mesh.Vertices.swap(reordered);
+}
+
+// ANALYSIS
+// --------
+VertexCacheStats analyzeVertexCache(const std::vector<unsigned>& indices, size_t vertexCount, int cacheSize)
+{
+    // FIFO cache: a vertex stays cached until cacheSize newer misses have pushed it out
+    std::vector<long> cachedAt(vertexCount, -(long)cacheSize - 1);
+    long misses = 0;
+    for (unsigned index : indices)
+    {
+        if (misses - cachedAt[index] > cacheSize)
+            cachedAt[index] = misses++;
+    }
+    VertexCacheStats stats;
+    stats.ACMR = indices.empty() ? 0.0f : (float)misses / (indices.size() / 3);
+    stats.ATVR = vertexCount == 0 ? 0.0f : (float)misses / vertexCount;
+    return stats;
+}
+
+MeshData buildMesh(const std::vector<float>& vertices, int floatsPerVertex, const char* name)
+{
+    MeshData mesh = weldVertices(vertices, floatsPerVertex);
+    VertexCacheStats welded = analyzeVertexCache(mesh.Indices, mesh.VertexCount());
+    optimizeVertexCache(mesh.Indices, mesh.VertexCount());
+    optimizeVertexFetch(mesh);
+    VertexCacheStats optimized = analyzeVertexCache(mesh.Indices, mesh.VertexCount());
+
+    if (name)
+    {
+        // Unindexed input transforms every corner: ACMR 3, and ATVR equal to the duplication factor
+        size_t inputCount = vertices.size() / floatsPerVertex;
+        std::cout << std::fixed << std::setprecision(3)
+                  << "MESH::" << name << " vertices " << inputCount << " -> " << mesh.VertexCount()
+                  << ", triangles " << mesh.Indices.size() / 3 << "\n"
+                  << "  unindexed ACMR 3.000 ATVR " << (mesh.VertexCount() ? (float)inputCount / mesh.VertexCount() : 0.0f) << "\n"
+                  << "  welded    ACMR " << welded.ACMR << " ATVR " << welded.ATVR << "\n"
+                  << "  optimized ACMR " << optimized.ACMR << " ATVR " << optimized.ATVR << std::endl;
+        std::cout << std::defaultfloat;
+    }
+    return mesh;
+}
@@ -0,0 +1,190 @@
+#include "meshpool.h"
+#include "glstate.h"
+#include <iostream>
+#include <algorithm>
+#include <iterator>
+
+// RANGE ALLOCATOR
+// ---------------
+RangeAllocator::RangeAllocator(size_t capacity) : Capacity(capacity)
+{
+    if (capacity > 0)
+        freeRanges[0] = capacity;
+}
+
+bool RangeAllocator::allocate(size_t size, size_t& offset)
+{
+    for (auto it = freeRanges.begin(); it != freeRanges.end(); ++it)
+    {
+        if (it->second < size) continue;
+        offset = it->first;
+        size_t remaining = it->second - size;
+        freeRanges.erase(it);
+        if (remaining > 0)
+            freeRanges[offset + size] = remaining;
+        Used += size;
+        return true;
+    }
+    return false;
+}
+
+void RangeAllocator::free(size_t offset, size_t size)
+{
+    Used -= size;
+    auto next = freeRanges.lower_bound(offset);
+    // Merge with the following free range
+    if (next != freeRanges.end() && offset + size == next->first)
+    {
+        size += next->second;
+        next = freeRanges.erase(next);
+    }
+    // Merge with the preceding free range
+    if (next != freeRanges.begin())
+    {
+        auto prev = std::prev(next);
+        if (prev->first + prev->second == offset)
+        {
+            prev->second += size;
+            return;
+        }
+    }
+    freeRanges[offset] = size;
+}
+
+void RangeAllocator::grow(size_t newCapacity)
+{
+    if (newCapacity <= Capacity) return;
+    size_t added = newCapacity - Capacity;
+    size_t oldCapacity = Capacity;
+    Capacity = newCapacity;
+    Used += added;  // free() takes it back off
+    free(oldCapacity, added);
+}
+
+// MESH POOL
+// ---------
+MeshPool::MeshPool(const std::vector<VertexAttribute>& format, size_t vertexCapacity, size_t indexCapacity)
+    : Format(format), FloatsPerVertex(0), vertexRanges(vertexCapacity), indexRanges(indexCapacity)
+{
+    for (const VertexAttribute& attribute : Format)
+        FloatsPerVertex += attribute.components;
+
+    // INIT & BIND THE ONE VAO SHARED BY EVERY MESH IN THE POOL
+    glGenVertexArrays(1, &VAO);
+    GLState.bindVertexArray(VAO);
+
+    // ALLOCATE (BUT DON'T FILL) THE SHARED VERTEX & INDEX BUFFERS, MESHES ARE COPIED INTO SUB-RANGES LATER
+    glGenBuffers(1, &VBO);
+    GLState.bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferData(GL_ARRAY_BUFFER, vertexCapacity * FloatsPerVertex * sizeof(float), NULL, GL_STATIC_DRAW);
+    glGenBuffers(1, &EBO);
+    GLState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);    // Recorded in the VAO
+    glBufferData(GL_ELEMENT_ARRAY_BUFFER, indexCapacity * sizeof(unsigned), NULL, GL_STATIC_DRAW);
+
+    configAttributes();
+    GLState.bindVertexArray(0);
+    GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+}
+
+MeshPool::~MeshPool()
+{
+    GLState.deleteVertexArrays(1, &VAO);
+    unsigned buffers[2] = {VBO, EBO};
+    GLState.deleteBuffers(2, buffers);
+}
+
+void MeshPool::configAttributes() const
+{
+    // Expects VAO bound. Describes to OpenGL how to interpret each attribute of the interleaved vertices in VBO
+    GLState.bindBuffer(GL_ARRAY_BUFFER, VBO);
+    size_t offset = 0;
+    for (const VertexAttribute& attribute : Format)
+    {
+        glVertexAttribPointer(attribute.location, attribute.components, GL_FLOAT, GL_FALSE, FloatsPerVertex * sizeof(float), (void*)(offset * sizeof(float)));
+        glEnableVertexAttribArray(attribute.location);
+        offset += attribute.components;
+    }
+}
+
+void MeshPool::growBuffer(unsigned& buffer, size_t oldBytes, size_t newBytes)
+{
+    // Copy through the dedicated copy targets, so the VAO's element array binding isn't touched
+    unsigned bigger;
+    glGenBuffers(1, &bigger);
+    GLState.bindBuffer(GL_COPY_WRITE_BUFFER, bigger);
+    glBufferData(GL_COPY_WRITE_BUFFER, newBytes, NULL, GL_STATIC_DRAW);
+    GLState.bindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, oldBytes);
+    GLState.bindBuffer(GL_COPY_READ_BUFFER, 0);
+    GLState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    GLState.deleteBuffers(1, &buffer);
+    buffer = bigger;
+}
+
+MeshHandle MeshPool::add(const MeshData& mesh)
+{
+    MeshHandle handle;
+    if (mesh.FloatsPerVertex != FloatsPerVertex || mesh.Indices.empty())
+    {
+        std::cout << "ERROR::MESHPOOL::MESH_FORMAT_MISMATCH" << std::endl;
+        return handle;
+    }
+
+    size_t vertexOffset, indexOffset;
+    size_t vertexCount = mesh.VertexCount(), indexCount = mesh.Indices.size();
+    while (!vertexRanges.allocate(vertexCount, vertexOffset))
+    {
+        size_t oldCapacity = vertexRanges.Capacity;
+        vertexRanges.grow(std::max(oldCapacity * 2, oldCapacity + vertexCount));
+        growBuffer(VBO, oldCapacity * FloatsPerVertex * sizeof(float), vertexRanges.Capacity * FloatsPerVertex * sizeof(float));
+        GLState.bindVertexArray(VAO);
+        configAttributes();     // Re-point the attributes at the new buffer
+        GLState.bindVertexArray(0);
+    }
+    while (!indexRanges.allocate(indexCount, indexOffset))
+    {
+        size_t oldCapacity = indexRanges.Capacity;
+        indexRanges.grow(std::max(oldCapacity * 2, oldCapacity + indexCount));
+        growBuffer(EBO, oldCapacity * sizeof(unsigned), indexRanges.Capacity * sizeof(unsigned));
+        GLState.bindVertexArray(VAO);
+        GLState.bindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO);
+        GLState.bindVertexArray(0);
+    }
+
+    // COPY THE MESH INTO ITS RANGES (index buffer through the VAO, since that is where the element array binding lives)
+    GLState.bindBuffer(GL_ARRAY_BUFFER, VBO);
+    glBufferSubData(GL_ARRAY_BUFFER, vertexOffset * FloatsPerVertex * sizeof(float), mesh.Vertices.size() * sizeof(float), mesh.Vertices.data());
+    GLState.bindBuffer(GL_ARRAY_BUFFER, 0);
+    GLState.bindVertexArray(VAO);
+    glBufferSubData(GL_ELEMENT_ARRAY_BUFFER, indexOffset * sizeof(unsigned), indexCount * sizeof(unsigned), mesh.Indices.data());
+    GLState.bindVertexArray(0);
+
+    handle.baseVertex = (GLint)vertexOffset;
+    handle.firstIndex = (unsigned)indexOffset;
+    handle.indexCount = (GLsizei)indexCount;
+    handle.vertexCount = (unsigned)vertexCount;
+    return handle;
+}
+
+void MeshPool::remove(MeshHandle& handle)
+{
+    if (!handle.valid()) return;
+    vertexRanges.free(handle.baseVertex, handle.vertexCount);
+    indexRanges.free(handle.firstIndex, handle.indexCount);
+    handle = MeshHandle();
+}
+
+void MeshPool::bind() const
+{
+    GLState.bindVertexArray(VAO);
+}
+
+void MeshPool::draw(const MeshHandle& handle) const
+{
+    glDrawElementsBaseVertex(GL_TRIANGLES, handle.indexCount, GL_UNSIGNED_INT, (void*)(handle.firstIndex * sizeof(unsigned)), handle.baseVertex);
+}
+
+void MeshPool::drawInstanced(const MeshHandle& handle, GLsizei instanceCount) const
+{
+    glDrawElementsInstancedBaseVertex(GL_TRIANGLES, handle.indexCount, GL_UNSIGNED_INT, (void*)(handle.firstIndex * sizeof(unsigned)), instanceCount, handle.baseVertex);
+}
@@ -0,0 +1,292 @@
+#include "mipmap.h"
+#include <cmath>
+#include <algorithm>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define MIPMAP_X86 1
+#include <immintrin.h>
+#endif
+
+// AVX2 code lives in functions compiled for AVX2 only, the rest of the file stays baseline so it runs on any x86-64 CPU
+#if defined(MIPMAP_X86) && defined(__GNUC__)
+#define MIPMAP_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#else
+#define MIPMAP_TARGET_AVX2
+#endif
+
+// SRGB <-> LINEAR TABLES
+// ----------------------
+const int LINEAR_TABLE_SIZE = 16384;   // Fine enough that the steep dark end of the sRGB curve still rounds correctly
+
+struct SrgbTables
+{
+    float toLinear[256];
+    unsigned char toSrgb[LINEAR_TABLE_SIZE + 1];
+
+    SrgbTables()
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            float s = i / 255.0f;
+            toLinear[i] = s <= 0.04045f ? s / 12.92f : std::pow((s + 0.055f) / 1.055f, 2.4f);
+        }
+        for (int i = 0; i <= LINEAR_TABLE_SIZE; i++)
+        {
+            float l = (float)i / LINEAR_TABLE_SIZE;
+            float s = l <= 0.0031308f ? l * 12.92f : 1.055f * std::pow(l, 1.0f / 2.4f) - 0.055f;
+            toSrgb[i] = (unsigned char)std::min(255.0f, s * 255.0f + 0.5f);
+        }
+    }
+};
+
+static const SrgbTables& srgbTables()
+{
+    static SrgbTables tables;   // Built on first use, thread-safe since C++11
+    return tables;
+}
+
+// FILTER WEIGHTS
+// --------------
+// Per destination texel along one axis: 'taps' source indices (clamped to the edge) and their normalized weights
+struct AxisFilter
+{
+    int taps = 0;
+    std::vector<int> index;
+    std::vector<float> weight;
+};
+
+static double besselI0(double x)
+{
+    double sum = 1.0, term = 1.0;
+    for (int k = 1; k < 32 && term > 1e-12 * sum; k++)
+    {
+        term *= (x / (2.0 * k)) * (x / (2.0 * k));
+        sum += term;
+    }
+    return sum;
+}
+
+const double KAISER_RADIUS = 3.0, KAISER_ALPHA = 4.0, PI = 3.14159265358979323846;
+
+static double kaiserWeight(double x)  // x in destination texels
+{
+    if (std::fabs(x) >= KAISER_RADIUS) return 0.0;
+    double t = x / KAISER_RADIUS;
+    double sinc = x == 0.0 ? 1.0 : std::sin(PI * x) / (PI * x);
+    return sinc * besselI0(KAISER_ALPHA * std::sqrt(1.0 - t * t)) / besselI0(KAISER_ALPHA);
+}
+
+static AxisFilter buildAxisFilter(int srcSize, int dstSize, MipFilter filter)
+{
+    AxisFilter axis;
+    double scale = (double)srcSize / dstSize;     // 2 for even sizes, a bit more for odd ones (e.g. 225 -> 112)
+    axis.taps = filter == MIP_FILTER_BOX ? (int)std::ceil(scale) + 1 : (int)std::ceil(2.0 * KAISER_RADIUS * scale) + 1;
+    axis.index.resize((size_t)dstSize * axis.taps);
+    axis.weight.resize((size_t)dstSize * axis.taps);
+    for (int i = 0; i < dstSize; i++)
+    {
+        double lo = i * scale, hi = (i + 1) * scale, centre = (i + 0.5) * scale;
+        int first = filter == MIP_FILTER_BOX ? (int)std::floor(lo) : (int)std::floor(centre - KAISER_RADIUS * scale);
+        double sum = 0.0;
+        for (int k = 0; k < axis.taps; k++)
+        {
+            int j = first + k;
+            double w = filter == MIP_FILTER_BOX
+                ? std::max(0.0, std::min(hi, j + 1.0) - std::max(lo, (double)j))    // Overlap of texel j with the footprint
+                : kaiserWeight((j + 0.5 - centre) / scale);
+            axis.index[(size_t)i * axis.taps + k] = std::min(std::max(j, 0), srcSize - 1);
+            axis.weight[(size_t)i * axis.taps + k] = (float)w;
+            sum += w;
+        }
+        for (int k = 0; k < axis.taps; k++)
+            axis.weight[(size_t)i * axis.taps + k] = (float)(axis.weight[(size_t)i * axis.taps + k] / sum);
+    }
+    return axis;
+}
+
+// VERTICAL PASS: out[n] += w * in[n] OVER WHOLE ROWS (CHANNEL LAYOUT DOESN'T MATTER, SO THIS IS WHERE SIMD PAYS MOST)
+// -------------------------------------------------------------------------------------------------------------------
+static void rowAxpyScalar(float* out, const float* in, float w, size_t n)
+{
+    for (size_t i = 0; i < n; i++)
+        out[i] += w * in[i];
+}
+
+#ifdef MIPMAP_X86
+static void rowAxpySSE2(float* out, const float* in, float w, size_t n)
+{
+    __m128 weight = _mm_set1_ps(w);
+    size_t i = 0;
+    for (; i + 4 <= n; i += 4)
+        _mm_storeu_ps(out + i, _mm_add_ps(_mm_loadu_ps(out + i), _mm_mul_ps(weight, _mm_loadu_ps(in + i))));
+    rowAxpyScalar(out + i, in + i, w, n - i);
+}
+
+MIPMAP_TARGET_AVX2 static void rowAxpyAVX2(float* out, const float* in, float w, size_t n)
+{
+    __m256 weight = _mm256_set1_ps(w);
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8)
+        _mm256_storeu_ps(out + i, _mm256_fmadd_ps(weight, _mm256_loadu_ps(in + i), _mm256_loadu_ps(out + i)));
+    rowAxpyScalar(out + i, in + i, w, n - i);
+}
+#endif
+
+// HORIZONTAL PASS: ONE ROW, GATHERING EACH DESTINATION TEXEL'S TAPS
+// -----------------------------------------------------------------
+static void filterRowScalar(float* out, const float* in, const AxisFilter& axis, int dstWidth, int channels)
+{
+    for (int x = 0; x < dstWidth; x++)
+    {
+        const int* index = &axis.index[(size_t)x * axis.taps];
+        const float* weight = &axis.weight[(size_t)x * axis.taps];
+        for (int c = 0; c < channels; c++)
+        {
+            float sum = 0.0f;
+            for (int k = 0; k < axis.taps; k++)
+                sum += weight[k] * in[index[k] * channels + c];
+            out[x * channels + c] = sum;
+        }
+    }
+}
+
+#ifdef MIPMAP_X86
+// RGBA only: one texel is exactly one register. Starts at 'firstX' so the AVX2 version can hand over its odd last texel
+static void filterRowSSE2(float* out, const float* in, const AxisFilter& axis, int dstWidth, int firstX = 0)
+{
+    for (int x = firstX; x < dstWidth; x++)
+    {
+        const int* index = &axis.index[(size_t)x * axis.taps];
+        const float* weight = &axis.weight[(size_t)x * axis.taps];
+        __m128 sum = _mm_setzero_ps();
+        for (int k = 0; k < axis.taps; k++)
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(weight[k]), _mm_loadu_ps(in + index[k] * 4)));
+        _mm_storeu_ps(out + x * 4, sum);
+    }
+}
+
+// RGBA only: two destination texels per register, every texel has the same tap count
+MIPMAP_TARGET_AVX2 static void filterRowAVX2(float* out, const float* in, const AxisFilter& axis, int dstWidth)
+{
+    int x = 0;
+    for (; x + 2 <= dstWidth; x += 2)
+    {
+        const int* index = &axis.index[(size_t)x * axis.taps];
+        const float* weight = &axis.weight[(size_t)x * axis.taps];
+        __m256 sum = _mm256_setzero_ps();
+        for (int k = 0; k < axis.taps; k++)
+        {
+            __m256 texels = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(in + index[k] * 4)), _mm_loadu_ps(in + index[axis.taps + k] * 4), 1);
+            __m256 weights = _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_set1_ps(weight[k])), _mm_set1_ps(weight[axis.taps + k]), 1);
+            sum = _mm256_fmadd_ps(weights, texels, sum);
+        }
+        _mm256_storeu_ps(out + x * 4, sum);
+    }
+    filterRowSSE2(out, in, axis, dstWidth, x);
+}
+#endif
+
+// DISPATCH
+// --------
+MipSimd detectMipSimd()
+{
+#if defined(MIPMAP_X86) && defined(__GNUC__)
+    if (__builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma"))
+        return MIP_SIMD_AVX2;
+    return MIP_SIMD_SSE2;
+#elif defined(MIPMAP_X86)
+    return MIP_SIMD_SSE2;
+#else
+    return MIP_SIMD_SCALAR;
+#endif
+}
+
+const char* mipSimdName(MipSimd simd)
+{
+    switch (simd)
+    {
+    case MIP_SIMD_SCALAR: return "scalar";
+    case MIP_SIMD_SSE2:   return "SSE2";
+    case MIP_SIMD_AVX2:   return "AVX2";
+    default:              return mipSimdName(detectMipSimd());
+    }
+}
+
+static void rowAxpy(float* out, const float* in, float w, size_t n, MipSimd simd)
+{
+#ifdef MIPMAP_X86
+    if (simd == MIP_SIMD_AVX2) { rowAxpyAVX2(out, in, w, n); return; }
+    if (simd == MIP_SIMD_SSE2) { rowAxpySSE2(out, in, w, n); return; }
+#endif
+    rowAxpyScalar(out, in, w, n);
+}
+
+static void filterRow(float* out, const float* in, const AxisFilter& axis, int dstWidth, int channels, MipSimd simd)
+{
+#ifdef MIPMAP_X86
+    if (channels == 4 && simd == MIP_SIMD_AVX2) { filterRowAVX2(out, in, axis, dstWidth); return; }
+    if (channels == 4 && simd == MIP_SIMD_SSE2) { filterRowSSE2(out, in, axis, dstWidth); return; }
+#endif
+    filterRowScalar(out, in, axis, dstWidth, channels);
+}
+
+// MIP CHAIN
+// ---------
+std::vector<MipLevel> generateMipChain(const unsigned char* pixels, int width, int height, int channels, const MipOptions& options)
+{
+    std::vector<MipLevel> levels;
+    if (pixels == NULL || width <= 0 || height <= 0 || (channels != 1 && channels != 3 && channels != 4))
+        return levels;
+
+    MipSimd simd = options.Simd == MIP_SIMD_BEST ? detectMipSimd() : std::min(options.Simd, detectMipSimd());
+    const SrgbTables& tables = srgbTables();
+    bool srgbChannel[4];
+    for (int c = 0; c < 4; c++)
+        srgbChannel[c] = options.Srgb && !(channels == 4 && c == 3);
+
+    // Level 0 to float once, every later level is filtered from the previous float level
+    std::vector<float> current((size_t)width * height * channels), vertical, next;
+    for (size_t i = 0; i < current.size(); i += channels)
+        for (int c = 0; c < channels; c++)
+            current[i + c] = srgbChannel[c] ? tables.toLinear[pixels[i + c]] : pixels[i + c] / 255.0f;
+
+    while (width > 1 || height > 1)
+    {
+        int dstWidth = std::max(1, width / 2), dstHeight = std::max(1, height / 2);
+        AxisFilter filterX = buildAxisFilter(width, dstWidth, options.Filter);
+        AxisFilter filterY = buildAxisFilter(height, dstHeight, options.Filter);
+
+        // Vertical first, so the wide row pass runs over the full source width and the gather pass over half as many rows
+        size_t rowFloats = (size_t)width * channels;
+        vertical.assign(rowFloats * dstHeight, 0.0f);
+        for (int y = 0; y < dstHeight; y++)
+            for (int k = 0; k < filterY.taps; k++)
+            {
+                float w = filterY.weight[(size_t)y * filterY.taps + k];
+                if (w != 0.0f)
+                    rowAxpy(&vertical[y * rowFloats], &current[filterY.index[(size_t)y * filterY.taps + k] * rowFloats], w, rowFloats, simd);
+            }
+        next.resize((size_t)dstWidth * dstHeight * channels);
+        for (int y = 0; y < dstHeight; y++)
+            filterRow(&next[(size_t)y * dstWidth * channels], &vertical[y * rowFloats], filterX, dstWidth, channels, simd);
+
+        // Back to 8 bits for the level, clamping Kaiser overshoot in the float chain too
+        MipLevel level;
+        level.Width = dstWidth;
+        level.Height = dstHeight;
+        level.Pixels.resize(next.size());
+        for (size_t i = 0; i < next.size(); i += channels)
+            for (int c = 0; c < channels; c++)
+            {
+                float v = std::min(1.0f, std::max(0.0f, next[i + c]));
+                next[i + c] = v;
+                level.Pixels[i + c] = srgbChannel[c] ? tables.toSrgb[(int)(v * LINEAR_TABLE_SIZE + 0.5f)] : (unsigned char)(v * 255.0f + 0.5f);
+            }
+        levels.push_back(std::move(level));
+
+        current.swap(next);
+        width = dstWidth;
+        height = dstHeight;
+    }
+    return levels;
+}
@@ -0,0 +1,176 @@
+#include "occlusion.h"
+#include "profiler.h"
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+
+// Rows are rasterized 4 pixels at a time
+OcclusionBuffer::OcclusionBuffer(int width, int height, WorkerPool* pool)
+    : Width(std::max(4, (width + 3) & ~3)), Height(std::max(1, height)), tiles(Width, Height, pool)
+{
+    int levelWidth = Width, levelHeight = Height;
+    while (true)
+    {
+        levels.emplace_back((size_t)levelWidth * levelHeight, 1.0f);
+        levelWidths.push_back(levelWidth);
+        levelHeights.push_back(levelHeight);
+        if (levelWidth == 1 && levelHeight == 1) break;
+        levelWidth = std::max(1, (levelWidth + 1) / 2);
+        levelHeight = std::max(1, (levelHeight + 1) / 2);
+    }
+}
+
+void OcclusionBuffer::begin(const glm::mat4& matrix)
+{
+    viewProjection = matrix;
+    triangles.clear();
+    Stats = OcclusionStats();
+}
+
+// OCCLUDERS: TRANSFORM, REJECT & SET UP EACH TRIANGLE FOR THE EDGE FUNCTIONS
+// --------------------------------------------------------------------------
+void OcclusionBuffer::addOccluder(const MeshData& mesh, const glm::mat4& model)
+{
+    glm::mat4 toClip = viewProjection * model;
+    std::vector<glm::vec4> clip(mesh.VertexCount());
+    for (size_t i = 0; i < clip.size(); i++)
+    {
+        const float* position = &mesh.Vertices[i * mesh.FloatsPerVertex];
+        clip[i] = toClip * glm::vec4(position[0], position[1], position[2], 1.0f);
+    }
+
+    for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+    {
+        glm::vec3 screen[3];
+        bool rejected = false;
+        for (int corner = 0; corner < 3 && !rejected; corner++)
+        {
+            const glm::vec4& v = clip[mesh.Indices[i + corner]];
+            // In front of the near plane GL clips it away, so it must not occlude anything here either
+            rejected = v.w <= 1e-6f || v.z < -v.w;
+            screen[corner] = glm::vec3((v.x / v.w * 0.5f + 0.5f) * Width, (v.y / v.w * 0.5f + 0.5f) * Height, v.z / v.w * 0.5f + 0.5f);
+        }
+        if (rejected) continue;
+
+        // Both windings are rasterized (nearest depth wins anyway)
+        RasterTriangle triangle;
+        float area;
+        bool flipped;
+        if (setupRasterTriangle(screen, Width, Height, triangle, area, flipped))
+            triangles.push_back(triangle);
+    }
+}
+
+// RASTERIZATION
+// -------------
+void OcclusionBuffer::rasterize()
+{
+    auto start = std::chrono::steady_clock::now();
+    Stats.OccluderTriangles = triangles.size();
+
+    tiles.bin(triangles);
+    tiles.run([this](int tile) { rasterizeTile(tile); });
+
+    buildPyramid();
+    Stats.RasterMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void OcclusionBuffer::rasterizeTile(int tile)
+{
+    PROFILE_SCOPE("occlusion tile");
+    int tileX0, tileY0, tileX1, tileY1;
+    tiles.bounds(tile, tileX0, tileY0, tileX1, tileY1);
+    float* depth = levels[0].data();
+    for (int y = tileY0; y <= tileY1; y++)
+        std::fill(depth + y * Width + tileX0, depth + y * Width + tileX1 + 1, 1.0f);
+
+    // No fill rule: a pixel center on any edge is covered, the nearest depth wins anyway
+    int width = Width;
+    for (uint32_t index : tiles.triangles(tile))
+        rasterizeQuads<false>(triangles[index], tileX0, tileY0, tileX1, tileY1, width, [depth, width](const RasterQuad& quad)
+        {
+            float* row = depth + quad.Y * width + quad.X;
+#ifdef TILEDRASTER_X86
+            __m128 current = _mm_loadu_ps(row);
+            __m128 nearest = _mm_min_ps(current, quad.Z);
+            _mm_storeu_ps(row, _mm_or_ps(_mm_and_ps(quad.Covered, nearest), _mm_andnot_ps(quad.Covered, current)));
+#else
+            for (int lane = 0; lane < 4; lane++)
+                if (quad.Mask & (1 << lane))
+                    row[lane] = std::min(row[lane], quad.Depth[lane]);
+#endif
+        });
+}
+
+void OcclusionBuffer::buildPyramid()
+{
+    for (size_t level = 1; level < levels.size(); level++)
+    {
+        const std::vector<float>& source = levels[level - 1];
+        std::vector<float>& target = levels[level];
+        int sourceWidth = levelWidths[level - 1], sourceHeight = levelHeights[level - 1];
+        for (int y = 0; y < levelHeights[level]; y++)
+            for (int x = 0; x < levelWidths[level]; x++)
+            {
+                // Farthest of the (up to) 2x2 texels below, an odd last row/column is just read twice
+                int x0 = x * 2, x1 = std::min(x0 + 1, sourceWidth - 1), y0 = y * 2, y1 = std::min(y0 + 1, sourceHeight - 1);
+                target[y * levelWidths[level] + x] = std::max(std::max(source[y0 * sourceWidth + x0], source[y0 * sourceWidth + x1]),
+                                                              std::max(source[y1 * sourceWidth + x0], source[y1 * sourceWidth + x1]));
+            }
+    }
+}
+
+// OCCLUDEE TESTS
+// --------------
+bool OcclusionBuffer::visible(const glm::vec3& center, const glm::vec3& extent) const
+{
+    // SCREEN RECTANGLE & NEAREST DEPTH OF THE BOX'S 8 CORNERS
+    float minX = 1e30f, minY = 1e30f, maxX = -1e30f, maxY = -1e30f, nearest = 1.0f;
+    for (int corner = 0; corner < 8; corner++)
+    {
+        glm::vec3 offset((corner & 1) ? extent.x : -extent.x, (corner & 2) ? extent.y : -extent.y, (corner & 4) ? extent.z : -extent.z);
+        glm::vec4 v = viewProjection * glm::vec4(center + offset, 1.0f);
+        if (v.w <= 1e-6f || v.z < -v.w)
+            return true;    // Reaches the near plane, can't be behind anything
+        float x = (v.x / v.w * 0.5f + 0.5f) * Width, y = (v.y / v.w * 0.5f + 0.5f) * Height;
+        minX = std::min(minX, x);
+        maxX = std::max(maxX, x);
+        minY = std::min(minY, y);
+        maxY = std::max(maxY, y);
+        nearest = std::min(nearest, v.z / v.w * 0.5f + 0.5f);
+    }
+    int x0 = std::max(0, (int)std::floor(minX)), x1 = std::min(Width - 1, (int)std::floor(maxX));
+    int y0 = std::max(0, (int)std::floor(minY)), y1 = std::min(Height - 1, (int)std::floor(maxY));
+    if (x0 > x1 || y0 > y1)
+        return true;        // Off screen, that's for the frustum test to decide
+
+    // PYRAMID LEVEL WHERE THE RECTANGLE COVERS AT MOST ~4x4 TEXELS, VISIBLE IF ANY OF THEM IS FARTHER THAN ITS NEAREST POINT
+    size_t level = 0;
+    while (level + 1 < levels.size() && std::max(x1 - x0, y1 - y0) >> level > 3)
+        level++;
+    const std::vector<float>& depth = levels[level];
+    int levelWidth = levelWidths[level];
+    for (int y = y0 >> level; y <= y1 >> level; y++)
+        for (int x = x0 >> level; x <= x1 >> level; x++)
+            if (depth[y * levelWidth + x] >= nearest)
+                return true;
+    return false;
+}
+
+size_t OcclusionBuffer::cull(const CullingBounds& bounds, std::vector<uint32_t>& indices)
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t kept = 0;
+    for (uint32_t index : indices)
+    {
+        glm::vec3 center(bounds.CenterX[index], bounds.CenterY[index], bounds.CenterZ[index]);
+        glm::vec3 extent(bounds.ExtentX[index], bounds.ExtentY[index], bounds.ExtentZ[index]);
+        if (visible(center, extent))
+            indices[kept++] = index;
+    }
+    Stats.Tested += indices.size();
+    Stats.Occluded += indices.size() - kept;
+    indices.resize(kept);
+    Stats.TestMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+    return kept;
+}
@@ -0,0 +1,101 @@
+#include "profiler.h"
+#include <cstdio>
+#include <algorithm>
+
+CpuProfiler Profiler;
+
+ProfileThreadBuffer* CpuProfiler::threadBuffer()
+{
+    thread_local ProfileThreadBuffer* buffer = NULL;
+    if (!buffer)
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        threads.emplace_back(new ProfileThreadBuffer());
+        buffer = threads.back().get();
+        buffer->ThreadIndex = (unsigned)threads.size() - 1;
+    }
+    return buffer;
+}
+
+void CpuProfiler::record(const char* name, uint64_t start, uint64_t end)
+{
+    ProfileThreadBuffer* buffer = threadBuffer();
+    uint64_t head = buffer->Head.load(std::memory_order_relaxed);
+    buffer->Events[head & (ProfileThreadBuffer::CAPACITY - 1)] = {name, start, end};
+    buffer->Head.store(head + 1, std::memory_order_release);
+}
+
+void CpuProfiler::setThreadName(const char* name)
+{
+    if (!Recording.load(std::memory_order_relaxed))
+        return;     // Not worth a ring for a thread that won't record anything
+    ProfileThreadBuffer* buffer = threadBuffer();
+    std::lock_guard<std::mutex> lock(mutex);    // Read by dumps
+    buffer->ThreadName = name;
+}
+
+// Zone names are literals from the code, only quotes & backslashes need escaping
+static void writeJsonString(FILE* file, const char* text)
+{
+    fputc('"', file);
+    for (const char* c = text; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            fputc('\\', file);
+        fputc(*c, file);
+    }
+    fputc('"', file);
+}
+
+long CpuProfiler::writeChromeTrace(const char* path)
+{
+    FILE* file = fopen(path, "w");
+    if (!file)
+    {
+        printf("ERROR::PROFILER::CANT_WRITE %s\n", path);
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    uint64_t origin = UINT64_MAX;   // Timestamps start at the first event, so they stay readable as microseconds
+    std::vector<std::vector<ProfileEvent>> copies(threads.size());
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        // COPY OUT WHILE THE OWNER KEEPS RECORDING: KEEP ONLY WHAT IT CAN'T HAVE OVERWRITTEN BY THE TIME THE COPY ENDED
+        ProfileThreadBuffer& buffer = *threads[t];
+        uint64_t head = buffer.Head.load(std::memory_order_acquire);
+        uint64_t first = head > ProfileThreadBuffer::CAPACITY ? head - ProfileThreadBuffer::CAPACITY : 0;
+        std::vector<ProfileEvent>& events = copies[t];
+        for (uint64_t i = first; i < head; i++)
+            events.push_back(buffer.Events[i & (ProfileThreadBuffer::CAPACITY - 1)]);
+        // (the slot of event headAfter may be half written already, so the one it replaces goes too)
+        uint64_t headAfter = buffer.Head.load(std::memory_order_acquire);
+        if (headAfter + 1 > first + ProfileThreadBuffer::CAPACITY)
+            events.erase(events.begin(), events.begin() + (size_t)std::min<uint64_t>(events.size(), headAfter + 1 - ProfileThreadBuffer::CAPACITY - first));
+        for (const ProfileEvent& event : events)
+            origin = std::min(origin, event.Start);
+    }
+
+    long written = 0;
+    fprintf(file, "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n");
+    for (size_t t = 0; t < threads.size(); t++)
+    {
+        fprintf(file, "%s{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, \"tid\": %u, \"args\": {\"name\": ", t ? ",\n" : "", threads[t]->ThreadIndex);
+        if (threads[t]->ThreadName)
+            writeJsonString(file, threads[t]->ThreadName);
+        else
+            fprintf(file, "\"thread %u\"", threads[t]->ThreadIndex);
+        fprintf(file, "}}");
+        for (const ProfileEvent& event : copies[t])
+        {
+            fprintf(file, ",\n{\"name\": ");
+            writeJsonString(file, event.Name);
+            fprintf(file, ", \"ph\": \"X\", \"pid\": 1, \"tid\": %u, \"ts\": %.3f, \"dur\": %.3f}", threads[t]->ThreadIndex,
+                    (event.Start - origin) / 1000.0, (event.End - event.Start) / 1000.0);
+            written++;
+        }
+    }
+    fprintf(file, "\n]}\n");
+    fclose(file);
+    return written;
+}
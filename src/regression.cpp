@@ -0,0 +1,300 @@
+#include "regression.h"
+#include "framestats.h"
+#include "stb_image.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdint>
+#include <cmath>
+#include <map>
+#include <algorithm>
+#include <iostream>
+
+// Around the center container, from the side & above, right up against it (near plane clipping), and over the spawned ones
+const std::vector<RegressionPose> RegressionRun::Poses = {
+    {"default", glm::vec3(0.0f, 0.0f, 0.0f), -90.0f, 0.0f},
+    {"above", glm::vec3(0.0f, 1.0f, 4.0f), -90.0f, -30.0f},
+    {"side", glm::vec3(4.0f, 0.5f, -3.0f), 180.0f, -5.0f},
+    {"close", glm::vec3(0.3f, -0.2f, -1.9f), -100.0f, -40.0f},
+    {"overview", glm::vec3(0.0f, 8.0f, 8.0f), -90.0f, -45.0f}
+};
+
+RegressionRun::RegressionRun(const std::string& directory, const std::string& backend, int framesPerPose, bool update, double thresholdPercent)
+    : directory(directory), backend(backend), framesPerPose(std::max(1, framesPerPose)), update(update), thresholdPercent(thresholdPercent)
+{
+    results.resize(Poses.size());
+    for (PoseResult& result : results)
+        result.FrameTimes.reserve(this->framesPerPose);
+}
+
+void RegressionRun::beginFrame(int frame, Camera& camera) const
+{
+    if (frame % framesPerPose != 0) return;
+    const RegressionPose& pose = Poses[frame / framesPerPose];
+    camera = Camera(pose.Position, glm::vec3(0.0f, 1.0f, 0.0f), pose.Yaw, pose.Pitch);
+}
+
+void RegressionRun::endFrame(int frame, double ms, int drawCalls, const std::vector<unsigned char>* pixels, int width, int height)
+{
+    PoseResult& result = results[frame / framesPerPose];
+    result.FrameTimes.push_back(ms);
+    result.DrawCalls = drawCalls;
+    if (pixels && captureFrame(frame))
+    {
+        result.Pixels = *pixels;
+        result.Width = width;
+        result.Height = height;
+    }
+}
+
+// IMAGE COMPARISON IN CIELAB, WHERE EQUAL DISTANCES LOOK ABOUT EQUALLY DIFFERENT
+// ------------------------------------------------------------------------------
+static glm::vec3 srgbToLab(const unsigned char* pixel)
+{
+    static float linear[256];
+    static bool tableReady = false;
+    if (!tableReady)
+    {
+        for (int i = 0; i < 256; i++)
+        {
+            float c = i / 255.0f;
+            linear[i] = c <= 0.04045f ? c / 12.92f : std::pow((c + 0.055f) / 1.055f, 2.4f);
+        }
+        tableReady = true;
+    }
+    float r = linear[pixel[0]], g = linear[pixel[1]], b = linear[pixel[2]];
+    // Linear sRGB -> XYZ, relative to the D65 white point
+    float x = (0.4124f * r + 0.3576f * g + 0.1805f * b) / 0.95047f;
+    float y = 0.2126f * r + 0.7152f * g + 0.0722f * b;
+    float z = (0.0193f * r + 0.1192f * g + 0.9505f * b) / 1.08883f;
+    auto f = [](float t) { return t > 0.008856f ? std::cbrt(t) : 7.787f * t + 16.0f / 116.0f; };
+    return glm::vec3(116.0f * f(y) - 16.0f, 500.0f * (f(x) - f(y)), 200.0f * (f(y) - f(z)));
+}
+
+// Pixels whose colour difference (alpha ignored) is past REGRESSION_MAX_DELTA_E
+static size_t countDifferentPixels(const std::vector<unsigned char>& a, const std::vector<unsigned char>& b)
+{
+    size_t different = 0;
+    for (size_t i = 0; i + 3 < a.size() && i + 3 < b.size(); i += 4)
+        if ((a[i] != b[i] || a[i + 1] != b[i + 1] || a[i + 2] != b[i + 2])
+            && glm::length(srgbToLab(&a[i]) - srgbToLab(&b[i])) > REGRESSION_MAX_DELTA_E)
+            different++;
+    return different;
+}
+
+// BASELINE & RESULTS (ONE POSE PER LINE, SO READING BACK WHAT WAS WRITTEN NEEDS NO JSON PARSER)
+// ---------------------------------------------------------------------------------------------
+struct PoseBaseline
+{
+    double MedianMs = -1.0;     // -1: the baseline has no frame time for the pose (only draw calls are compared)
+    int DrawCalls = 0;
+};
+
+static std::map<std::string, PoseBaseline> readBaseline(const std::string& path)
+{
+    std::map<std::string, PoseBaseline> baseline;
+    FILE* file = fopen(path.c_str(), "r");
+    if (!file) return baseline;
+    char line[512];
+    while (fgets(line, sizeof(line), file))
+    {
+        char name[64];
+        PoseBaseline pose;
+        const char* entry = strstr(line, "{\"name\": ");
+        const char* drawCalls = strstr(line, "\"draw_calls\": ");
+        if (!entry || !drawCalls || sscanf(entry, "{\"name\": \"%63[^\"]\"", name) != 1 || sscanf(drawCalls, "\"draw_calls\": %d", &pose.DrawCalls) != 1)
+            continue;
+        // Frame times only compare on the machine that recorded them, a baseline shared between machines leaves them out
+        const char* median = strstr(line, "\"p50_ms\": ");
+        if (median)
+            sscanf(median, "\"p50_ms\": %lf", &pose.MedianMs);
+        baseline[name] = pose;
+    }
+    fclose(file);
+    return baseline;
+}
+
+bool RegressionRun::finish()
+{
+    std::map<std::string, PoseBaseline> baseline;
+    if (!update)
+    {
+        baseline = readBaseline(path("baseline.json"));
+        if (baseline.empty())
+            std::cout << "ERROR::REGRESSION::NO_BASELINE " << path("baseline.json") << " (record one with --regress-update)" << std::endl;
+    }
+
+    std::string json = "{\n  \"backend\": \"" + backend + "\",\n  \"frames_per_pose\": " + std::to_string(framesPerPose) + ",\n  \"poses\": [\n";
+    bool passed = update || !baseline.empty();
+    printf("regression (%s, %d frames per pose, %.0f%% frame time threshold)%s\n", backend.c_str(), framesPerPose, thresholdPercent,
+           update ? ": references & baseline updated" : "");
+    for (size_t i = 0; i < Poses.size(); i++)
+    {
+        const RegressionPose& pose = Poses[i];
+        PoseResult& result = results[i];
+        std::vector<double> sorted = result.FrameTimes;
+        std::sort(sorted.begin(), sorted.end());
+        double mean = 0.0;
+        for (double t : sorted) mean += t;
+        mean = sorted.empty() ? 0.0 : mean / sorted.size();
+        double median = FrameStats::Percentile(sorted, 50.0);
+        double p95 = FrameStats::Percentile(sorted, 95.0);
+
+        // GOLDEN IMAGE
+        std::string failure;
+        long differentPixels = -1;
+        if (update)
+        {
+            if (!writePng(path(std::string(pose.Name) + ".png"), result.Width, result.Height, result.Pixels))
+                failure = "can't write the reference";
+        }
+        else
+        {
+            stbi_set_flip_vertically_on_load_thread(true);  // Bottom-up, like the frames
+            int width, height, nrChannels;
+            std::string referencePath = path(std::string(pose.Name) + ".png");
+            unsigned char* reference = stbi_load(referencePath.c_str(), &width, &height, &nrChannels, 4);
+            if (!reference)
+                failure = "no reference image";
+            else if (width != result.Width || height != result.Height)
+                failure = "reference is " + std::to_string(width) + "x" + std::to_string(height);
+            else
+            {
+                differentPixels = (long)countDifferentPixels(result.Pixels, std::vector<unsigned char>(reference, reference + (size_t)width * height * 4));
+                if (differentPixels > REGRESSION_MAX_DIFF_FRACTION * width * height)
+                    failure = "image differs";
+            }
+            stbi_image_free(reference);
+            if (!failure.empty())
+                writePng(path(std::string(pose.Name) + "_actual.png"), result.Width, result.Height, result.Pixels);
+        }
+
+        // PERFORMANCE AGAINST THE BASELINE
+        auto recorded = baseline.find(pose.Name);
+        if (!update && recorded != baseline.end())
+        {
+            if (recorded->second.MedianMs > 0.0 && median > recorded->second.MedianMs * (1.0 + thresholdPercent / 100.0))
+                failure += std::string(failure.empty() ? "" : ", ") + "slower";
+            if (result.DrawCalls > recorded->second.DrawCalls)
+                failure += std::string(failure.empty() ? "" : ", ") + "more draw calls";
+        }
+        else if (!update && !baseline.empty())
+            failure += std::string(failure.empty() ? "" : ", ") + "not in the baseline";
+        passed = passed && failure.empty();
+
+        printf("  %-10s p50 %8.3f ms", pose.Name, median);
+        if (recorded != baseline.end() && recorded->second.MedianMs > 0.0)
+            printf(" (baseline %8.3f, %+6.1f%%)", recorded->second.MedianMs, (median / recorded->second.MedianMs - 1.0) * 100.0);
+        printf("  draw calls %d", result.DrawCalls);
+        if (differentPixels >= 0)
+            printf("  %ld pixels differ", differentPixels);
+        printf("  %s\n", failure.empty() ? "OK" : ("FAILED: " + failure).c_str());
+
+        char entry[512];
+        snprintf(entry, sizeof(entry), "    {\"name\": \"%s\", \"mean_ms\": %.4f, \"p50_ms\": %.4f, \"p95_ms\": %.4f, \"draw_calls\": %d, \"different_pixels\": %ld, \"passed\": %s}%s\n",
+                 pose.Name, mean, median, p95, result.DrawCalls, differentPixels, failure.empty() ? "true" : "false", i + 1 < Poses.size() ? "," : "");
+        json += entry;
+    }
+    json += "  ],\n  \"passed\": " + std::string(passed ? "true" : "false") + "\n}\n";
+
+    for (const std::string& name : update ? std::vector<std::string>{"results.json", "baseline.json"} : std::vector<std::string>{"results.json"})
+    {
+        FILE* file = fopen(path(name).c_str(), "w");
+        if (!file)
+        {
+            std::cout << "ERROR::REGRESSION::CANT_WRITE " << path(name) << std::endl;
+            passed = false;
+            continue;
+        }
+        fputs(json.c_str(), file);
+        fclose(file);
+    }
+    std::cout << (passed ? "regression: passed" : "regression: FAILED") << std::endl;
+    return passed;
+}
+
+// PNG WRITER: STORED (UNCOMPRESSED) DEFLATE BLOCKS, WHICH NEED NO COMPRESSOR, ONLY THE CHECKSUMS
+// ----------------------------------------------------------------------------------------------
+static uint32_t crc32(const unsigned char* data, size_t size, uint32_t crc = 0)
+{
+    static uint32_t table[256];
+    static bool tableReady = false;
+    if (!tableReady)
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int bit = 0; bit < 8; bit++)
+                c = c & 1 ? 0xedb88320u ^ (c >> 1) : c >> 1;
+            table[i] = c;
+        }
+        tableReady = true;
+    }
+    crc = ~crc;
+    for (size_t i = 0; i < size; i++)
+        crc = table[(crc ^ data[i]) & 0xff] ^ (crc >> 8);
+    return ~crc;
+}
+
+static void appendBigEndian(std::vector<unsigned char>& out, uint32_t value)
+{
+    for (int shift = 24; shift >= 0; shift -= 8)
+        out.push_back((value >> shift) & 0xff);
+}
+
+static void appendChunk(std::vector<unsigned char>& out, const char* type, const std::vector<unsigned char>& data)
+{
+    appendBigEndian(out, (uint32_t)data.size());
+    size_t start = out.size();
+    out.insert(out.end(), type, type + 4);
+    out.insert(out.end(), data.begin(), data.end());
+    appendBigEndian(out, crc32(&out[start], out.size() - start));
+}
+
+bool writePng(const std::string& path, int width, int height, const std::vector<unsigned char>& pixels)
+{
+    if (width <= 0 || height <= 0 || pixels.size() < (size_t)width * height * 4) return false;
+
+    // Rows top-down, each after a filter type byte (0, none)
+    std::vector<unsigned char> raw;
+    raw.reserve(((size_t)width * 4 + 1) * height);
+    for (int y = height - 1; y >= 0; y--)
+    {
+        raw.push_back(0);
+        raw.insert(raw.end(), pixels.begin() + (size_t)y * width * 4, pixels.begin() + (size_t)(y + 1) * width * 4);
+    }
+
+    // ZLIB STREAM OF STORED BLOCKS (AT MOST 65535 BYTES EACH) + ADLER-32
+    std::vector<unsigned char> zlib = {0x78, 0x01};
+    for (size_t offset = 0; offset < raw.size() || offset == 0; offset += 65535)
+    {
+        size_t size = std::min((size_t)65535, raw.size() - offset);
+        zlib.push_back(offset + size >= raw.size() ? 1 : 0);    // BFINAL on the last one
+        zlib.push_back(size & 0xff);
+        zlib.push_back((size >> 8) & 0xff);
+        zlib.push_back(~size & 0xff);
+        zlib.push_back((~size >> 8) & 0xff);
+        zlib.insert(zlib.end(), raw.begin() + offset, raw.begin() + offset + size);
+    }
+    uint32_t a = 1, b = 0;
+    for (unsigned char byte : raw)
+    {
+        a = (a + byte) % 65521;
+        b = (b + a) % 65521;
+    }
+    appendBigEndian(zlib, (b << 16) | a);
+
+    std::vector<unsigned char> header;
+    appendBigEndian(header, (uint32_t)width);
+    appendBigEndian(header, (uint32_t)height);
+    header.insert(header.end(), {8, 6, 0, 0, 0});   // 8 bit RGBA, deflate, no filter method, not interlaced
+
+    std::vector<unsigned char> png = {0x89, 'P', 'N', 'G', '\r', '\n', 0x1a, '\n'};
+    appendChunk(png, "IHDR", header);
+    appendChunk(png, "IDAT", zlib);
+    appendChunk(png, "IEND", std::vector<unsigned char>());
+
+    FILE* file = fopen(path.c_str(), "wb");
+    if (!file) return false;
+    bool written = fwrite(png.data(), 1, png.size(), file) == png.size();
+    return fclose(file) == 0 && written;
+}
@@ -0,0 +1,174 @@
+#include "renderqueue.h"
+#include "glstate.h"
+#include <glm/gtc/type_ptr.hpp>
+#include <algorithm>
+
+// KEYS
+// ----
+uint64_t RenderQueue::makeKey(unsigned pass, bool transparent, unsigned program, unsigned material, unsigned mesh, float depth01)
+{
+    uint64_t depth = (uint64_t)(std::min(std::max(depth01, 0.0f), 1.0f) * 0xFFFFFF);
+    uint64_t key = (uint64_t)(pass & 0xF) << 60;
+    if (!transparent)
+        return key | (uint64_t)(program & 0xFF) << 51 | (uint64_t)(material & 0xFFFF) << 35 | (uint64_t)(mesh & 0x7FF) << 24 | depth;
+    return key | 1ULL << 59 | (0xFFFFFF - depth) << 35 | (uint64_t)(program & 0xFF) << 27 | (uint64_t)(material & 0xFFFF) << 11 | (mesh & 0x7FF);
+}
+
+template <typename Key>
+unsigned RenderQueue::idFor(std::map<Key, unsigned>& ids, const Key& key)
+{
+    auto found = ids.find(key);
+    if (found != ids.end()) return found->second;
+    unsigned id = (unsigned)ids.size();
+    ids[key] = id;
+    return id;
+}
+
+// SUBMISSION
+// ----------
+void RenderQueue::begin(const glm::mat4& viewMatrix, float far)
+{
+    view = viewMatrix;
+    farPlane = far;
+    packets.clear();
+    entries.clear();
+}
+
+void RenderQueue::submit(const DrawPacket& packet)
+{
+    // View space distance of the model's origin (instanced draws & batches have no single position, they sort as near)
+    float depth = 0.0f;
+    if (packet.Instances == 0 && !packet.Batch)
+        depth = -(view * packet.Model[3]).z / farPlane;
+    unsigned program = idFor(programIds, (const Shader*)packet.Program);
+    unsigned material = idFor(materialIds, std::make_pair(packet.Texture, packet.Material));
+    unsigned mesh = idFor(meshIds, std::make_pair(packet.Pool, packet.Mesh.baseVertex));
+    entries.push_back({makeKey(packet.Pass, packet.Transparent, program, material, mesh, depth), (uint32_t)packets.size()});
+    packets.push_back(packet);
+}
+
+// SORTING
+// -------
+void RenderQueue::radixSort()
+{
+    // ONE HISTOGRAM PASS FOR ALL 8 DIGITS, THEN A SCATTER PER DIGIT THAT ISN'T THE SAME FOR EVERY KEY
+    // -----------------------------------------------------------------------------------------------
+    size_t counts[8][256] = {};
+    for (const SortEntry& entry : entries)
+        for (int digit = 0; digit < 8; digit++)
+            counts[digit][(entry.key >> (digit * 8)) & 0xFF]++;
+
+    scratch.resize(entries.size());
+    for (int digit = 0; digit < 8; digit++)
+    {
+        size_t* count = counts[digit];
+        if (count[(entries[0].key >> (digit * 8)) & 0xFF] == entries.size())
+            continue;   // Every key has the same byte here, this pass wouldn't move anything
+        size_t offsets[256];
+        size_t offset = 0;
+        for (int bucket = 0; bucket < 256; bucket++)
+        {
+            offsets[bucket] = offset;
+            offset += count[bucket];
+        }
+        for (const SortEntry& entry : entries)
+            scratch[offsets[(entry.key >> (digit * 8)) & 0xFF]++] = entry;
+        entries.swap(scratch);
+    }
+}
+
+const RenderQueue::ProgramUniforms& RenderQueue::uniformsFor(const Shader* program)
+{
+    ProgramUniforms& cached = uniforms[program];
+    if (cached.id != program->ID)
+    {
+        cached.id = program->ID;
+        cached.model = cached.material = -1;
+        for (const UniformInfo& info : program->Uniforms)
+        {
+            if (info.name == "model") cached.model = info.location;
+            else if (info.name == "material") cached.material = info.location;
+        }
+    }
+    return cached;
+}
+
+// EXECUTION
+// ---------
+void RenderQueue::execute()
+{
+    Stats = RenderQueueStats();
+    if (!entries.empty())
+        radixSort();
+
+    // Redundant binds are dropped by GLState, which also knows what was left bound by whatever ran before. The program is
+    // still followed here for its uniform locations
+    const Shader* program = NULL;
+    unsigned programId = 0;
+    const ProgramUniforms* locations = NULL;
+    const char* timing = NULL;
+    for (const SortEntry& entry : entries)
+    {
+        const DrawPacket& packet = packets[entry.index];
+        // Sorted by state, not by pass, so one pass can be begun more than once a frame (the timer adds them up)
+        if (Timer && packet.Timing != timing)
+        {
+            if (timing) Timer->endPass();
+            timing = packet.Timing;
+            if (timing) Timer->beginPass(timing);
+        }
+        if (packet.Program != program || packet.Program->ID != programId)
+        {
+            program = packet.Program;
+            programId = program->ID;
+            locations = &uniformsFor(program);
+        }
+        if (GLState.useProgram(programId))
+            Stats.ProgramSwitches++;
+        if (packet.Texture && GLState.bindTexture(0, GL_TEXTURE_2D, packet.Texture))
+            Stats.TextureSwitches++;
+        if (GLState.bindVertexArray(packet.Batch ? packet.Batch->vertexArray() : packet.Pool->VAO))
+            Stats.VaoSwitches++;
+        // Transparent draws blend over what's behind them without hiding what comes after
+        GLState.enable(GL_BLEND, packet.Transparent);
+        GLState.depthMask(!packet.Transparent);
+        if (packet.Transparent)
+            GLState.blendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+        if (packet.Batch)
+        {
+            Stats.Draws += packet.Batch->draw();    // Per-draw model & material come from the batch's records
+            continue;
+        }
+        if (packet.Instances > 0)
+        {
+            if (locations->material >= 0 && packet.Material >= 0)
+            {
+                glUniform1i(locations->material, packet.Material);
+                Stats.UniformUploads++;
+            }
+            packet.Pool->drawInstanced(packet.Mesh, packet.Instances);
+        }
+        else
+        {
+            if (locations->model >= 0)
+            {
+                glUniformMatrix4fv(locations->model, 1, GL_FALSE, glm::value_ptr(packet.Model));
+                Stats.UniformUploads++;
+            }
+            if (locations->material >= 0 && packet.Material >= 0)
+            {
+                glUniform1i(locations->material, packet.Material);
+                Stats.UniformUploads++;
+            }
+            packet.Pool->draw(packet.Mesh);
+        }
+        Stats.Draws++;
+    }
+    if (Timer && timing)
+        Timer->endPass();
+    // glClear obeys the depth mask, leave it writable for the next frame
+    GLState.depthMask(true);
+    GLState.enable(GL_BLEND, false);
+    entries.clear();
+}
@@ -0,0 +1,132 @@
+#include "ringbuffer.h"
+#include "glfeatures.h"
+#include "glstate.h"
+#include <iostream>
+#include <cstdio>
+#include <chrono>
+#include <algorithm>
+
+RingBuffer::RingBuffer(size_t regionBytes, int regions, bool allowPersistent)
+    : regionSize(regionBytes), fences(std::max(regions, 1), (GLsync)0)
+{
+    Persistent = allowPersistent && GLExt.BufferStorageSupported;
+    size_t totalBytes = regionSize * fences.size();
+    glGenBuffers(1, &Buffer);
+    GLState.bindBuffer(GL_COPY_WRITE_BUFFER, Buffer);  // No target it's drawn from, so nothing else is disturbed
+    if (Persistent)
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        GLExt.BufferStorage(GL_COPY_WRITE_BUFFER, totalBytes, NULL, flags);
+        mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, 0, totalBytes, flags);
+        if (!mapped)
+        {
+            std::cout << "WARNING::RINGBUFFER::PERSISTENT_MAP_FAILED falling back to mapping every frame" << std::endl;
+            Persistent = false;
+            GLState.deleteBuffers(1, &Buffer);     // Immutable storage can't be re-specified, start over with a new buffer
+            glGenBuffers(1, &Buffer);
+            GLState.bindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+        }
+    }
+    if (!Persistent)
+        glBufferData(GL_COPY_WRITE_BUFFER, totalBytes, NULL, GL_STREAM_DRAW);
+    GLState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+RingBuffer::~RingBuffer()
+{
+    for (GLsync fence : fences)
+        if (fence) glDeleteSync(fence);
+    if (mapped)
+    {
+        GLState.bindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+        glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+        GLState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    }
+    GLState.deleteBuffers(1, &Buffer);
+}
+
+void RingBuffer::beginFrame()
+{
+    region = (region + 1) % (int)fences.size();
+    used = 0;
+    Stats.Frames++;
+
+    // WAIT UNTIL THE GPU IS DONE WITH THE FRAME THAT LAST WROTE THIS REGION
+    // ---------------------------------------------------------------------
+    GLsync& fence = fences[region];
+    if (!fence) return;
+    GLenum status = glClientWaitSync(fence, 0, 0);
+    if (status == GL_TIMEOUT_EXPIRED)
+    {
+        auto waitStart = std::chrono::steady_clock::now();
+        // Flush once so the fence itself is guaranteed to reach the GPU, otherwise this could wait forever
+        GLbitfield flags = GL_SYNC_FLUSH_COMMANDS_BIT;
+        do
+        {
+            status = glClientWaitSync(fence, flags, 1000000);  // 1 ms per try
+            flags = 0;
+        } while (status == GL_TIMEOUT_EXPIRED);
+        std::chrono::duration<double, std::milli> waited = std::chrono::steady_clock::now() - waitStart;
+        Stats.Waits++;
+        Stats.WaitMs += waited.count();
+        Stats.MaxWaitMs = std::max(Stats.MaxWaitMs, waited.count());
+    }
+    if (status == GL_WAIT_FAILED)
+        std::cout << "ERROR::RINGBUFFER::FENCE_WAIT_FAILED" << std::endl;
+    glDeleteSync(fence);
+    fence = 0;
+}
+
+void* RingBuffer::allocate(size_t bytes, size_t alignment, size_t& offset)
+{
+    size_t start = (used + alignment - 1) / alignment * alignment;
+    if (region < 0 || start + bytes > regionSize)
+    {
+        Stats.Overflows++;
+        return NULL;
+    }
+    if (!mapped)
+    {
+        // Unsynchronized: the fence waited on in beginFrame() already guarantees the GPU is done with this region. Only the
+        // rest of the region is mapped (and invalidated), what was written & flushed before in this frame stays
+        mappedStart = start;
+        GLState.bindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+        mapped = (unsigned char*)glMapBufferRange(GL_COPY_WRITE_BUFFER, region * regionSize + start, regionSize - start,
+                                                  GL_MAP_WRITE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_INVALIDATE_RANGE_BIT);
+        GLState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+        if (!mapped)
+        {
+            Stats.Overflows++;
+            return NULL;
+        }
+    }
+    used = start + bytes;
+    Stats.Allocations++;
+    Stats.Bytes += bytes;
+    offset = region * regionSize + start;
+    return mapped + (Persistent ? offset : start - mappedStart);
+}
+
+void RingBuffer::flush()
+{
+    // Coherent persistent writes are visible to the GPU without anything else, a regular mapping has to be let go first
+    if (Persistent || !mapped) return;
+    GLState.bindBuffer(GL_COPY_WRITE_BUFFER, Buffer);
+    glUnmapBuffer(GL_COPY_WRITE_BUFFER);
+    GLState.bindBuffer(GL_COPY_WRITE_BUFFER, 0);
+    mapped = NULL;
+}
+
+void RingBuffer::endFrame()
+{
+    if (region < 0) return;
+    flush();    // In case nothing read the data this frame
+    fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+}
+
+void RingBuffer::report() const
+{
+    printf("ring buffer: %s, %d x %zu KB, fence waits in %zu of %zu frames (%.3f ms total, %.3f ms max), %zu overflows\n",
+           Persistent ? "persistent" : "mapped per frame", regionCount(), regionSize / 1024, Stats.Waits, Stats.Frames,
+           Stats.WaitMs, Stats.MaxWaitMs, Stats.Overflows);
+}
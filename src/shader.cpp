@@ -1,10 +1,36 @@
 #include "shader.h"
+#include "glstate.h"
+#include "glfeatures.h"
+#include "assetpack.h"
+#include "profiler.h"
+#include <chrono>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
 
-Shader::Shader(const char* vertexPath, const char* fragmentPath)
+unsigned long Shader::StringLookups = 0;
+std::string Shader::CacheDirectory = "shadercache";
+std::vector<std::pair<std::string, unsigned>> Shader::blockBindings;
+
+// 64-bit FNV-1a, chained through 'hash' so several strings can make up one key
+static unsigned long long hashString(const char* str, size_t length, unsigned long long hash = 14695981039346656037ULL)
+{
+    for (size_t i = 0; i < length; i++)
+    {
+        hash ^= (unsigned char)str[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
+
+static unsigned long long hashCString(const char* str, unsigned long long hash)
+{
+    return hashString(str, strlen(str), hash);
+}
+
+// Reads both source files, returns false (with the strings left empty) if either can't be read
+static bool readSources(const std::string &vertexPath, const std::string &fragmentPath, std::string &vertexCode, std::string &fragmentCode)
 {
-    // 1. retrieve the vertex/fragment source code from filePath
-    std::string vertexCode;
-    std::string fragmentCode;
     std::ifstream vShaderFile;
     std::ifstream fShaderFile;
     // ensure ifstream objects can throw exceptions:
@@ -29,19 +55,112 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
     catch(const std::ifstream::failure& e)
     {
         std::cout << "ERROR::SHADER::FILE_NOT_SUCCESFULLY_READ" << std::endl;
+        return false;
     }
-    const char* vShaderCode = vertexCode.c_str();
-    const char* fShaderCode = fragmentCode.c_str();
-    
-    // 2. compile shaders
+    return true;
+}
+
+Shader::Shader(const char* vertexPath, const char* fragmentPath) : VertexPath(vertexPath), FragmentPath(fragmentPath)
+{
+    PROFILE_SCOPE("Shader::Shader");
+    // 1. retrieve the vertex/fragment source code from filePath
+    std::string vertexCode;
+    std::string fragmentCode;
+    readSources(VertexPath, FragmentPath, vertexCode, fragmentCode);
+    build(vertexCode.c_str(), vertexCode.size(), fragmentCode.c_str(), fragmentCode.size());
+}
+
+Shader::Shader(const AssetPack& pack, const char* vertexName, const char* fragmentName)
+    : VertexPath(pack.Path + "#" + vertexName), FragmentPath(pack.Path + "#" + fragmentName), fromPack(true)
+{
+    PROFILE_SCOPE("Shader::Shader (pack)");
+    // 1. the sources are read by GL straight out of the mapped pack, no copy
+    const AssetEntry* vertex = pack.find(vertexName);
+    const AssetEntry* fragment = pack.find(fragmentName);
+    bool vertexFound = vertex && vertex->Type == ASSET_SHADER;
+    bool fragmentFound = fragment && fragment->Type == ASSET_SHADER;
+    if (!vertexFound)
+        std::cout << "ERROR::SHADER::" << (vertex ? "NOT_A_SHADER_IN_PACK " : "NOT_IN_PACK ") << VertexPath << std::endl;
+    if (!fragmentFound)
+        std::cout << "ERROR::SHADER::" << (fragment ? "NOT_A_SHADER_IN_PACK " : "NOT_IN_PACK ") << FragmentPath << std::endl;
+    if (!vertexFound || !fragmentFound)
+    {
+        ID = 0;
+        return;
+    }
+    build((const char*)pack.data(*vertex), (size_t)vertex->Size, (const char*)pack.data(*fragment), (size_t)fragment->Size);
+}
+
+void Shader::build(const char* vertexCode, size_t vertexLength, const char* fragmentCode, size_t fragmentLength)
+{
+    // 2. try the program binary cache, keyed on both sources and the driver that produced the binary
+    auto start = std::chrono::steady_clock::now();
+    std::string cachePath = binaryCachePath(vertexCode, vertexLength, fragmentCode, fragmentLength);
+    bool cacheHit = !cachePath.empty() && loadBinary(cachePath);
+
+    // 3. compile shaders from source on a miss (or if the driver rejected the cached binary)
+    if (!cacheHit && buildFromSource(vertexCode, vertexLength, fragmentCode, fragmentLength) && !cachePath.empty())
+        saveBinary(cachePath);
+
+    std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+    std::cout << "SHADER::" << (cachePath.empty() ? "CACHE_DISABLED" : cacheHit ? "CACHE_HIT" : "CACHE_MISS")
+              << " " << VertexPath << " + " << FragmentPath << " (" << buildTime.count() << " ms)" << std::endl;
+
+    reflectUniforms();
+}
+
+std::string Shader::binaryCachePath(const char* vertexCode, size_t vertexLength, const char* fragmentCode, size_t fragmentLength) const
+{
+    if (CacheDirectory.empty() || !GLExt.ProgramBinarySupported)
+        return "";
+    unsigned long long key = hashString(vertexCode, vertexLength);
+    key = hashString(fragmentCode, fragmentLength, key);
+    key = hashCString((const char*)glGetString(GL_VENDOR), key);
+    key = hashCString((const char*)glGetString(GL_RENDERER), key);
+    key = hashCString((const char*)glGetString(GL_VERSION), key);
+    std::stringstream pathStream;
+    pathStream << CacheDirectory << "/" << std::hex << std::setw(16) << std::setfill('0') << key << ".bin";
+    return pathStream.str();
+}
+
+bool Shader::buildFromSource(const char* vShaderCode, size_t vLength, const char* fShaderCode, size_t fLength)
+{
     unsigned int vertex, fragment;
-    int success;
-    char infoLog[512];
-    
+    ID = startBuild(vShaderCode, vLength, fShaderCode, fLength, vertex, fragment);
+    return finishBuild(ID, vertex, fragment);
+}
+
+unsigned Shader::startBuild(const char* vShaderCode, size_t vLength, const char* fShaderCode, size_t fLength, unsigned &vertex, unsigned &fragment)
+{
+    // Only issues the compile & link commands, statuses are queried in finishBuild() so a driver with
+    // GL_KHR_parallel_shader_compile can do the work on its own threads in the meantime
+
     // vertex Shader
     vertex = glCreateShader(GL_VERTEX_SHADER);
-    glShaderSource(vertex, 1, &vShaderCode, NULL);
+    GLint vertexLength = (GLint)vLength, fragmentLength = (GLint)fLength;   // Explicit lengths, sources needn't be NUL terminated
+    glShaderSource(vertex, 1, &vShaderCode, &vertexLength);
     glCompileShader(vertex);
+    
+    // similiar for Fragment Shader
+    fragment = glCreateShader(GL_FRAGMENT_SHADER);
+    glShaderSource(fragment, 1, &fShaderCode, &fragmentLength);
+    glCompileShader(fragment);
+    
+    // shader Program
+    unsigned program = glCreateProgram();
+    if (GLExt.ProgramBinarySupported)
+        GLExt.ProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);   // Lets the driver keep the binary around for saveBinary()
+    glAttachShader(program, vertex);
+    glAttachShader(program, fragment);
+    glLinkProgram(program);
+    return program;
+}
+
+bool Shader::finishBuild(unsigned program, unsigned vertex, unsigned fragment)
+{
+    int success;
+    char infoLog[512];
+
     // print compile errors if any
     glGetShaderiv(vertex, GL_COMPILE_STATUS, &success);
     if(!success)
@@ -49,11 +168,6 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
         glGetShaderInfoLog(vertex, 512, NULL, infoLog);
         std::cout << "ERROR::SHADER::VERTEX::COMPILATION_FAILED\n" << infoLog << std::endl;
     };
-    
-    // similiar for Fragment Shader
-    fragment = glCreateShader(GL_FRAGMENT_SHADER);
-    glShaderSource(fragment, 1, &fShaderCode, NULL);
-    glCompileShader(fragment);
     // Check for succesful compilation of this shader
     glGetShaderiv(fragment, GL_COMPILE_STATUS, &success);   // Queries shader for some target info, in this case if it was successful
     if(!success)
@@ -62,47 +176,234 @@ Shader::Shader(const char* vertexPath, const char* fragmentPath)
         std::cout << "ERROR::SHADER::FRAGMENT::COMPILATION_FAILED\n" << infoLog << std::endl;
     }
     
-    // shader Program
-    ID = glCreateProgram();
-    glAttachShader(ID, vertex);
-    glAttachShader(ID, fragment);
-    glLinkProgram(ID);
     // print linking errors if any
-    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    glGetProgramiv(program, GL_LINK_STATUS, &success);
     if(!success)
     {
-        glGetProgramInfoLog(ID, 512, NULL, infoLog);
+        glGetProgramInfoLog(program, 512, NULL, infoLog);
         std::cout << "ERROR::SHADER::PROGRAM::LINKING_FAILED\n" << infoLog << std::endl;
     }
     
     // delete the shaders as they're linked into our program now and no longer necessary
     glDeleteShader(vertex);
     glDeleteShader(fragment);
+    return success;
+}
+
+void Shader::beginReload()
+{
+    if (pendingID)  // Already rebuilding, start again once that one lands so the latest edit wins
+    {
+        reloadQueued = true;
+        return;
+    }
+    std::string vertexCode;
+    std::string fragmentCode;
+    if (fromPack || !readSources(VertexPath, FragmentPath, vertexCode, fragmentCode)) return;    // Packs are read-only
+    pendingCachePath = binaryCachePath(vertexCode.c_str(), vertexCode.size(), fragmentCode.c_str(), fragmentCode.size());
+    pendingStart = std::chrono::steady_clock::now();
+    pendingID = startBuild(vertexCode.c_str(), vertexCode.size(), fragmentCode.c_str(), fragmentCode.size(), pendingVertex, pendingFragment);
+}
+
+bool Shader::pollReload()
+{
+    if (!pendingID) return false;
+    if (GLExt.ParallelShaderCompile)
+    {
+        int done = GL_FALSE;
+        glGetProgramiv(pendingID, GL_COMPLETION_STATUS_KHR, &done);
+        if (!done) return false;    // Keep rendering with the old program
+    }
+
+    unsigned newID = pendingID;
+    pendingID = 0;
+    bool linked = finishBuild(newID, pendingVertex, pendingFragment);
+    // Of the sources newID was built from: a queued reload replaces the pending ones with the newer sources'
+    std::string cachePath = pendingCachePath;
+    auto start = pendingStart;
+    if (reloadQueued)
+    {
+        reloadQueued = false;
+        beginReload();
+    }
+    if (!linked)
+    {
+        GLState.deleteProgram(newID);     // Broken edit, old program stays bound
+        return false;
+    }
+
+    // Swap between frames: the old program is no longer referenced by anything in flight on the CPU side
+    GLState.deleteProgram(ID);
+    ID = newID;
+    reflectUniforms();
+    if (!cachePath.empty())
+        saveBinary(cachePath);
+
+    std::chrono::duration<double, std::milli> buildTime = std::chrono::steady_clock::now() - start;
+    std::cout << "SHADER::RELOADED " << VertexPath << " + " << FragmentPath << " (" << buildTime.count() << " ms)" << std::endl;
+    return true;
+}
+
+// Cache file layout: BinaryCacheHeader followed by 'length' bytes of driver specific program binary
+struct BinaryCacheHeader
+{
+    char magic[4];
+    GLenum format;
+    GLint length;
+};
+static const char BINARY_CACHE_MAGIC[4] = {'G', 'L', 'P', 'B'};
+
+bool Shader::loadBinary(const std::string &cachePath)
+{
+    std::ifstream file(cachePath, std::ios::binary);
+    BinaryCacheHeader header;
+    if (!file.read((char*)&header, sizeof(header)) || memcmp(header.magic, BINARY_CACHE_MAGIC, 4) != 0 || header.length <= 0)
+        return false;
+    std::vector<char> binary(header.length);
+    if (!file.read(binary.data(), header.length))
+        return false;
+
+    ID = glCreateProgram();
+    GLExt.ProgramBinary(ID, header.format, binary.data(), header.length);
+    int success;
+    glGetProgramiv(ID, GL_LINK_STATUS, &success);
+    if (!success)   // Driver updated or otherwise incompatible binary, caller falls back to compiling (and overwrites the entry)
+    {
+        GLState.deleteProgram(ID);
+        ID = 0;
+        return false;
+    }
+    return true;
+}
+
+void Shader::saveBinary(const std::string &cachePath) const
+{
+    BinaryCacheHeader header;
+    memcpy(header.magic, BINARY_CACHE_MAGIC, 4);
+    glGetProgramiv(ID, GL_PROGRAM_BINARY_LENGTH, &header.length);
+    if (header.length <= 0) return;
+    std::vector<char> binary(header.length);
+    GLExt.GetProgramBinary(ID, header.length, NULL, &header.format, binary.data());
+
+    std::error_code error;
+    std::filesystem::create_directories(CacheDirectory, error);
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    file.write((const char*)&header, sizeof(header));
+    file.write(binary.data(), header.length);
+    if (!file)
+        std::cout << "WARNING::SHADER::CACHE_WRITE_FAILED: " << cachePath << std::endl;
+}
+
+void Shader::setBlockBinding(const std::string &blockName, unsigned binding)
+{
+    for (auto& block : blockBindings)
+        if (block.first == blockName)
+        {
+            block.second = binding;
+            return;
+        }
+    blockBindings.push_back({blockName, binding});
+}
+
+void Shader::reflectUniforms()
+{
+    // GLSL 330 can't declare a block's binding itself, so it is set here after every link
+    for (const auto& block : blockBindings)
+    {
+        unsigned index = glGetUniformBlockIndex(ID, block.first.c_str());
+        if (index != GL_INVALID_INDEX)
+            glUniformBlockBinding(ID, index, block.second);
+    }
+
+    Uniforms.clear();
+    int count = 0, maxNameLength = 0;
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORMS, &count);
+    glGetProgramiv(ID, GL_ACTIVE_UNIFORM_MAX_LENGTH, &maxNameLength);
+    std::vector<char> nameBuffer(maxNameLength > 0 ? maxNameLength : 1);
+
+    for (int i = 0; i < count; i++)
+    {
+        UniformInfo info;
+        GLsizei length = 0;
+        glGetActiveUniform(ID, i, (GLsizei)nameBuffer.size(), &length, &info.size, &info.type, nameBuffer.data());
+        info.name.assign(nameBuffer.data(), length);
+        // Arrays are reported as "name[0]", store them under the name used when setting them
+        if (info.name.size() > 3 && info.name.compare(info.name.size() - 3, 3, "[0]") == 0)
+            info.name.resize(info.name.size() - 3);
+        info.location = glGetUniformLocation(ID, nameBuffer.data());
+        if (info.location < 0) continue;    // Uniforms inside blocks have no location
+        Uniforms.push_back(info);
+    }
+}
+
+GLint Shader::lookupLocation(const std::string &name) const
+{
+    // Linear scan is fine, programs only have a handful of active uniforms
+    for (const UniformInfo& info : Uniforms)
+        if (info.name == name)
+            return info.location;
+    return -1;
+}
+
+UniformHandle Shader::uniform(const std::string &name) const
+{
+    UniformHandle handle;
+    handle.location = lookupLocation(name);
+    if (!handle.valid())
+        std::cout << "WARNING::SHADER::UNIFORM_NOT_ACTIVE: " << name << std::endl;
+    return handle;
 }
 
 Shader::~Shader()
 {
-    glDeleteProgram(ID);
+    if (pendingID)
+    {
+        glDeleteShader(pendingVertex);
+        glDeleteShader(pendingFragment);
+        GLState.deleteProgram(pendingID);
+    }
+    GLState.deleteProgram(ID);
 }
 
 void Shader::use()
 {
-    glUseProgram(ID);
+    GLState.useProgram(ID);
 }
 
 void Shader::setBool(const std::string &name, bool value) const
 {         
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), (int)value); 
+    StringLookups++;
+    glUniform1i(lookupLocation(name), (int)value); 
 }
 void Shader::setInt(const std::string &name, int value) const
 { 
-    glUniform1i(glGetUniformLocation(ID, name.c_str()), value); 
+    StringLookups++;
+    glUniform1i(lookupLocation(name), value); 
 }
 void Shader::setFloat(const std::string &name, float value) const
 { 
-    glUniform1f(glGetUniformLocation(ID, name.c_str()), value); 
+    StringLookups++;
+    glUniform1f(lookupLocation(name), value); 
 }
 void Shader::setMat4(const std::string &name, bool transpose, const GLfloat* value) const
 {
-    glUniformMatrix4fv(glGetUniformLocation(ID, name.c_str()), 1, transpose, value);
+    StringLookups++;
+    glUniformMatrix4fv(lookupLocation(name), 1, transpose, value);
+}
+
+void Shader::setBool(UniformHandle handle, bool value) const
+{
+    glUniform1i(handle.location, (int)value);
+}
+void Shader::setInt(UniformHandle handle, int value) const
+{
+    glUniform1i(handle.location, value);
+}
+void Shader::setFloat(UniformHandle handle, float value) const
+{
+    glUniform1f(handle.location, value);
+}
+void Shader::setMat4(UniformHandle handle, bool transpose, const GLfloat* value) const
+{
+    glUniformMatrix4fv(handle.location, 1, transpose, value);
 }
\ No newline at end of file
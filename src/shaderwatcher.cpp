@@ -0,0 +1,127 @@
+#include "shaderwatcher.h"
+#include <algorithm>
+
+#ifdef __linux__
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <climits>
+#endif
+
+namespace fs = std::filesystem;
+
+ShaderWatcher::ShaderWatcher()
+{
+#ifdef __linux__
+    inotifyFD = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);    // Non-blocking so update() can drain it every frame for free
+    if (inotifyFD < 0)
+        std::cout << "WARNING::SHADERWATCHER::INOTIFY_UNAVAILABLE, polling instead" << std::endl;
+#endif
+    lastPoll = std::chrono::steady_clock::now();
+}
+
+ShaderWatcher::~ShaderWatcher()
+{
+#ifdef __linux__
+    if (inotifyFD >= 0)
+        close(inotifyFD);
+#endif
+}
+
+void ShaderWatcher::add(Shader* shader)
+{
+    if (std::find(shaders.begin(), shaders.end(), shader) != shaders.end()) return;
+    shaders.push_back(shader);
+    watchFile(shader->VertexPath, shader);
+    watchFile(shader->FragmentPath, shader);
+}
+
+void ShaderWatcher::remove(Shader* shader)
+{
+    shaders.erase(std::remove(shaders.begin(), shaders.end(), shader), shaders.end());
+    files.erase(std::remove_if(files.begin(), files.end(), [shader](const WatchedFile& file) { return file.shader == shader; }), files.end());
+}
+
+void ShaderWatcher::watchFile(const std::string& path, Shader* shader)
+{
+    WatchedFile file;
+    file.path = fs::path(path).lexically_normal().string();
+    file.shader = shader;
+    std::error_code error;
+    file.lastWrite = fs::last_write_time(file.path, error);
+    files.push_back(file);
+
+#ifdef __linux__
+    // Watch the directory rather than the file: editors often save by writing a new file and renaming it over the old one
+    if (inotifyFD < 0) return;
+    std::string dir = fs::path(file.path).parent_path().string();
+    if (dir.empty()) dir = ".";
+    for (const auto& watched : watchedDirs)
+        if (watched.second == dir) return;
+    int wd = inotify_add_watch(inotifyFD, dir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (wd >= 0)
+        watchedDirs.push_back({wd, dir});
+#endif
+}
+
+void ShaderWatcher::collectChanged(std::vector<Shader*>& changed)
+{
+    auto markChanged = [&changed](Shader* shader) {
+        if (std::find(changed.begin(), changed.end(), shader) == changed.end())
+            changed.push_back(shader);
+    };
+
+#ifdef __linux__
+    if (inotifyFD >= 0)
+    {
+        alignas(inotify_event) char buffer[16 * (sizeof(inotify_event) + NAME_MAX + 1)];
+        ssize_t length;
+        while ((length = read(inotifyFD, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* ptr = buffer; ptr < buffer + length; )
+            {
+                const inotify_event* event = (const inotify_event*)ptr;
+                ptr += sizeof(inotify_event) + event->len;
+                if (event->len == 0) continue;
+                for (const auto& watched : watchedDirs)
+                {
+                    if (watched.first != event->wd) continue;
+                    std::string path = (fs::path(watched.second) / event->name).lexically_normal().string();
+                    for (const WatchedFile& file : files)
+                        if (file.path == path || (watched.second == "." && file.path == event->name))
+                            markChanged(file.shader);
+                }
+            }
+        }
+        return;
+    }
+#endif
+
+    // Polling fallback, throttled since it stats every file
+    auto now = std::chrono::steady_clock::now();
+    if (now - lastPoll < std::chrono::milliseconds(250)) return;
+    lastPoll = now;
+    for (WatchedFile& file : files)
+    {
+        std::error_code error;
+        fs::file_time_type lastWrite = fs::last_write_time(file.path, error);
+        if (!error && lastWrite != file.lastWrite)
+        {
+            file.lastWrite = lastWrite;
+            markChanged(file.shader);
+        }
+    }
+}
+
+std::vector<Shader*> ShaderWatcher::update()
+{
+    std::vector<Shader*> changed;
+    collectChanged(changed);
+    for (Shader* shader : changed)
+        shader->beginReload();
+
+    std::vector<Shader*> swapped;
+    for (Shader* shader : shaders)
+        if (shader->pollReload())
+            swapped.push_back(shader);
+    return swapped;
+}
@@ -0,0 +1,282 @@
+#include "softrast.h"
+#include "profiler.h"
+#include "stb_image.h"
+#include <cmath>
+#include <algorithm>
+#include <chrono>
+#include <iostream>
+
+bool loadSoftTexture(const char* path, SoftTexture& texture, const MipOptions& options)
+{
+    stbi_set_flip_vertically_on_load_thread(true);  // Bottom-up, like everything the texture loader uploads
+    int width, height, nrChannels;
+    unsigned char* pixels = stbi_load(path, &width, &height, &nrChannels, 4);
+    if (!pixels)
+    {
+        std::cout << "Failed to load texture: " << path << std::endl;
+        return false;
+    }
+    texture.Levels.clear();
+    texture.Levels.push_back({width, height, std::vector<unsigned char>(pixels, pixels + (size_t)width * height * 4)});
+    for (MipLevel& level : generateMipChain(pixels, width, height, 4, options))
+        texture.Levels.push_back(std::move(level));
+    stbi_image_free(pixels);
+    return true;
+}
+
+// TEXTURE SAMPLING, AS GL DEFINES IT FOR RGBA8
+// --------------------------------------------
+static int wrapTexel(int i, int size, bool repeat)
+{
+    if (repeat)
+        return ((i % size) + size) % size;
+    return std::min(std::max(i, 0), size - 1);
+}
+
+// GL_LINEAR: the 4 texels around (u, v), 0-255 per channel
+static glm::vec4 sampleBilinear(const MipLevel& level, bool repeat, float u, float v)
+{
+    float x = u * level.Width - 0.5f, y = v * level.Height - 0.5f;
+    float floorX = std::floor(x), floorY = std::floor(y);
+    float fx = x - floorX, fy = y - floorY;
+    int x0 = wrapTexel((int)floorX, level.Width, repeat), x1 = wrapTexel((int)floorX + 1, level.Width, repeat);
+    int y0 = wrapTexel((int)floorY, level.Height, repeat), y1 = wrapTexel((int)floorY + 1, level.Height, repeat);
+    const unsigned char* row0 = &level.Pixels[(size_t)y0 * level.Width * 4];
+    const unsigned char* row1 = &level.Pixels[(size_t)y1 * level.Width * 4];
+    glm::vec4 result;
+    for (int c = 0; c < 4; c++)
+    {
+        float bottom = row0[x0 * 4 + c] + (row0[x1 * 4 + c] - row0[x0 * 4 + c]) * fx;
+        float top = row1[x0 * 4 + c] + (row1[x1 * 4 + c] - row1[x0 * 4 + c]) * fx;
+        result[c] = bottom + (top - bottom) * fy;
+    }
+    return result;
+}
+
+SoftRasterizer::SoftRasterizer(int width, int height, WorkerPool* pool)
+    : Width(std::max(1, width)), Height(std::max(1, height)), stride((Width + 3) & ~3), tiles(Width, Height, pool)
+{
+    colour.resize((size_t)stride * Height);
+    depth.resize((size_t)stride * Height, 1.0f);
+    tileFragments.resize(tiles.count());
+}
+
+void SoftRasterizer::begin(const glm::mat4& view, const glm::mat4& projection, const glm::vec4& clearColour)
+{
+    viewProjection = projection * view;
+    glm::vec4 clamped = glm::clamp(clearColour, 0.0f, 1.0f) * 255.0f + 0.5f;
+    clearValue = (uint32_t)clamped.r | (uint32_t)clamped.g << 8 | (uint32_t)clamped.b << 16 | (uint32_t)clamped.a << 24;
+    triangles.clear();
+    shading.clear();
+    Stats = SoftRasterStats();
+}
+
+// GEOMETRY: VERTEX SHADER, CLIPPING & TRIANGLE SETUP
+// --------------------------------------------------
+void SoftRasterizer::draw(const MeshData& mesh, const glm::mat4& model, const SoftTexture* texture)
+{
+    auto start = std::chrono::steady_clock::now();
+    glm::mat4 toClip = viewProjection * model;      // gl_Position = projection * view * model * vec4(aPos, 1.0)
+    std::vector<ClipVertex> vertices(mesh.VertexCount());
+    for (size_t i = 0; i < vertices.size(); i++)
+    {
+        const float* vertex = &mesh.Vertices[i * mesh.FloatsPerVertex];
+        vertices[i].Position = toClip * glm::vec4(vertex[0], vertex[1], vertex[2], 1.0f);
+        vertices[i].UV = glm::vec2(vertex[3], vertex[4]);
+    }
+
+    for (size_t i = 0; i + 2 < mesh.Indices.size(); i += 3)
+    {
+        ClipVertex corners[3] = {vertices[mesh.Indices[i]], vertices[mesh.Indices[i + 1]], vertices[mesh.Indices[i + 2]]};
+        clipTriangle(corners, texture);
+    }
+    Stats.Triangles += mesh.Indices.size() / 3;
+    Stats.GeometryMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SoftRasterizer::clipTriangle(const ClipVertex corners[3], const SoftTexture* texture)
+{
+    // (a, b, c, d) with dot(plane, clip position) >= 0 inside: near, far, then the guard band's left, right, bottom & top
+    static const glm::vec4 planes[6] = {
+        glm::vec4(0.0f, 0.0f, 1.0f, 1.0f), glm::vec4(0.0f, 0.0f, -1.0f, 1.0f),
+        glm::vec4(1.0f, 0.0f, 0.0f, GUARD_BAND), glm::vec4(-1.0f, 0.0f, 0.0f, GUARD_BAND),
+        glm::vec4(0.0f, 1.0f, 0.0f, GUARD_BAND), glm::vec4(0.0f, -1.0f, 0.0f, GUARD_BAND)
+    };
+
+    // TRIVIAL REJECT: ALL 3 CORNERS OUTSIDE THE SAME SIDE OF THE VIEW VOLUME (THE REAL ONE, NOT THE GUARD BAND)
+    for (int axis = 0; axis < 3; axis++)
+    {
+        bool allBelow = true, allAbove = true;
+        for (int corner = 0; corner < 3; corner++)
+        {
+            const glm::vec4& p = corners[corner].Position;
+            allBelow = allBelow && p[axis] < -p.w;
+            allAbove = allAbove && p[axis] > p.w;
+        }
+        if (allBelow || allAbove) return;
+    }
+
+    unsigned outside = 0;   // Planes any corner is outside of
+    for (int plane = 0; plane < 6; plane++)
+        for (int corner = 0; corner < 3; corner++)
+            if (glm::dot(planes[plane], corners[corner].Position) < 0.0f)
+                outside |= 1u << plane;
+    if (!outside)
+    {
+        setupTriangle(corners[0], corners[1], corners[2], texture);
+        return;
+    }
+
+    // SUTHERLAND-HODGMAN AGAINST ONLY THE PLANES CROSSED, THEN A FAN OF WHAT'S LEFT
+    std::vector<ClipVertex> polygon(corners, corners + 3), clipped;
+    for (int plane = 0; plane < 6 && polygon.size() >= 3; plane++)
+    {
+        if (!(outside & (1u << plane))) continue;
+        clipped.clear();
+        for (size_t i = 0; i < polygon.size(); i++)
+        {
+            const ClipVertex& current = polygon[i];
+            const ClipVertex& next = polygon[(i + 1) % polygon.size()];
+            float currentDistance = glm::dot(planes[plane], current.Position), nextDistance = glm::dot(planes[plane], next.Position);
+            if (currentDistance >= 0.0f)
+                clipped.push_back(current);
+            if ((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+            {
+                float t = currentDistance / (currentDistance - nextDistance);
+                clipped.push_back({glm::mix(current.Position, next.Position, t), glm::mix(current.UV, next.UV, t)});
+            }
+        }
+        polygon.swap(clipped);
+    }
+    for (size_t i = 1; i + 1 < polygon.size(); i++)
+        setupTriangle(polygon[0], polygon[i], polygon[i + 1], texture);
+}
+
+void SoftRasterizer::setupTriangle(const ClipVertex& a, const ClipVertex& b, const ClipVertex& c, const SoftTexture* texture)
+{
+    const ClipVertex* corners[3] = {&a, &b, &c};
+    glm::vec3 screen[3];
+    float q[3];
+    for (int corner = 0; corner < 3; corner++)
+    {
+        const glm::vec4& p = corners[corner]->Position;
+        q[corner] = 1.0f / p.w;
+        screen[corner] = glm::vec3((p.x * q[corner] * 0.5f + 0.5f) * Width, (p.y * q[corner] * 0.5f + 0.5f) * Height, p.z * q[corner] * 0.5f + 0.5f);
+    }
+
+    // Faces aren't culled (GL_CULL_FACE is off), so both windings are rasterized
+    RasterTriangle triangle;
+    float area;
+    bool flipped;
+    if (!setupRasterTriangle(screen, Width, Height, triangle, area, flipped)) return;
+    if (flipped)
+    {
+        std::swap(corners[1], corners[2]);
+        std::swap(q[1], q[2]);
+    }
+
+    TriangleShading planes;
+    rasterPlane(screen, q[0], q[1], q[2], area, planes.qA, planes.qB, planes.qC);
+    rasterPlane(screen, corners[0]->UV.x * q[0], corners[1]->UV.x * q[1], corners[2]->UV.x * q[2], area, planes.uA, planes.uB, planes.uC);
+    rasterPlane(screen, corners[0]->UV.y * q[0], corners[1]->UV.y * q[1], corners[2]->UV.y * q[2], area, planes.vA, planes.vB, planes.vC);
+    planes.texture = texture;
+    triangles.push_back(triangle);
+    shading.push_back(planes);
+    Stats.Rasterized++;
+}
+
+// RASTERIZATION
+// -------------
+void SoftRasterizer::finish()
+{
+    PROFILE_SCOPE("SoftRasterizer::finish");
+    auto start = std::chrono::steady_clock::now();
+
+    Stats.Binned = tiles.bin(triangles);
+    tiles.run([this](int tile) { rasterizeTile(tile); });
+
+    for (size_t fragments : tileFragments)
+        Stats.Fragments += fragments;
+    Stats.RasterMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+void SoftRasterizer::rasterizeTile(int tile)
+{
+    PROFILE_SCOPE("raster tile");
+    int tileX0, tileY0, tileX1, tileY1;
+    tiles.bounds(tile, tileX0, tileY0, tileX1, tileY1);
+    for (int y = tileY0; y <= tileY1; y++)
+    {
+        std::fill(colour.begin() + (size_t)y * stride + tileX0, colour.begin() + (size_t)y * stride + tileX1 + 1, clearValue);
+        std::fill(depth.begin() + (size_t)y * stride + tileX0, depth.begin() + (size_t)y * stride + tileX1 + 1, 1.0f);
+    }
+
+    size_t fragments = 0;
+    for (uint32_t index : tiles.triangles(tile))
+    {
+        const TriangleShading& planes = shading[index];
+        rasterizeQuads<true>(triangles[index], tileX0, tileY0, tileX1, tileY1, Width, [&](const RasterQuad& quad)
+        {
+            size_t row = (size_t)quad.Y * stride + quad.X;
+            for (int lane = 0; lane < 4; lane++)
+                if ((quad.Mask & (1 << lane)) && quad.Depth[lane] < depth[row + lane])
+                {
+                    depth[row + lane] = quad.Depth[lane];
+                    colour[row + lane] = shade(planes, quad.X + lane + 0.5f, quad.Y + 0.5f);
+                    fragments++;
+                }
+        });
+    }
+    tileFragments[tile] = fragments;
+}
+
+// FRAGMENT SHADER: fragColor = texture(ourTexture, texCoordToFrag)
+// ----------------------------------------------------------------
+uint32_t SoftRasterizer::shade(const TriangleShading& t, float px, float py) const
+{
+    if (!t.texture || t.texture->Levels.empty())
+        return 0xffffffffu;
+    const SoftTexture& texture = *t.texture;
+
+    // Perspective-correct UVs: u/w, v/w & 1/w are linear in screen space, u & v are not
+    float q = t.qA * px + t.qB * py + t.qC;
+    float invQ = 1.0f / q;
+    float u = (t.uA * px + t.uB * py + t.uC) * invQ, v = (t.vA * px + t.vB * py + t.vC) * invQ;
+
+    // LOD from the exact screen derivatives of u & v (in level 0 texels), as the spec defines it before approximations
+    glm::vec4 sample;
+    const MipLevel& base = texture.Levels[0];
+    float dudx = (t.uA - u * t.qA) * invQ * base.Width, dudy = (t.uB - u * t.qB) * invQ * base.Width;
+    float dvdx = (t.vA - v * t.qA) * invQ * base.Height, dvdy = (t.vB - v * t.qB) * invQ * base.Height;
+    float rhoSquared = std::max(dudx * dudx + dvdx * dvdx, dudy * dudy + dvdy * dvdy);
+    float lod = 0.5f * std::log2(std::max(rhoSquared, 1e-20f));
+    if (!texture.Mipmapped || lod <= 0.0f)
+        sample = sampleBilinear(base, texture.Repeat, u, v);     // Magnified: GL_LINEAR
+    else
+    {
+        float maxLevel = (float)(texture.Levels.size() - 1);
+        lod = std::min(lod, maxLevel);
+        int level = (int)lod;
+        float blend = lod - level;
+        sample = sampleBilinear(texture.Levels[level], texture.Repeat, u, v);
+        if (blend > 0.0f)
+            sample += (sampleBilinear(texture.Levels[level + 1], texture.Repeat, u, v) - sample) * blend;
+    }
+    sample += 0.5f;
+    return (uint32_t)sample.r | (uint32_t)sample.g << 8 | (uint32_t)sample.b << 16 | (uint32_t)sample.a << 24;
+}
+
+void SoftRasterizer::readPixels(std::vector<unsigned char>& pixels) const
+{
+    pixels.resize((size_t)Width * Height * 4);
+    for (int y = 0; y < Height; y++)
+        for (int x = 0; x < Width; x++)
+        {
+            uint32_t value = colour[(size_t)y * stride + x];
+            unsigned char* pixel = &pixels[((size_t)y * Width + x) * 4];
+            pixel[0] = value & 0xff;
+            pixel[1] = (value >> 8) & 0xff;
+            pixel[2] = (value >> 16) & 0xff;
+            pixel[3] = value >> 24;
+        }
+}
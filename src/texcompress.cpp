@@ -0,0 +1,567 @@
+#include "texcompress.h"
+#include <thread>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+
+size_t blockBytes(BlockFormat format)
+{
+    return format == BLOCK_BC1 ? 8 : 16;
+}
+
+size_t compressedSize(BlockFormat format, int width, int height)
+{
+    return (size_t)((width + 3) / 4) * ((height + 3) / 4) * blockBytes(format);
+}
+
+// SHARED HELPERS
+// --------------
+static inline int clampByte(float value)
+{
+    return value < 0.0f ? 0 : value > 255.0f ? 255 : (int)(value + 0.5f);
+}
+
+// Principal axis of the block's texels in 'channels' dimensions (power iteration on the covariance matrix)
+static void principalAxis(const float texels[16][4], int channels, float mean[4], float axis[4])
+{
+    for (int c = 0; c < 4; c++) mean[c] = 0.0f;
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < channels; c++)
+            mean[c] += texels[i][c] / 16.0f;
+
+    float covariance[4][4] = {};
+    for (int i = 0; i < 16; i++)
+        for (int a = 0; a < channels; a++)
+            for (int b = 0; b < channels; b++)
+                covariance[a][b] += (texels[i][a] - mean[a]) * (texels[i][b] - mean[b]);
+
+    // Starting from the diagonal of the bounding box converges in a few steps for nearly every block
+    float lo[4] = {255, 255, 255, 255}, hi[4] = {0, 0, 0, 0};
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < channels; c++)
+        {
+            lo[c] = std::min(lo[c], texels[i][c]);
+            hi[c] = std::max(hi[c], texels[i][c]);
+        }
+    for (int c = 0; c < 4; c++) axis[c] = c < channels ? hi[c] - lo[c] : 0.0f;
+    for (int iteration = 0; iteration < 8; iteration++)
+    {
+        float next[4] = {};
+        for (int a = 0; a < channels; a++)
+            for (int b = 0; b < channels; b++)
+                next[a] += covariance[a][b] * axis[b];
+        float length = 0.0f;
+        for (int c = 0; c < channels; c++) length += next[c] * next[c];
+        if (length < 1e-12f) break;     // Flat block, keep the previous guess
+        length = std::sqrt(length);
+        for (int c = 0; c < channels; c++) axis[c] = next[c] / length;
+    }
+    float length = 0.0f;
+    for (int c = 0; c < channels; c++) length += axis[c] * axis[c];
+    if (length > 1e-12f)
+    {
+        length = std::sqrt(length);
+        for (int c = 0; c < channels; c++) axis[c] /= length;
+    }
+}
+
+// Endpoints at the extremes of the texels' projection onto the axis
+static void axisEndpoints(const float texels[16][4], int channels, const float mean[4], const float axis[4], float e0[4], float e1[4])
+{
+    float tMin = 1e30f, tMax = -1e30f;
+    for (int i = 0; i < 16; i++)
+    {
+        float t = 0.0f;
+        for (int c = 0; c < channels; c++) t += (texels[i][c] - mean[c]) * axis[c];
+        tMin = std::min(tMin, t);
+        tMax = std::max(tMax, t);
+    }
+    for (int c = 0; c < 4; c++)
+    {
+        e0[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * tMax));
+        e1[c] = std::min(255.0f, std::max(0.0f, mean[c] + axis[c] * tMin));
+    }
+}
+
+// Least squares endpoints for fixed per-texel weights w (texel ~ (1 - w) * e0 + w * e1). Returns false if the system is singular
+static bool leastSquaresEndpoints(const float texels[16][4], int channels, const float weights[16], float e0[4], float e1[4])
+{
+    float aa = 0.0f, bb = 0.0f, ab = 0.0f, x[4] = {}, y[4] = {};
+    for (int i = 0; i < 16; i++)
+    {
+        float a = 1.0f - weights[i], b = weights[i];
+        aa += a * a; bb += b * b; ab += a * b;
+        for (int c = 0; c < channels; c++)
+        {
+            x[c] += a * texels[i][c];
+            y[c] += b * texels[i][c];
+        }
+    }
+    float det = aa * bb - ab * ab;
+    if (std::fabs(det) < 1e-6f) return false;
+    for (int c = 0; c < channels; c++)
+    {
+        e0[c] = std::min(255.0f, std::max(0.0f, (x[c] * bb - y[c] * ab) / det));
+        e1[c] = std::min(255.0f, std::max(0.0f, (y[c] * aa - x[c] * ab) / det));
+    }
+    return true;
+}
+
+static void loadTexels(const unsigned char* rgba, float texels[16][4])
+{
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+            texels[i][c] = rgba[i * 4 + c];
+}
+
+// BC1 COLOUR BLOCK
+// ----------------
+static inline unsigned packRGB565(const float colour[4])
+{
+    unsigned r = (clampByte(colour[0]) * 31 + 127) / 255;
+    unsigned g = (clampByte(colour[1]) * 63 + 127) / 255;
+    unsigned b = (clampByte(colour[2]) * 31 + 127) / 255;
+    return (r << 11) | (g << 5) | b;
+}
+
+static inline void unpackRGB565(unsigned packed, int rgb[3])
+{
+    int r = (packed >> 11) & 31, g = (packed >> 5) & 63, b = packed & 31;
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Index i -> palette entry, with its weight towards colour1
+static const float BC1_WEIGHTS[4] = {0.0f, 1.0f, 1.0f / 3.0f, 2.0f / 3.0f};
+
+// Picks the nearest 4-colour palette entry per texel, returns the squared error
+static float fitColourIndices(const float texels[16][4], unsigned c0, unsigned c1, unsigned char indices[16])
+{
+    int a[3], b[3], palette[4][3];
+    unpackRGB565(c0, a);
+    unpackRGB565(c1, b);
+    for (int c = 0; c < 3; c++)
+    {
+        palette[0][c] = a[c];
+        palette[1][c] = b[c];
+        palette[2][c] = (2 * a[c] + b[c]) / 3;
+        palette[3][c] = (a[c] + 2 * b[c]) / 3;
+    }
+    float total = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        float best = 1e30f;
+        for (int p = 0; p < 4; p++)
+        {
+            float error = 0.0f;
+            for (int c = 0; c < 3; c++)
+            {
+                float d = texels[i][c] - palette[p][c];
+                error += d * d;
+            }
+            if (error < best)
+            {
+                best = error;
+                indices[i] = (unsigned char)p;
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+static void encodeColourBlock(const float texels[16][4], unsigned char* block)
+{
+    float mean[4], axis[4], e0[4], e1[4];
+    principalAxis(texels, 3, mean, axis);
+    axisEndpoints(texels, 3, mean, axis, e0, e1);
+
+    unsigned bestC0 = 0, bestC1 = 0;
+    unsigned char bestIndices[16] = {}, indices[16];
+    float bestError = 1e30f;
+    // PCA endpoints, then refine twice with least squares on the chosen indices, keeping whichever quantizes best
+    for (int iteration = 0; iteration < 3; iteration++)
+    {
+        unsigned c0 = packRGB565(e0), c1 = packRGB565(e1);
+        float error = fitColourIndices(texels, c0, c1, indices);
+        if (error < bestError)
+        {
+            bestError = error;
+            bestC0 = c0;
+            bestC1 = c1;
+            memcpy(bestIndices, indices, 16);
+        }
+        if (error == 0.0f) break;
+        float weights[16];
+        for (int i = 0; i < 16; i++) weights[i] = BC1_WEIGHTS[indices[i]];
+        if (!leastSquaresEndpoints(texels, 3, weights, e0, e1)) break;
+    }
+
+    // 4-colour mode needs colour0 > colour1, swapping the endpoints swaps 0<->1 and 2<->3
+    if (bestC0 < bestC1)
+    {
+        std::swap(bestC0, bestC1);
+        for (int i = 0; i < 16; i++) bestIndices[i] ^= 1;
+    }
+    else if (bestC0 == bestC1)
+        memset(bestIndices, 0, 16);
+
+    uint32_t bits = 0;
+    for (int i = 0; i < 16; i++)
+        bits |= (uint32_t)bestIndices[i] << (i * 2);
+    block[0] = bestC0 & 0xFF; block[1] = bestC0 >> 8;
+    block[2] = bestC1 & 0xFF; block[3] = bestC1 >> 8;
+    memcpy(block + 4, &bits, 4);
+}
+
+static void decodeColourBlock(const unsigned char* block, unsigned char* rgba, bool allowThreeColour)
+{
+    unsigned c0 = block[0] | (block[1] << 8), c1 = block[2] | (block[3] << 8);
+    int a[3], b[3], palette[4][4];
+    unpackRGB565(c0, a);
+    unpackRGB565(c1, b);
+    bool fourColour = c0 > c1 || !allowThreeColour;
+    for (int c = 0; c < 3; c++)
+    {
+        palette[0][c] = a[c];
+        palette[1][c] = b[c];
+        palette[2][c] = fourColour ? (2 * a[c] + b[c]) / 3 : (a[c] + b[c]) / 2;
+        palette[3][c] = fourColour ? (a[c] + 2 * b[c]) / 3 : 0;
+    }
+    palette[0][3] = palette[1][3] = palette[2][3] = 255;
+    palette[3][3] = fourColour ? 255 : 0;
+
+    uint32_t bits;
+    memcpy(&bits, block + 4, 4);
+    for (int i = 0; i < 16; i++)
+        for (int c = 0; c < 4; c++)
+            rgba[i * 4 + c] = (unsigned char)palette[(bits >> (i * 2)) & 3][c];
+}
+
+// BC3 ALPHA BLOCK
+// ---------------
+static void alphaPalette(int a0, int a1, int palette[8])
+{
+    palette[0] = a0;
+    palette[1] = a1;
+    if (a0 > a1)
+        for (int i = 1; i < 7; i++) palette[i + 1] = ((7 - i) * a0 + i * a1) / 7;
+    else
+    {
+        for (int i = 1; i < 5; i++) palette[i + 1] = ((5 - i) * a0 + i * a1) / 5;
+        palette[6] = 0;
+        palette[7] = 255;
+    }
+}
+
+static void encodeAlphaBlock(const unsigned char* rgba, unsigned char* block)
+{
+    int lo = 255, hi = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        lo = std::min(lo, (int)rgba[i * 4 + 3]);
+        hi = std::max(hi, (int)rgba[i * 4 + 3]);
+    }
+    // 8-value mode (a0 > a1) spanning the block's range. A constant block encodes exactly with every index 0
+    int palette[8];
+    alphaPalette(hi, lo, palette);
+    uint64_t bits = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int alpha = rgba[i * 4 + 3], bestIndex = 0, bestError = 256;
+        for (int p = 0; p < (hi > lo ? 8 : 1); p++)
+        {
+            int error = std::abs(alpha - palette[p]);
+            if (error < bestError)
+            {
+                bestError = error;
+                bestIndex = p;
+            }
+        }
+        bits |= (uint64_t)bestIndex << (i * 3);
+    }
+    block[0] = (unsigned char)hi;
+    block[1] = (unsigned char)lo;
+    for (int i = 0; i < 6; i++)
+        block[2 + i] = (unsigned char)(bits >> (i * 8));
+}
+
+static void decodeAlphaBlock(const unsigned char* block, unsigned char* rgba)
+{
+    int palette[8];
+    alphaPalette(block[0], block[1], palette);
+    uint64_t bits = 0;
+    for (int i = 0; i < 6; i++)
+        bits |= (uint64_t)block[2 + i] << (i * 8);
+    for (int i = 0; i < 16; i++)
+        rgba[i * 4 + 3] = (unsigned char)palette[(bits >> (i * 3)) & 7];
+}
+
+// BC7 MODE 6
+// ----------
+static const int BC7_WEIGHTS[16] = {0, 4, 9, 13, 17, 21, 26, 30, 34, 38, 43, 47, 51, 55, 60, 64};
+
+static inline int bc7Interpolate(int e0, int e1, int weight)
+{
+    return ((64 - weight) * e0 + weight * e1 + 32) >> 6;
+}
+
+// Quantizes an RGBA endpoint to 7 bits per channel plus the given shared p-bit. Outputs the 8-bit reconstruction
+static void quantizeBC7Endpoint(const float endpoint[4], int pBit, int quantized[4], int reconstructed[4])
+{
+    for (int c = 0; c < 4; c++)
+    {
+        quantized[c] = std::min(127, std::max(0, (int)std::floor((endpoint[c] - pBit) / 2.0f + 0.5f)));
+        reconstructed[c] = (quantized[c] << 1) | pBit;
+    }
+}
+
+static float fitBC7Indices(const float texels[16][4], const int r0[4], const int r1[4], unsigned char indices[16])
+{
+    int palette[16][4];
+    for (int p = 0; p < 16; p++)
+        for (int c = 0; c < 4; c++)
+            palette[p][c] = bc7Interpolate(r0[c], r1[c], BC7_WEIGHTS[p]);
+    float total = 0.0f;
+    for (int i = 0; i < 16; i++)
+    {
+        float best = 1e30f;
+        for (int p = 0; p < 16; p++)
+        {
+            float error = 0.0f;
+            for (int c = 0; c < 4; c++)
+            {
+                float d = texels[i][c] - palette[p][c];
+                error += d * d;
+            }
+            if (error < best)
+            {
+                best = error;
+                indices[i] = (unsigned char)p;
+            }
+        }
+        total += best;
+    }
+    return total;
+}
+
+// Little-endian bit stream over a 16-byte block
+static inline void writeBits(unsigned char* block, int& position, unsigned value, int count)
+{
+    for (int i = 0; i < count; i++, position++)
+        if ((value >> i) & 1)
+            block[position >> 3] |= (unsigned char)(1 << (position & 7));
+}
+
+static inline unsigned readBits(const unsigned char* block, int& position, int count)
+{
+    unsigned value = 0;
+    for (int i = 0; i < count; i++, position++)
+        value |= (unsigned)((block[position >> 3] >> (position & 7)) & 1) << i;
+    return value;
+}
+
+void encodeBlockBC7(const unsigned char* rgba, unsigned char* block)
+{
+    float texels[16][4], mean[4], axis[4], e0[4], e1[4];
+    loadTexels(rgba, texels);
+    principalAxis(texels, 4, mean, axis);
+    axisEndpoints(texels, 4, mean, axis, e0, e1);
+
+    // Alpha 255 only survives with both p-bits 1 (127 << 1 | 0 is 254), which an RGBA error fit doesn't always pick on its
+    // own, so opaque blocks always use them. Otherwise the p-bit pair is chosen by the error after the indices are fit
+    bool opaque = true;
+    for (int i = 0; i < 16; i++)
+        opaque = opaque && rgba[i * 4 + 3] == 255;
+
+    int bestQ0[4] = {}, bestQ1[4] = {}, bestP0 = 0, bestP1 = 0;
+    unsigned char bestIndices[16] = {}, indices[16], iterationIndices[16] = {};
+    float bestError = 1e30f;
+    for (int iteration = 0; iteration < 3; iteration++)
+    {
+        float iterationError = 1e30f;
+        for (int pBits = opaque ? 3 : 0; pBits < 4; pBits++)
+        {
+            int q0[4], q1[4], r0[4], r1[4], p0 = pBits & 1, p1 = pBits >> 1;
+            quantizeBC7Endpoint(e0, p0, q0, r0);
+            quantizeBC7Endpoint(e1, p1, q1, r1);
+            float error = fitBC7Indices(texels, r0, r1, indices);
+            if (error < iterationError)
+            {
+                iterationError = error;
+                memcpy(iterationIndices, indices, 16);
+            }
+            if (error < bestError)
+            {
+                bestError = error;
+                memcpy(bestQ0, q0, sizeof(q0));
+                memcpy(bestQ1, q1, sizeof(q1));
+                bestP0 = p0;
+                bestP1 = p1;
+                memcpy(bestIndices, indices, 16);
+            }
+        }
+        if (iterationError == 0.0f) break;
+        memcpy(indices, iterationIndices, 16);
+        float weights[16];
+        for (int i = 0; i < 16; i++) weights[i] = BC7_WEIGHTS[indices[i]] / 64.0f;
+        if (!leastSquaresEndpoints(texels, 4, weights, e0, e1)) break;
+    }
+
+    // The anchor (first) index is stored with its top bit implied 0, swapping the endpoints mirrors the indices
+    if (bestIndices[0] & 8)
+    {
+        std::swap(bestQ0, bestQ1);
+        std::swap(bestP0, bestP1);
+        for (int i = 0; i < 16; i++) bestIndices[i] = 15 - bestIndices[i];
+    }
+
+    memset(block, 0, 16);
+    int position = 0;
+    writeBits(block, position, 1 << 6, 7);  // Mode 6: six 0 bits then a 1
+    for (int c = 0; c < 4; c++)
+    {
+        writeBits(block, position, bestQ0[c], 7);
+        writeBits(block, position, bestQ1[c], 7);
+    }
+    writeBits(block, position, bestP0, 1);
+    writeBits(block, position, bestP1, 1);
+    writeBits(block, position, bestIndices[0], 3);
+    for (int i = 1; i < 16; i++)
+        writeBits(block, position, bestIndices[i], 4);
+}
+
+void decodeBlockBC7(const unsigned char* block, unsigned char* rgba)
+{
+    int position = 0;
+    if (readBits(block, position, 7) != (1 << 6))
+    {
+        // Not mode 6: magenta, so unsupported blocks are obvious rather than silently wrong
+        for (int i = 0; i < 16; i++)
+        {
+            rgba[i * 4 + 0] = 255; rgba[i * 4 + 1] = 0; rgba[i * 4 + 2] = 255; rgba[i * 4 + 3] = 255;
+        }
+        return;
+    }
+    int q0[4], q1[4];
+    for (int c = 0; c < 4; c++)
+    {
+        q0[c] = readBits(block, position, 7);
+        q1[c] = readBits(block, position, 7);
+    }
+    int p0 = readBits(block, position, 1), p1 = readBits(block, position, 1);
+    for (int i = 0; i < 16; i++)
+    {
+        int index = readBits(block, position, i == 0 ? 3 : 4);
+        for (int c = 0; c < 4; c++)
+            rgba[i * 4 + c] = (unsigned char)bc7Interpolate((q0[c] << 1) | p0, (q1[c] << 1) | p1, BC7_WEIGHTS[index]);
+    }
+}
+
+// BC1 / BC3 ENTRY POINTS
+// ----------------------
+void encodeBlockBC1(const unsigned char* rgba, unsigned char* block)
+{
+    float texels[16][4];
+    loadTexels(rgba, texels);
+    encodeColourBlock(texels, block);
+}
+
+void encodeBlockBC3(const unsigned char* rgba, unsigned char* block)
+{
+    float texels[16][4];
+    loadTexels(rgba, texels);
+    encodeAlphaBlock(rgba, block);
+    encodeColourBlock(texels, block + 8);
+}
+
+void decodeBlockBC1(const unsigned char* block, unsigned char* rgba)
+{
+    decodeColourBlock(block, rgba, true);
+}
+
+void decodeBlockBC3(const unsigned char* block, unsigned char* rgba)
+{
+    decodeColourBlock(block + 8, rgba, false);  // BC3 colour is always 4-colour
+    decodeAlphaBlock(block, rgba);
+}
+
+// WHOLE IMAGES
+// ------------
+// Gathers one 4x4 block, clamping to the edge for partial blocks (so padding doesn't pull the endpoints off)
+static void gatherBlock(const unsigned char* rgba, int width, int height, int bx, int by, unsigned char* texels)
+{
+    for (int y = 0; y < 4; y++)
+        for (int x = 0; x < 4; x++)
+        {
+            int sx = std::min(bx * 4 + x, width - 1), sy = std::min(by * 4 + y, height - 1);
+            memcpy(texels + (y * 4 + x) * 4, rgba + ((size_t)sy * width + sx) * 4, 4);
+        }
+}
+
+std::vector<unsigned char> compressImage(const unsigned char* rgba, int width, int height, BlockFormat format, unsigned threads)
+{
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t stride = blockBytes(format);
+    std::vector<unsigned char> blocks(compressedSize(format, width, height));
+    void (*encode)(const unsigned char*, unsigned char*) =
+        format == BLOCK_BC1 ? encodeBlockBC1 : format == BLOCK_BC3 ? encodeBlockBC3 : encodeBlockBC7;
+
+    // Block rows are independent, hand them out round robin so every thread gets a similar mix of busy & flat areas
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    threads = std::min(threads, (unsigned)blocksY);
+    auto encodeRows = [&](unsigned first)
+    {
+        unsigned char texels[64];
+        for (int by = (int)first; by < blocksY; by += (int)threads)
+            for (int bx = 0; bx < blocksX; bx++)
+            {
+                gatherBlock(rgba, width, height, bx, by, texels);
+                encode(texels, &blocks[((size_t)by * blocksX + bx) * stride]);
+            }
+    };
+    std::vector<std::thread> pool;
+    for (unsigned t = 1; t < threads; t++)
+        pool.emplace_back(encodeRows, t);
+    encodeRows(0);
+    for (std::thread& thread : pool)
+        thread.join();
+    return blocks;
+}
+
+std::vector<unsigned char> decompressImage(const unsigned char* blocks, int width, int height, BlockFormat format)
+{
+    int blocksX = (width + 3) / 4, blocksY = (height + 3) / 4;
+    size_t stride = blockBytes(format);
+    std::vector<unsigned char> rgba((size_t)width * height * 4);
+    void (*decode)(const unsigned char*, unsigned char*) =
+        format == BLOCK_BC1 ? decodeBlockBC1 : format == BLOCK_BC3 ? decodeBlockBC3 : decodeBlockBC7;
+
+    unsigned char texels[64];
+    for (int by = 0; by < blocksY; by++)
+        for (int bx = 0; bx < blocksX; bx++)
+        {
+            decode(&blocks[((size_t)by * blocksX + bx) * stride], texels);
+            for (int y = 0; y < 4 && by * 4 + y < height; y++)
+                for (int x = 0; x < 4 && bx * 4 + x < width; x++)
+                    memcpy(&rgba[((size_t)(by * 4 + y) * width + bx * 4 + x) * 4], texels + (y * 4 + x) * 4, 4);
+        }
+    return rgba;
+}
+
+double computePSNR(const unsigned char* a, const unsigned char* b, size_t texels, int channels)
+{
+    double squared = 0.0;
+    for (size_t i = 0; i < texels; i++)
+        for (int c = 0; c < channels; c++)
+        {
+            double d = (double)a[i * 4 + c] - b[i * 4 + c];
+            squared += d * d;
+        }
+    double mse = squared / ((double)texels * channels);
+    if (mse <= 0.0) return 99.0;
+    return 10.0 * std::log10(255.0 * 255.0 / mse);
+}
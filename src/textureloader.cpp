@@ -0,0 +1,455 @@
+#include "textureloader.h"
+#include "glfeatures.h"
+#include "glstate.h"
+#include "ktx2.h"
+#include "assetpack.h"
+#include "profiler.h"
+#include "stb_image.h"
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include <iostream>
+#include <algorithm>
+#include <filesystem>
+
+TextureObject::TextureObject()
+{
+    glGenTextures(1, &ID);
+}
+
+TextureObject::~TextureObject()
+{
+    GLState.deleteTextures(1, &ID);
+}
+
+// Level 0 plus a full mip chain is ~4/3 of level 0
+static size_t textureBytes(int width, int height)
+{
+    return (size_t)width * height * 4 * 4 / 3;
+}
+
+TextureLoader::TextureLoader(unsigned workerCount, unsigned stagingBuffers)
+{
+    if (workerCount == 0)
+        workerCount = std::max(1u, std::min(4u, std::thread::hardware_concurrency()));
+    for (unsigned i = 0; i < workerCount; i++)
+        workers.emplace_back(&TextureLoader::workerLoop, this);
+
+    // Decided once on the GL thread, the workers only read it
+    if (GLExt.TextureCompressionS3TC)
+    {
+        compressedFormats[VK_FORMAT_BC1_RGB_UNORM_BLOCK] = GL_COMPRESSED_RGB_S3TC_DXT1_EXT;
+        compressedFormats[VK_FORMAT_BC3_UNORM_BLOCK] = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+    }
+    if (GLExt.TextureCompressionS3TCsRGB)
+    {
+        compressedFormats[VK_FORMAT_BC1_RGB_SRGB_BLOCK] = GL_COMPRESSED_SRGB_S3TC_DXT1_EXT;
+        compressedFormats[VK_FORMAT_BC3_SRGB_BLOCK] = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT;
+    }
+    if (GLExt.TextureCompressionBPTC)
+    {
+        compressedFormats[VK_FORMAT_BC7_UNORM_BLOCK] = GL_COMPRESSED_RGBA_BPTC_UNORM;
+        compressedFormats[VK_FORMAT_BC7_SRGB_BLOCK] = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM;
+    }
+
+    staging.resize(std::max(1u, stagingBuffers));
+    for (StagingBuffer& buffer : staging)
+        glGenBuffers(1, &buffer.PBO);
+}
+
+TextureLoader::~TextureLoader()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+
+    for (Decoded& image : decoded)
+        stbi_image_free(image.pixels);
+    for (StagingBuffer& buffer : staging)
+    {
+        if (buffer.fence) glDeleteSync(buffer.fence);
+        GLState.deleteBuffers(1, &buffer.PBO);
+    }
+}
+
+TextureRef TextureLoader::findCached(const std::string& key, const TextureParams& params)
+{
+    // SAME SOURCE WITH THE SAME SAMPLER STATE ALREADY LOADED (OR LOADING): SHARE IT
+    // -----------------------------------------------------------------------------
+    auto cached = pathCache.find(std::make_pair(key, params));
+    if (cached == pathCache.end()) return NULL;
+    TextureRef texture = cached->second.lock();
+    if (!texture) return NULL;
+    pathHits++;
+    if (texture->Resident)  // Still loading: the saving is counted as soon as it's known, in upload()
+    {
+        decodeBytesSaved += (size_t)texture->Width * texture->Height * 4;
+        vramBytesSaved += texture->Object->Bytes;
+    }
+    else
+        texture->pendingShares++;
+    return texture;
+}
+
+TextureRef TextureLoader::createPlaceholder(const std::string& key, const TextureParams& params)
+{
+    // GEN TEXTURE GLOBJECT
+    // --------------------
+    TextureRef texture = std::make_shared<Texture>();
+    texture->Object = std::make_shared<TextureObject>();
+    GLState.bindTexture(0, GL_TEXTURE_2D, texture->id());
+
+    // CONFIG WRAPPING & FILTERING
+    // ---------------------------
+    // Config texture wrapping for s & t axes (x & y)
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, params.sWrap);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, params.tWrap);
+
+    // Config upscaling and downscaling texture filtering methods
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, params.minFilter);   // Downscaling
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, params.magFilter);   // Upscaling
+
+    // PLACEHOLDER UNTIL THE IMAGE IS RESIDENT (1x1 IS A COMPLETE MIP CHAIN, SO ANY MIN FILTER WORKS)
+    // ---------------------------------------------------------------------------------------------
+    const unsigned char grey[4] = {128, 128, 128, 255};
+    glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+    GLState.bindTexture(0, GL_TEXTURE_2D, 0);
+    texture->Object->Bytes = 4;
+
+    pathCache[std::make_pair(key, params)] = texture;
+    requested++;
+    return texture;
+}
+
+TextureRef TextureLoader::load(const std::string& imagePath, GLenum sWrap, GLenum tWrap, GLenum minFilter, GLenum magFilter)
+{
+    PROFILE_SCOPE("TextureLoader::load");
+    TextureParams params = {sWrap, tWrap, minFilter, magFilter};
+    std::error_code error;
+    std::string canonicalPath = std::filesystem::weakly_canonical(imagePath, error).string();
+    if (error) canonicalPath = imagePath;
+    if (TextureRef texture = findCached(canonicalPath, params))
+        return texture;
+
+    TextureRef texture = createPlaceholder(canonicalPath, params);
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        requests.push_back({texture, params, imagePath});
+    }
+    wake.notify_one();
+    return texture;
+}
+
+TextureRef TextureLoader::load(const AssetPack& pack, const std::string& name, GLenum sWrap, GLenum tWrap, GLenum minFilter, GLenum magFilter)
+{
+    TextureParams params = {sWrap, tWrap, minFilter, magFilter};
+    std::string key = pack.Path + "#" + name;
+    if (TextureRef texture = findCached(key, params))
+        return texture;
+
+    TextureRef texture = createPlaceholder(key, params);
+    Decoded image;
+    image.texture = texture;
+    image.params = params;
+    image.path = key;
+    image.pixels = NULL;
+    image.compressedFormat = 0;
+    image.decodeMs = 0.0;
+
+    // NOTHING TO DECODE: THE LEVELS POINT STRAIGHT INTO THE MAPPING, update() UPLOADS THEM FROM THERE
+    // ----------------------------------------------------------------------------------------------
+    const AssetEntry* entry = pack.find(name);
+    unsigned vkFormat = entry ? entry->Params[3] : 0;
+    if (entry && entry->Type == ASSET_TEXTURE && (vkFormat == 0 || compressedFormats.count(vkFormat)))
+    {
+        image.width = (int)entry->Params[0];
+        image.height = (int)entry->Params[1];
+        image.compressedFormat = vkFormat ? compressedFormats[vkFormat] : 0;
+        image.contentHash = entry->Hash ^ vkFormat;    // Hashed when the pack was built
+        BlockFormat format;
+        bool srgb;
+        ktx2BlockFormat(vkFormat, format, srgb);
+        size_t offset = 0;
+        for (uint32_t level = 0; level < entry->Params[2]; level++)
+        {
+            int width = std::max(1, image.width >> level), height = std::max(1, image.height >> level);
+            size_t bytes = vkFormat ? compressedSize(format, width, height) : (size_t)width * height * 4;
+            if (offset + bytes > entry->Size) break;
+            image.mapped.push_back({pack.data(*entry) + offset, bytes});
+            offset += bytes;
+        }
+        pack.prefetch(*entry);  // Start the disk reads now, the upload is at least a frame away
+    }
+    else
+        std::cout << "ERROR::TEXTURE::NOT_IN_PACK " << key << (entry ? " (not a texture, or a format the driver can't sample)" : "") << std::endl;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    decoded.push_back(std::move(image));
+    return texture;
+}
+
+TextureRef TextureLoader::loadPixels(const std::string& name, int width, int height, std::vector<std::vector<unsigned char>> levels,
+                                     GLenum sWrap, GLenum tWrap, GLenum minFilter, GLenum magFilter)
+{
+    TextureParams params = {sWrap, tWrap, minFilter, magFilter};
+    if (TextureRef texture = findCached(name, params))
+        return texture;
+
+    TextureRef texture = createPlaceholder(name, params);
+    Decoded image;
+    image.texture = texture;
+    image.params = params;
+    image.path = name;
+    image.width = width;
+    image.height = height;
+    image.pixels = NULL;
+    image.compressedFormat = 0;
+    image.contentHash = levels.empty() ? 0 : hashBytes(levels[0].data(), levels[0].size());
+    image.levels = std::move(levels);
+    image.decodeMs = 0.0;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    decoded.push_back(std::move(image));
+    return texture;
+}
+
+void TextureLoader::workerLoop()
+{
+    stbi_set_flip_vertically_on_load_thread(true);  // Loads upside-down for some reason (per thread, so workers don't race on the global flag)
+    PROFILE_THREAD("texture loader");
+    while (true)
+    {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return stopping || !requests.empty(); });
+            if (stopping) return;
+            request = requests.front();
+            requests.pop_front();
+        }
+
+        // LOAD TEXTURE FROM IMAGE, ALWAYS EXPANDED TO 4 CHANNELS SO EVERY UPLOAD IS RGBA8
+        // -------------------------------------------------------------------------------
+        PROFILE_SCOPE("decode texture");
+        auto start = std::chrono::steady_clock::now();
+        Decoded image;
+        image.texture = request.texture;
+        image.params = request.params;
+        image.path = request.path;
+        image.pixels = NULL;
+        image.compressedFormat = 0;
+        image.contentHash = 0;
+        if (std::filesystem::path(request.path).extension() == ".ktx2")
+            readCompressed(image);
+        else
+        {
+            int nrChannels;
+            image.pixels = stbi_load(request.path.c_str(), &image.width, &image.height, &nrChannels, 4);
+            if (image.pixels)
+                image.contentHash = hashBytes(image.pixels, (size_t)image.width * image.height * 4);
+            if (image.pixels && CpuMipmaps)
+                for (MipLevel& level : generateMipChain(image.pixels, image.width, image.height, 4, Mipmaps))
+                    image.levels.push_back(std::move(level.Pixels));
+        }
+        image.decodeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        std::lock_guard<std::mutex> lock(mutex);
+        decoded.push_back(std::move(image));
+        wake.notify_all();  // finish() may be waiting for this
+    }
+}
+
+void TextureLoader::readCompressed(Decoded& image) const
+{
+    Ktx2Image ktx;
+    if (!readKtx2(image.path, ktx)) return;
+    if (!ktx.BottomUp)
+        std::cout << "WARNING::TEXTURE::KTX2_TOP_DOWN " << image.path << " will show upside down (bake it with texbake)" << std::endl;
+    image.width = ktx.Width;
+    image.height = ktx.Height;
+    image.contentHash = hashBytes(ktx.Levels[0].data(), ktx.Levels[0].size()) ^ ktx.VkFormat;
+
+    auto supported = compressedFormats.find(ktx.VkFormat);
+    if (supported != compressedFormats.end())
+    {
+        image.compressedFormat = supported->second;
+        image.levels = std::move(ktx.Levels);
+        return;
+    }
+
+    // THE DRIVER CAN'T SAMPLE THIS FORMAT: DECODE EVERY LEVEL TO RGBA8 HERE, ON THE WORKER
+    // -------------------------------------------------------------------------------------
+    BlockFormat format;
+    bool srgb;
+    ktx2BlockFormat(ktx.VkFormat, format, srgb);
+    for (size_t level = 0; level < ktx.Levels.size(); level++)
+        image.levels.push_back(decompressImage(ktx.Levels[level].data(), std::max(1, ktx.Width >> level), std::max(1, ktx.Height >> level), format));
+}
+
+bool TextureLoader::upload(Decoded& image, bool wait)
+{
+    PROFILE_SCOPE("upload texture");
+    TextureRef texture = image.texture.lock();
+    if (!texture || (image.pixels == NULL && image.levels.empty() && image.mapped.empty()))
+    {
+        if (texture)
+            std::cout << "Failed to load texture: " << image.path << std::endl;    // Keeps the placeholder
+        stbi_image_free(image.pixels);
+        return true;
+    }
+
+    // IDENTICAL PIXELS ALREADY RESIDENT UNDER ANOTHER PATH: SHARE THAT OBJECT, THE PLACEHOLDER IS RELEASED
+    // ----------------------------------------------------------------------------------------------------
+    ContentKey contentKey = {image.contentHash, image.width, image.height, image.params};
+    auto cached = contentCache.find(contentKey);
+    std::shared_ptr<TextureObject> shared = cached != contentCache.end() ? cached->second.lock() : NULL;
+    if (shared)
+    {
+        texture->Object = shared;
+        contentHits++;
+        vramBytesSaved += shared->Bytes;
+        std::cout << "TEXTURE::SHARED " << image.path << " (same content as an already resident texture)" << std::endl;
+    }
+    else
+    {
+        std::vector<std::pair<const unsigned char*, size_t>> levels = image.mapped;
+        if (image.pixels)
+            levels.push_back({image.pixels, (size_t)image.width * image.height * 4});
+        for (const std::vector<unsigned char>& level : image.levels)
+            levels.push_back({level.data(), level.size()});
+        size_t bytes = 0;
+        for (const auto& level : levels)
+            bytes += level.second;
+
+        // WAIT FOR THE GPU TO BE DONE WITH THE NEXT STAGING BUFFER, OR TRY AGAIN NEXT FRAME
+        // (MAPPED PACK DATA SKIPS STAGING: THE DRIVER COPIES STRAIGHT OUT OF THE FILE'S PAGES)
+        // ---------------------------------------------------------------------------------
+        StagingBuffer* buffer = image.mapped.empty() ? &staging[nextStaging] : NULL;
+        if (buffer && buffer->fence)
+        {
+            GLenum status = glClientWaitSync(buffer->fence, GL_SYNC_FLUSH_COMMANDS_BIT, wait ? GL_TIMEOUT_IGNORED : 0);
+            if (status == GL_TIMEOUT_EXPIRED) return false;
+            glDeleteSync(buffer->fence);
+            buffer->fence = 0;
+        }
+        if (buffer)
+            nextStaging = (nextStaging + 1) % staging.size();
+
+        // COPY INTO THE PBO (EVERY LEVEL BACK TO BACK), THEN LET THE DRIVER PULL THE TEXTURE FROM IT ASYNCHRONOUSLY
+        // ---------------------------------------------------------------------------------------------------------
+        void* staged = NULL;
+        if (buffer)
+        {
+            GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer->PBO);
+            if (buffer->capacity < bytes)
+            {
+                glBufferData(GL_PIXEL_UNPACK_BUFFER, bytes, NULL, GL_STREAM_DRAW);
+                buffer->capacity = bytes;
+            }
+            // Unsynchronized is safe: the fence above guarantees the GPU is no longer reading this buffer
+            staged = glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, bytes, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT | GL_MAP_UNSYNCHRONIZED_BIT);
+        }
+        if (staged)
+        {
+            size_t offset = 0;
+            for (const auto& level : levels)
+            {
+                memcpy((unsigned char*)staged + offset, level.first, level.second);
+                offset += level.second;
+            }
+            glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+        }
+        else
+            GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);   // Pack data, or mapping failed: upload straight from client memory instead
+
+        GLState.bindTexture(0, GL_TEXTURE_2D, texture->id());
+        size_t offset = 0;
+        for (size_t level = 0; level < levels.size(); level++)
+        {
+            int width = std::max(1, image.width >> level), height = std::max(1, image.height >> level);
+            const void* source = staged ? (const void*)offset : (const void*)levels[level].first;
+            if (image.compressedFormat)
+                glCompressedTexImage2D(GL_TEXTURE_2D, (GLint)level, image.compressedFormat, width, height, 0, (GLsizei)levels[level].second, source);
+            else
+                glTexImage2D(GL_TEXTURE_2D, (GLint)level, GL_RGBA8, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, source);
+            offset += levels[level].second;
+        }
+        if (levels.size() == 1 && !image.compressedFormat)
+            glGenerateMipmap(GL_TEXTURE_2D);    // For reader, search 'OpenGL mipmaps'
+        else
+            glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, (GLint)levels.size() - 1);    // Baked chains may stop early (compressed formats can't use glGenerateMipmap)
+        GLState.bindTexture(0, GL_TEXTURE_2D, 0);
+        GLState.bindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+        if (buffer)
+            buffer->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+
+        texture->Object->Bytes = levels.size() == 1 ? textureBytes(image.width, image.height) : bytes;
+        contentCache[contentKey] = texture->Object;
+        std::cout << "TEXTURE::RESIDENT " << image.path << " " << image.width << "x" << image.height
+                  << (image.compressedFormat ? " compressed" : "") << " (decode " << image.decodeMs << " ms)" << std::endl;
+    }
+
+    texture->Width = image.width;
+    texture->Height = image.height;
+    texture->Resident = true;
+    // Path hits that arrived while this was loading skipped a decode & upload each
+    decodeBytesSaved += texture->pendingShares * (size_t)image.width * image.height * 4;
+    vramBytesSaved += texture->pendingShares * texture->Object->Bytes;
+    texture->pendingShares = 0;
+
+    stbi_image_free(image.pixels);  // Free image from memory
+    image.pixels = NULL;
+    image.levels.clear();
+    image.mapped.clear();
+    return true;
+}
+
+void TextureLoader::update(double budgetMs)
+{
+    auto start = std::chrono::steady_clock::now();
+    while (true)
+    {
+        Decoded image;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (decoded.empty()) return;
+            image = std::move(decoded.front());
+            decoded.pop_front();
+        }
+        if (!upload(image, false))
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            decoded.push_front(std::move(image));  // Staging ring is busy, retry next frame
+            return;
+        }
+        resident++;
+        if (std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count() >= budgetMs)
+            return;
+    }
+}
+
+void TextureLoader::finish()
+{
+    while (pending() > 0)
+    {
+        Decoded image;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this]() { return !decoded.empty(); });
+            image = std::move(decoded.front());
+            decoded.pop_front();
+        }
+        upload(image, true);
+        resident++;
+    }
+}
+
+void TextureLoader::report() const
+{
+    std::cout << "texture cache: " << pathHits << " path hits, " << contentHits << " content hits, saved "
+              << decodeBytesSaved << " decoded bytes and " << vramBytesSaved << " VRAM bytes" << std::endl;
+}
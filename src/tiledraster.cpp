@@ -0,0 +1,87 @@
+#include "tiledraster.h"
+#include <cmath>
+
+// TRIANGLE SETUP
+// --------------
+bool setupRasterTriangle(glm::vec3 screen[3], int width, int height, RasterTriangle& triangle, float& area, bool& flipped)
+{
+    // Counter-clockwise so the edge functions are >= 0 inside
+    area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y) - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+    if (std::fabs(area) < 1e-8f) return false;
+    flipped = area < 0.0f;
+    if (flipped)
+    {
+        std::swap(screen[1], screen[2]);
+        area = -area;
+    }
+
+    float minX = std::min(screen[0].x, std::min(screen[1].x, screen[2].x)), maxX = std::max(screen[0].x, std::max(screen[1].x, screen[2].x));
+    float minY = std::min(screen[0].y, std::min(screen[1].y, screen[2].y)), maxY = std::max(screen[0].y, std::max(screen[1].y, screen[2].y));
+    triangle.MinX = std::max(0, (int)std::floor(minX));
+    triangle.MaxX = std::min(width - 1, (int)std::ceil(maxX));
+    triangle.MinY = std::max(0, (int)std::floor(minY));
+    triangle.MaxY = std::min(height - 1, (int)std::ceil(maxY));
+    if (triangle.MinX > triangle.MaxX || triangle.MinY > triangle.MaxY) return false;   // Off screen
+
+    for (int edge = 0; edge < 3; edge++)
+    {
+        const glm::vec3& from = screen[edge];
+        const glm::vec3& to = screen[(edge + 1) % 3];
+        triangle.EdgeA[edge] = from.y - to.y;
+        triangle.EdgeB[edge] = to.x - from.x;
+        triangle.EdgeC[edge] = from.x * to.y - to.x * from.y;
+        // Counter-clockwise with y up: a top edge runs right to left, a left edge runs down
+        triangle.TopLeft[edge] = (triangle.EdgeA[edge] == 0.0f && triangle.EdgeB[edge] < 0.0f) || triangle.EdgeA[edge] > 0.0f;
+    }
+    // z/w is linear in screen space
+    rasterPlane(screen, screen[0].z, screen[1].z, screen[2].z, area, triangle.DepthA, triangle.DepthB, triangle.DepthC);
+    return true;
+}
+
+void rasterPlane(const glm::vec3 screen[3], float value0, float value1, float value2, float area, float& A, float& B, float& C)
+{
+    A = ((value1 - value0) * (screen[2].y - screen[0].y) - (value2 - value0) * (screen[1].y - screen[0].y)) / area;
+    B = ((screen[1].x - screen[0].x) * (value2 - value0) - (screen[2].x - screen[0].x) * (value1 - value0)) / area;
+    C = value0 - A * screen[0].x - B * screen[0].y;
+}
+
+// BINNING & TILE JOBS
+// -------------------
+RasterTiles::RasterTiles(int width, int height, WorkerPool* pool) : width(width), height(height), pool(pool)
+{
+    tilesX = (width + TILE_SIZE - 1) / TILE_SIZE;
+    tilesY = (height + TILE_SIZE - 1) / TILE_SIZE;
+    bins.resize(tilesX * tilesY);
+}
+
+size_t RasterTiles::bin(const std::vector<RasterTriangle>& triangles)
+{
+    for (std::vector<uint32_t>& bin : bins)
+        bin.clear();
+    size_t binned = 0;
+    for (size_t i = 0; i < triangles.size(); i++)
+    {
+        const RasterTriangle& triangle = triangles[i];
+        for (int ty = triangle.MinY / TILE_SIZE; ty <= triangle.MaxY / TILE_SIZE; ty++)
+            for (int tx = triangle.MinX / TILE_SIZE; tx <= triangle.MaxX / TILE_SIZE; tx++, binned++)
+                bins[ty * tilesX + tx].push_back((uint32_t)i);
+    }
+    return binned;
+}
+
+void RasterTiles::run(const std::function<void(int)>& job)
+{
+    if (pool)
+        pool->parallelFor(count(), job);
+    else
+        for (int tile = 0; tile < count(); tile++)
+            job(tile);
+}
+
+void RasterTiles::bounds(int tile, int& x0, int& y0, int& x1, int& y1) const
+{
+    x0 = (tile % tilesX) * TILE_SIZE;
+    y0 = (tile / tilesX) * TILE_SIZE;
+    x1 = std::min(x0 + TILE_SIZE, width) - 1;
+    y1 = std::min(y0 + TILE_SIZE, height) - 1;
+}
@@ -4,13 +4,21 @@ layout (location = 2) in vec2 aTexCoord;
 
 // Passed to fragment shader
 out vec2 texCoordToFrag;
+flat out int materialToFrag;    // Only read by the material fragment shaders
+
+// Shared by all programs, written once per frame (see frameuniforms.h)
+layout (std140) uniform FrameUniforms
+{
+    mat4 view;
+    mat4 projection;
+};
 
 uniform mat4 model;
-uniform mat4 view;
-uniform mat4 projection;
+uniform int material;
 
 void main()
 {
     gl_Position = projection * view * model * vec4(aPos, 1.0);
     texCoordToFrag = aTexCoord;
+    materialToFrag = material;
 }
\ No newline at end of file
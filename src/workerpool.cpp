@@ -0,0 +1,78 @@
+#include "workerpool.h"
+#include "profiler.h"
+#include <algorithm>
+
+WorkerPool::WorkerPool(unsigned workerCount)
+{
+    if (workerCount == 0)
+        workerCount = std::min(7u, std::max(1u, std::thread::hardware_concurrency()) - 1);
+    for (unsigned i = 0; i < workerCount; i++)
+        workers.emplace_back(&WorkerPool::workerLoop, this);
+}
+
+WorkerPool::~WorkerPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (std::thread& worker : workers)
+        worker.join();
+}
+
+void WorkerPool::parallelFor(int count, const std::function<void(int)>& body)
+{
+    if (count <= 0) return;
+    if (workers.empty() || count == 1)
+    {
+        for (int i = 0; i < count; i++)
+            body(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        job = &body;
+        jobCount = count;
+        next = 0;
+        busy = (int)workers.size();
+        generation++;
+    }
+    wake.notify_all();
+
+    // The caller takes indices too instead of just waiting
+    for (int i = next++; i < count; i = next++)
+        body(i);
+
+    // Every worker has to check in, even one that woke too late to get an index, before 'body' can go out of scope
+    std::unique_lock<std::mutex> lock(mutex);
+    done.wait(lock, [this]() { return busy == 0; });
+    job = NULL;
+}
+
+void WorkerPool::workerLoop()
+{
+    PROFILE_THREAD("worker pool");
+    unsigned seen = 0;
+    while (true)
+    {
+        const std::function<void(int)>* body;
+        int count;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [&]() { return stopping || generation != seen; });
+            if (stopping) return;
+            seen = generation;
+            body = job;
+            count = jobCount;
+        }
+        for (int i = next++; i < count; i = next++)
+            (*body)(i);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (--busy == 0)
+                done.notify_one();
+        }
+    }
+}
@@ -0,0 +1,128 @@
+// mkpack: builds an asset pack (see assetpack.h) from loose files, with every asset already in its upload format
+//
+//   mkpack [--filter box|kaiser] [--linear] [--verify] out.pack file [more files ...]
+//
+//   .png/.jpg/.tga/.bmp        -> ASSET_TEXTURE, RGBA8 bottom-up with a CPU generated mip chain
+//   .ktx2 (from texbake)       -> ASSET_TEXTURE, its block compressed levels as they are
+//   .vs/.fs/.vert/.frag/.glsl  -> ASSET_SHADER
+//   anything else              -> ASSET_RAW
+//
+// Assets are named by their normalized path as given (e.g. textures/wall.png), which is what the app looks them up by
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "assetpack.h"
+#include "ktx2.h"
+#include "mipmap.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <filesystem>
+
+static bool readFile(const std::string& path, std::string& contents)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return false;
+    std::stringstream stream;
+    stream << file.rdbuf();
+    contents = stream.str();
+    return true;
+}
+
+static bool addFile(AssetPackWriter& writer, const std::string& path, const MipOptions& mipOptions)
+{
+    std::string name = std::filesystem::path(path).lexically_normal().generic_string();
+    std::string extension = std::filesystem::path(path).extension().string();
+
+    if (extension == ".png" || extension == ".jpg" || extension == ".tga" || extension == ".bmp")
+    {
+        stbi_set_flip_vertically_on_load(true);     // Row 0 at the bottom, like every other texture in the app
+        int width, height, nrChannels;
+        unsigned char* pixels = stbi_load(path.c_str(), &width, &height, &nrChannels, 4);
+        if (!pixels) return false;
+        std::vector<std::vector<unsigned char>> levels;
+        levels.emplace_back(pixels, pixels + (size_t)width * height * 4);
+        for (MipLevel& level : generateMipChain(pixels, width, height, 4, mipOptions))
+            levels.push_back(std::move(level.Pixels));
+        stbi_image_free(pixels);
+        writer.addTexture(name, width, height, 0, levels);
+        std::cout << "  texture " << name << " " << width << "x" << height << ", " << levels.size() << " levels" << std::endl;
+        return true;
+    }
+    if (extension == ".ktx2")
+    {
+        Ktx2Image image;
+        if (!readKtx2(path, image)) return false;
+        if (!image.BottomUp)
+            std::cout << "WARNING::MKPACK::KTX2_TOP_DOWN " << path << " will show upside down (bake it with texbake)" << std::endl;
+        writer.addTexture(name, image.Width, image.Height, image.VkFormat, image.Levels);
+        std::cout << "  texture " << name << " " << image.Width << "x" << image.Height << ", " << image.Levels.size() << " levels, vkFormat " << image.VkFormat << std::endl;
+        return true;
+    }
+
+    std::string contents;
+    if (!readFile(path, contents)) return false;
+    bool shader = extension == ".vs" || extension == ".fs" || extension == ".vert" || extension == ".frag" || extension == ".glsl";
+    if (shader)
+        writer.addShader(name, contents);
+    else
+        writer.addRaw(name, contents.data(), contents.size());
+    std::cout << "  " << (shader ? "shader " : "raw ") << name << " " << contents.size() << " bytes" << std::endl;
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    MipOptions mipOptions;
+    bool verify = false;
+    std::string output;
+    std::vector<std::string> inputs;
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--filter" && i + 1 < argc)
+        {
+            std::string filter = argv[++i];
+            mipOptions.Filter = filter == "kaiser" ? MIP_FILTER_KAISER : MIP_FILTER_BOX;
+        }
+        else if (arg == "--linear")
+            mipOptions.Srgb = false;
+        else if (arg == "--verify")
+            verify = true;
+        else if (output.empty())
+            output = arg;
+        else
+            inputs.push_back(arg);
+    }
+    if (output.empty() || inputs.empty())
+    {
+        std::cout << "usage: mkpack [--filter box|kaiser] [--linear] [--verify] out.pack file [more files ...]" << std::endl;
+        return 1;
+    }
+
+    AssetPackWriter writer;
+    for (const std::string& input : inputs)
+        if (!addFile(writer, input, mipOptions))
+        {
+            std::cout << "ERROR::MKPACK::CANNOT_READ " << input << std::endl;
+            return 1;
+        }
+    if (!writer.write(output)) return 1;
+
+    // READ IT BACK THROUGH THE MAPPING, CHECKING EVERY HASH IF ASKED TO
+    // -----------------------------------------------------------------
+    AssetPack pack(output);
+    if (!pack.Valid) return 1;
+    size_t corrupt = 0;
+    if (verify)
+        for (size_t i = 0; i < pack.count(); i++)
+            if (!pack.verify(pack.entry(i)))
+            {
+                std::cout << "ERROR::MKPACK::HASH_MISMATCH " << pack.name(pack.entry(i)) << std::endl;
+                corrupt++;
+            }
+    std::cout << output << ": " << pack.count() << " assets, " << std::filesystem::file_size(output) << " bytes"
+              << (verify ? (corrupt ? ", verify FAILED" : ", verified") : "") << std::endl;
+    return corrupt ? 1 : 0;
+}
@@ -0,0 +1,169 @@
+// texbake: bakes images into block compressed KTX2 textures with a full precomputed mip chain, so the app uploads them
+// with glCompressedTexImage2D instead of decoding PNGs and generating mips at load time.
+//
+//   texbake [--format bc1|bc3|bc7] [--srgb] [--filter box|kaiser] [--linear] [--threads N] [--no-mips] [-o DIR] image.png [...]
+//
+// Mips are filtered in linear light unless --linear says the image holds data (normals, masks) rather than colour
+// Writes image.ktx2 next to each input (or into DIR), then reports encode/decode throughput and the PSNR of level 0
+// against the source, measured with the CPU decoder (no GPU needed)
+#define STB_IMAGE_IMPLEMENTATION
+#include "stb_image.h"
+#include "texcompress.h"
+#include "ktx2.h"
+#include "mipmap.h"
+#include <iostream>
+#include <iomanip>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstring>
+#include <cstdlib>
+#include <filesystem>
+#include <algorithm>
+
+struct BakeOptions
+{
+    BlockFormat format = BLOCK_BC7;
+    bool srgb = false;
+    bool mips = true;
+    MipOptions mipOptions;
+    unsigned threads = 0;
+    std::string outputDir;
+    std::vector<std::string> inputs;
+};
+
+static bool parseArgs(int argc, char** argv, BakeOptions& options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--format" && i + 1 < argc)
+        {
+            std::string format = argv[++i];
+            if (format == "bc1") options.format = BLOCK_BC1;
+            else if (format == "bc3") options.format = BLOCK_BC3;
+            else if (format == "bc7") options.format = BLOCK_BC7;
+            else return false;
+        }
+        else if (arg == "--srgb")
+            options.srgb = true;
+        else if (arg == "--filter" && i + 1 < argc)
+        {
+            std::string filter = argv[++i];
+            if (filter == "box") options.mipOptions.Filter = MIP_FILTER_BOX;
+            else if (filter == "kaiser") options.mipOptions.Filter = MIP_FILTER_KAISER;
+            else return false;
+        }
+        else if (arg == "--linear")
+            options.mipOptions.Srgb = false;
+        else if (arg == "--no-mips")
+            options.mips = false;
+        else if (arg == "--threads" && i + 1 < argc)
+            options.threads = (unsigned)atoi(argv[++i]);
+        else if (arg == "-o" && i + 1 < argc)
+            options.outputDir = argv[++i];
+        else if (!arg.empty() && arg[0] == '-')
+            return false;
+        else
+            options.inputs.push_back(arg);
+    }
+    return !options.inputs.empty();
+}
+
+static double msSince(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+static bool bake(const std::string& input, const BakeOptions& options)
+{
+    // LOAD, FLIPPED SO ROW 0 IS THE BOTTOM LIKE EVERY OTHER TEXTURE IN THE APP
+    // ------------------------------------------------------------------------
+    stbi_set_flip_vertically_on_load(true);
+    int width, height, nrChannels;
+    unsigned char* pixels = stbi_load(input.c_str(), &width, &height, &nrChannels, 4);
+    if (!pixels)
+    {
+        std::cout << "ERROR::TEXBAKE::CANNOT_LOAD " << input << std::endl;
+        return false;
+    }
+    std::vector<unsigned char> source(pixels, pixels + (size_t)width * height * 4);
+    stbi_image_free(pixels);
+
+    // COMPRESS EVERY MIP LEVEL
+    // ------------------------
+    Ktx2Image image;
+    image.VkFormat = ktx2VkFormat(options.format, options.srgb);
+    image.Width = width;
+    image.Height = height;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<MipLevel> mips;
+    if (options.mips)
+        mips = generateMipChain(source.data(), width, height, 4, options.mipOptions);
+    double mipMs = msSince(start);
+
+    double encodeMs = 0.0;
+    size_t encodedTexels = 0;
+    for (size_t i = 0; i <= mips.size(); i++)
+    {
+        const unsigned char* pixels = i == 0 ? source.data() : mips[i - 1].Pixels.data();
+        int levelWidth = i == 0 ? width : mips[i - 1].Width, levelHeight = i == 0 ? height : mips[i - 1].Height;
+        start = std::chrono::steady_clock::now();
+        image.Levels.push_back(compressImage(pixels, levelWidth, levelHeight, options.format, options.threads));
+        encodeMs += msSince(start);
+        encodedTexels += (size_t)levelWidth * levelHeight;
+    }
+
+    std::filesystem::path output = std::filesystem::path(input).replace_extension(".ktx2");
+    if (!options.outputDir.empty())
+        output = std::filesystem::path(options.outputDir) / output.filename();
+    if (!writeKtx2(output.string(), image)) return false;
+
+    // QUALITY & THROUGHPUT, CHECKED BY DECODING LEVEL 0 BACK ON THE CPU
+    // -----------------------------------------------------------------
+    start = std::chrono::steady_clock::now();
+    BlockFormat format = options.format;
+    std::vector<unsigned char> decoded = decompressImage(image.Levels[0].data(), width, height, format);
+    double decodeMs = msSince(start);
+
+    size_t texels = (size_t)width * height, compressedBytes = 0;
+    for (const std::vector<unsigned char>& bytes : image.Levels)
+        compressedBytes += bytes.size();
+    std::cout << std::fixed << std::setprecision(2)
+              << output.string() << ": " << width << "x" << height << ", " << image.Levels.size() << " levels, "
+              << compressedBytes << " bytes (" << (double)compressedBytes / (encodedTexels * 4) * 100.0 << "% of RGBA8)\n"
+              << "  mips " << mipMs << " ms (" << mipSimdName(options.mipOptions.Simd) << "), encode " << encodeMs << " ms (" << encodedTexels / (encodeMs * 1000.0) << " Mtexels/s), "
+              << "decode " << decodeMs << " ms (" << texels / (decodeMs * 1000.0) << " Mtexels/s)\n"
+              << "  PSNR rgb " << computePSNR(source.data(), decoded.data(), texels, 3) << " dB";
+    if (format != BLOCK_BC1)    // BC1 has no alpha to compare
+        std::cout << ", rgba " << computePSNR(source.data(), decoded.data(), texels, 4) << " dB";
+    std::cout << std::endl;
+
+    // Opaque has to stay exactly opaque (alpha tests & blending read 254 as see-through)
+    bool sourceOpaque = true, decodedOpaque = true;
+    for (size_t i = 0; i < texels; i++)
+    {
+        sourceOpaque = sourceOpaque && source[i * 4 + 3] == 255;
+        decodedOpaque = decodedOpaque && decoded[i * 4 + 3] == 255;
+    }
+    if (sourceOpaque && !decodedOpaque)
+    {
+        std::cout << "ERROR::TEXBAKE::OPAQUE_DECODED_TRANSLUCENT " << output.string() << std::endl;
+        return false;
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    BakeOptions options;
+    if (!parseArgs(argc, argv, options))
+    {
+        std::cout << "usage: texbake [--format bc1|bc3|bc7] [--srgb] [--filter box|kaiser] [--linear] [--threads N] [--no-mips] [-o DIR] image.png [more.png ...]" << std::endl;
+        return 1;
+    }
+    bool ok = true;
+    for (const std::string& input : options.inputs)
+        ok = bake(input, options) && ok;
+    return ok ? 0 : 1;
+}